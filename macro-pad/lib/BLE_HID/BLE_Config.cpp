@@ -0,0 +1,81 @@
+#include "BLE_Config.h"
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <BLE2902.h>
+#include "Config_Transfer.h"
+
+static BLEServer* configServer;
+static BLECharacteristic* control;
+
+static void notifyStatus() {
+  ConfigTransferStatus status;
+  config_transfer_status(&status);
+  control->setValue((uint8_t*)&status, sizeof(status));
+  control->notify();
+}
+
+class ControlCallbacks : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* characteristic) {
+    config_transfer_command(characteristic->getData(), characteristic->getLength());
+    notifyStatus();
+  }
+
+  void onRead(BLECharacteristic* characteristic) {
+    ConfigTransferStatus status;
+    config_transfer_status(&status);
+    characteristic->setValue((uint8_t*)&status, sizeof(status));
+  }
+};
+
+// Chunks are not acknowledged one by one; the running CRC in the status
+// covers them all at COMMIT
+class DataCallbacks : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* characteristic) {
+    config_transfer_data(characteristic->getData(), characteristic->getLength());
+  }
+
+  void onRead(BLECharacteristic* characteristic) {
+    static uint8_t chunk[CONFIG_BLE_MTU - 3];
+    uint16_t mtu = configServer->getPeerMTU(configServer->getConnId());
+    uint32_t maxLen = mtu > 3 && mtu - 3u < sizeof(chunk) ? mtu - 3u : sizeof(chunk);
+    uint32_t len = config_transfer_read(chunk, maxLen);
+    characteristic->setValue(chunk, len);
+  }
+};
+
+void ble_config_link_down() {
+  config_transfer_abort();
+}
+
+void ble_config_setup(BLEServer* server) {
+  configServer = server;
+  BLEDevice::setMTU(CONFIG_BLE_MTU);
+  BLEService* service = server->createService(CONFIG_SERVICE_UUID);
+
+  control = service->createCharacteristic(
+      CONFIG_CONTROL_CHAR_UUID,
+      BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_NOTIFY);
+  control->addDescriptor(new BLE2902());
+  control->setCallbacks(new ControlCallbacks());
+
+  BLECharacteristic* data = service->createCharacteristic(
+      CONFIG_DATA_CHAR_UUID, BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE_NR);
+  data->setCallbacks(new DataCallbacks());
+
+  service->start();
+}
+
+bool ble_config_poll() {
+  if (config_transfer_expire(millis())) {
+    notifyStatus();  // CONFIG_XFER_ABANDONED, should the peer still be there
+    return false;
+  }
+
+  ConfigTransferStatus status;
+  config_transfer_status(&status);
+  if (status.state != CONFIG_XFER_COMMITTED) return false;
+
+  bool stored = config_transfer_poll();
+  notifyStatus();  // Success or CONFIG_XFER_FLASH
+  return stored;
+}
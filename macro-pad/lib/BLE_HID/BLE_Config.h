@@ -0,0 +1,27 @@
+#ifndef BLE_CONFIG_H
+#define BLE_CONFIG_H
+
+class BLEServer;
+
+// Custom configuration service: bulk transfer of config blobs, see
+// Config_Transfer.h for the protocol.
+//   control: write a command, read or subscribe for ConfigTransferStatus
+//   data:    write-without-response chunks in, read chunks out (up to MTU - 3)
+#define CONFIG_SERVICE_UUID      "4d500010-8c3b-4a5e-9f3c-6a5d1b2c3e4f"
+#define CONFIG_CONTROL_CHAR_UUID "4d500011-8c3b-4a5e-9f3c-6a5d1b2c3e4f"
+#define CONFIG_DATA_CHAR_UUID    "4d500012-8c3b-4a5e-9f3c-6a5d1b2c3e4f"
+
+// Largest ATT MTU offered to hosts; 517 lets one write carry 514 bytes
+#define CONFIG_BLE_MTU 517
+
+void ble_config_setup(BLEServer* server);
+
+// Loop task: store a committed transfer and report the result to the peer,
+// or abort one the peer has left idle (see CONFIG_XFER_IDLE_MS). Returns
+// true when a new config is active and should be applied.
+bool ble_config_poll();
+
+// BLE task: the link dropped, so any transfer is abandoned
+void ble_config_link_down();
+
+#endif // BLE_CONFIG_H
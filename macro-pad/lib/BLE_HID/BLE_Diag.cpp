@@ -0,0 +1,58 @@
+#include "BLE_Diag.h"
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include "Latency.h"
+#include "Conn_Params.h"
+#include "Reconnect.h"
+
+// Reading the latency characteristic returns the histograms as serialized
+// by latency_serialize(); the value is refreshed on every read.
+class LatencyReadCallbacks : public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* characteristic) {
+    static uint8_t buffer[LATENCY_SERIALIZED_LEN];
+    size_t len = latency_serialize(buffer, sizeof(buffer));
+    characteristic->setValue(buffer, len);
+  }
+};
+
+class ConnCallbacks : public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* characteristic) {
+    ConnParamsStatus status;
+    conn_params_status(&status);
+    characteristic->setValue((uint8_t*)&status, sizeof(status));
+  }
+
+  void onWrite(BLECharacteristic* characteristic) {
+    if (characteristic->getLength() >= 1) conn_params_select((ConnProfile)characteristic->getData()[0]);
+  }
+};
+
+class ReconnectCallbacks : public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* characteristic) {
+    ReconnectStats stats;
+    reconnect_get_stats(&stats);
+    characteristic->setValue((uint8_t*)&stats, sizeof(stats));
+  }
+
+  void onWrite(BLECharacteristic* characteristic) {
+    if (characteristic->getLength() >= 1) reconnect_select(characteristic->getData()[0]);
+  }
+};
+
+void ble_diag_setup(BLEServer* server) {
+  BLEService* service = server->createService(DIAG_SERVICE_UUID);
+
+  BLECharacteristic* latency = service->createCharacteristic(
+      DIAG_LATENCY_CHAR_UUID, BLECharacteristic::PROPERTY_READ);
+  latency->setCallbacks(new LatencyReadCallbacks());
+
+  BLECharacteristic* conn = service->createCharacteristic(
+      DIAG_CONN_CHAR_UUID, BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE);
+  conn->setCallbacks(new ConnCallbacks());
+
+  BLECharacteristic* reconnect = service->createCharacteristic(
+      DIAG_RECONNECT_CHAR_UUID, BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE);
+  reconnect->setCallbacks(new ReconnectCallbacks());
+
+  service->start();
+}
@@ -0,0 +1,18 @@
+#ifndef BLE_DIAG_H
+#define BLE_DIAG_H
+
+class BLEServer;
+
+// Custom diagnostics service for tooling
+//   latency:    read the histograms (see latency_serialize())
+//   connection: read ConnParamsStatus; write one byte to pin a ConnProfile,
+//               or CONN_PROFILE_AUTO (0xFF) to follow activity again
+//   reconnect:  read ReconnectStats; write one byte to switch host slot
+#define DIAG_SERVICE_UUID        "4d500001-8c3b-4a5e-9f3c-6a5d1b2c3e4f"
+#define DIAG_LATENCY_CHAR_UUID   "4d500002-8c3b-4a5e-9f3c-6a5d1b2c3e4f"
+#define DIAG_CONN_CHAR_UUID      "4d500003-8c3b-4a5e-9f3c-6a5d1b2c3e4f"
+#define DIAG_RECONNECT_CHAR_UUID "4d500004-8c3b-4a5e-9f3c-6a5d1b2c3e4f"
+
+void ble_diag_setup(BLEServer* server);
+
+#endif // BLE_DIAG_H
@@ -1,15 +1,61 @@
 #include "BLE_HID.h"
+#include "HID_Transport.h"
+#include "HID_Report.h"
+#include "Log.h"
+#include "BLE_Diag.h"
+#include "BLE_Config.h"
+#include "Conn_Params.h"
+#include "Reconnect.h"
+#include "Keymap.h"
 #include <BLEDevice.h>
 #include <BLEUtils.h>
 #include <BLEServer.h>
 #include <BLE2902.h>
 #include <BLEHIDDevice.h>
+#include <atomic>
 
 // BLE HID Objects
 static BLEHIDDevice* hid;
 static BLECharacteristic* keyboardInput;
 static BLECharacteristic* mediaInput;
+static BLECharacteristic* mouseInput;
+static BLECharacteristic* mouseFeature;
+#ifdef HID_ENABLE_NKRO
+static BLECharacteristic* nkroInput;
+#endif
 bool isConnected = false;
+static BLE2902* keyboardCccd;  // The host subscribing here means it is listening
+static BLEServer* server;
+static esp_bd_addr_t peerAddress;
+
+// Key changes are collected here and sent as one report by ble_hid_flush()
+static bool keyboardDirty = false;
+static uint32_t coalescedChanges = 0;
+
+// Resolution Multiplier feature as last written by the host: bits 0-1 the
+// wheel, bits 2-3 pan. Written on the BLE task, read on the loop task.
+static std::atomic<uint8_t> wheelMultiplier(0);
+
+// When the last scheduled media release goes out. A media press before
+// then waits for it: sent at once it would repeat the report the host
+// already holds, and be suppressed or merged into the earlier tap.
+// Cleared once passed, as 24.8 days on the comparison would turn around.
+static uint32_t mediaReleaseMs;
+static bool mediaReleasePending;
+
+// Delay that puts a media report after the scheduled release
+static int32_t mediaWaitMs() {
+  if (!mediaReleasePending) return 0;
+  int32_t wait = (int32_t)(mediaReleaseMs - millis());
+  if (wait > 0) return wait;
+  mediaReleasePending = false;
+  return 0;
+}
+
+// Fractions a host without the multiplier has not been sent yet
+static int32_t wheelRemainder[2];
+
+#define MOUSE_REPORT_LEN 7  // buttons, x, y, wheel (LE), pan (LE)
 
 // Combined HID Report Descriptor for Keyboard and Media Keys
 static const uint8_t hidReportDescriptor[] = {
@@ -41,10 +87,10 @@ static const uint8_t hidReportDescriptor[] = {
   0x95, 0x06,        //   Report Count (6)
   0x75, 0x08,        //   Report Size (8)
   0x15, 0x00,        //   Logical Minimum (0)
-  0x25, 0x65,        //   Logical Maximum (101)
+  0x26, 0xA4, 0x00,  //   Logical Maximum (164)
   0x05, 0x07,        //   Usage Page (Key Codes)
   0x19, 0x00,        //   Usage Minimum (0x00)
-  0x29, 0x65,        //   Usage Maximum (0x65)
+  0x29, 0xA4,        //   Usage Maximum (0xA4) - HID_KEY_EXSEL, the whole page
   0x81, 0x00,        //   Input (Data,Array,Abs,No Wrap,Linear,Preferred State,No Null Position)
   0xC0,              // End Collection (Keyboard)
   
@@ -61,61 +107,249 @@ static const uint8_t hidReportDescriptor[] = {
   0x2A, 0xFF, 0x03,  //   Usage Maximum (1023) - ...instead of a single unassigned usage.
   0x81, 0x00,        //   Input (Data,Array,Abs,No Wrap,Linear,Preferred State,No Null Position)
   0xC0,              // End Collection (Consumer Control)
-};
 
+  // Mouse Collection: only the wheels are used. Each sits in a logical
+  // collection with its own Resolution Multiplier; once the host sets it,
+  // one unit is 1/16 of a detent (HID_WHEEL_RESOLUTION).
+  0x05, 0x01,        // Usage Page (Generic Desktop Ctrls)
+  0x09, 0x02,        // Usage (Mouse)
+  0xA1, 0x01,        // Collection (Application)
+  0x85, 0x04,        //   Report ID (4)
+  0x09, 0x01,        //   Usage (Pointer)
+  0xA1, 0x00,        //   Collection (Physical)
+  0x05, 0x09,        //     Usage Page (Button)
+  0x19, 0x01,        //     Usage Minimum (1)
+  0x29, 0x03,        //     Usage Maximum (3)
+  0x15, 0x00,        //     Logical Minimum (0)
+  0x25, 0x01,        //     Logical Maximum (1)
+  0x95, 0x03,        //     Report Count (3)
+  0x75, 0x01,        //     Report Size (1)
+  0x81, 0x02,        //     Input (Data,Var,Abs)
+  0x95, 0x01,        //     Report Count (1)
+  0x75, 0x05,        //     Report Size (5)
+  0x81, 0x01,        //     Input (Const)
+  0x05, 0x01,        //     Usage Page (Generic Desktop Ctrls)
+  0x09, 0x30,        //     Usage (X)
+  0x09, 0x31,        //     Usage (Y)
+  0x15, 0x81,        //     Logical Minimum (-127)
+  0x25, 0x7F,        //     Logical Maximum (127)
+  0x75, 0x08,        //     Report Size (8)
+  0x95, 0x02,        //     Report Count (2)
+  0x81, 0x06,        //     Input (Data,Var,Rel)
+  0xA1, 0x02,        //     Collection (Logical)
+  0x09, 0x48,        //       Usage (Resolution Multiplier)
+  0x15, 0x00,        //       Logical Minimum (0)
+  0x25, 0x01,        //       Logical Maximum (1)
+  0x35, 0x01,        //       Physical Minimum (1)
+  0x45, 0x10,        //       Physical Maximum (16)
+  0x75, 0x02,        //       Report Size (2)
+  0x95, 0x01,        //       Report Count (1)
+  0xA4,              //       Push
+  0xB1, 0x02,        //       Feature (Data,Var,Abs)
+  0x09, 0x38,        //       Usage (Wheel)
+  0x16, 0x01, 0x80,  //       Logical Minimum (-32767)
+  0x26, 0xFF, 0x7F,  //       Logical Maximum (32767)
+  0x35, 0x00,        //       Physical Minimum (0)
+  0x45, 0x00,        //       Physical Maximum (0)
+  0x75, 0x10,        //       Report Size (16)
+  0x81, 0x06,        //       Input (Data,Var,Rel)
+  0xC0,              //     End Collection
+  0xA1, 0x02,        //     Collection (Logical)
+  0x09, 0x48,        //       Usage (Resolution Multiplier)
+  0xB4,              //       Pop
+  0xB1, 0x02,        //       Feature (Data,Var,Abs)
+  0x35, 0x00,        //       Physical Minimum (0)
+  0x45, 0x00,        //       Physical Maximum (0)
+  0x75, 0x04,        //       Report Size (4)
+  0xB1, 0x01,        //       Feature (Const)
+  0x05, 0x0C,        //       Usage Page (Consumer)
+  0x0A, 0x38, 0x02,  //       Usage (AC Pan)
+  0x16, 0x01, 0x80,  //       Logical Minimum (-32767)
+  0x26, 0xFF, 0x7F,  //       Logical Maximum (32767)
+  0x75, 0x10,        //       Report Size (16)
+  0x81, 0x06,        //       Input (Data,Var,Rel)
+  0xC0,              //     End Collection
+  0xC0,              //   End Collection (Physical)
+  0xC0,              // End Collection (Mouse)
 
+#ifdef HID_ENABLE_NKRO
+  // NKRO Keyboard Collection (one bit per usage)
+  0x05, 0x01,        // Usage Page (Generic Desktop Ctrls)
+  0x09, 0x06,        // Usage (Keyboard)
+  0xA1, 0x01,        // Collection (Application)
+  0x85, 0x03,        //   Report ID (3)
+  0x05, 0x07,        //   Usage Page (Key Codes)
+  0x19, 0xE0,        //   Usage Minimum (0xE0)
+  0x29, 0xE7,        //   Usage Maximum (0xE7)
+  0x15, 0x00,        //   Logical Minimum (0)
+  0x25, 0x01,        //   Logical Maximum (1)
+  0x75, 0x01,        //   Report Size (1)
+  0x95, 0x08,        //   Report Count (8)
+  0x81, 0x02,        //   Input (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+  0x19, 0x00,        //   Usage Minimum (0x00)
+  0x29, 0x77,        //   Usage Maximum (0x77) - HID_NKRO_USAGE_MAX
+  0x95, 0x78,        //   Report Count (120)
+  0x81, 0x02,        //   Input (Data,Var,Abs,No Wrap,Linear,Preferred State,No Null Position)
+  0xC0,              // End Collection (NKRO Keyboard)
+#endif
+};
 
-// Map characters to HID keycodes
-uint8_t charToHidCode(char c) {
-  switch (c) {
-    case 'a': return 0x04;
-    case 'b': return 0x05;
-    case 'c': return 0x06;
-    case 'd': return 0x07;
-    case 'e': return 0x08;
-    case 'f': return 0x09;
-    default: return 0x00; // No key pressed
-  }
-}
 
-// Map special codes to media keycodes
-uint16_t specialCodeToMediaCode(uint8_t code) {
-  switch (code) {
-    case KEY_PLAY_PAUSE: return 0xCD; // Play/Pause
-    case KEY_VOL_UP:     return 0xE9; // Volume Up
-    case KEY_VOL_DOWN:   return 0xEA; // Volume Down
-    default: return 0x00; // No media key
-  }
-}
 
 class MyServerCallbacks : public BLEServerCallbacks {
   void onConnect(BLEServer* pServer) {
     isConnected = true;
-    Serial.println("Device connected");
+    hid_transport_invalidate();  // The new host has no report state yet
+    LOG(LOG_EVT_CONNECTED);
+  }
+
+  // Called right after the plain onConnect(), with the peer's address
+  void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    memcpy(peerAddress, param->connect.remote_bda, sizeof(esp_bd_addr_t));
+    reconnect_link_up(peerAddress);
   }
 
+  // Advertising restarts from reconnect_poll(), aimed at the selected host
   void onDisconnect(BLEServer* pServer) {
     isConnected = false;
-    Serial.println("Device disconnected");
-    BLEDevice::startAdvertising();
-    Serial.println("Advertising restarted");
+    hid_transport_invalidate();  // Whatever was in flight went with the link
+    wheelMultiplier.store(0);  // Back to whole detents until the next host sets it
+    LOG(LOG_EVT_DISCONNECTED);
+    reconnect_link_down();
+    ble_config_link_down();  // An upload cut off here will never be committed
+  }
+};
+
+// Connection parameter updates, see Conn_Params.h. The answer comes back as
+// a GAP event on the BLE task, whether we or the host started the update.
+static bool requestConnParams(const ConnParams* params) {
+  if (!isConnected) return false;
+  server->updateConnParams(peerAddress, params->minInterval, params->maxInterval,
+                           params->latency, params->timeout);
+  return true;
+}
+
+// Pairing (and every later re-encryption) completes here too; the reconnect
+// manager learns which bonded host is on the link from it
+static void onGapEvent(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  switch (event) {
+    case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+      conn_params_negotiated(param->update_conn_params.status == ESP_BT_STATUS_SUCCESS,
+                             param->update_conn_params.conn_int, param->update_conn_params.latency,
+                             param->update_conn_params.timeout);
+      break;
+    case ESP_GAP_BLE_AUTH_CMPL_EVT:
+      if (param->ble_security.auth_cmpl.success) {
+        reconnect_bonded(param->ble_security.auth_cmpl.bd_addr, param->ble_security.auth_cmpl.addr_type);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// The host sets the Resolution Multiplier while it sets up the device
+class WheelFeatureCallbacks : public BLECharacteristicCallbacks {
+  void onWrite(BLECharacteristic* characteristic) {
+    if (characteristic->getLength() < 1) return;
+    wheelMultiplier.store(characteristic->getData()[0]);
+  }
+};
+
+// Host keys switch on press; the release does nothing
+static void handleHostKey(const KeyAction* action, bool pressed) {
+  if (pressed) reconnect_select(action->code);
+}
+
+// notify() reports its outcome through onStatus() before it returns, on
+// the same (transport) task
+static BLECharacteristicCallbacks::Status notifyStatus;
+
+class InputReportCallbacks : public BLECharacteristicCallbacks {
+  void onStatus(BLECharacteristic* characteristic, Status s, uint32_t code) {
+    notifyStatus = s;
   }
 };
 
+static bool isInputReport(uint16_t handle) {
+  if (handle == keyboardInput->getHandle() || handle == mediaInput->getHandle() ||
+      handle == mouseInput->getHandle()) {
+    return true;
+  }
+#ifdef HID_ENABLE_NKRO
+  if (handle == nkroInput->getHandle()) return true;
+#endif
+  return false;
+}
+
+// A notification has left the stack: its transport credit comes back.
+// Runs on the BLE task.
+static void onGattsEvent(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf, esp_ble_gatts_cb_param_t* param) {
+  if (event != ESP_GATTS_CONF_EVT || !isInputReport(param->conf.handle)) return;
+  hid_transport_tx_done();
+  hid_transport_wake();
+}
+
+// Transport sink: runs on the transport task, never on the loop task
+static HidSinkResult sendReport(const HidReport* report) {
+  if (!isConnected) return HID_SINK_DISCARDED;
+  BLECharacteristic* input;
+  switch (report->id) {
+    case HID_REPORT_ID_KEYBOARD: input = keyboardInput; break;
+    case HID_REPORT_ID_MEDIA:    input = mediaInput; break;
+    case HID_REPORT_ID_MOUSE:    input = mouseInput; break;
+#ifdef HID_ENABLE_NKRO
+    case HID_REPORT_ID_NKRO:     input = nkroInput; break;
+#endif
+    default: return HID_SINK_DISCARDED;
+  }
+  input->setValue((uint8_t*)report->data, report->len);
+  notifyStatus = BLECharacteristicCallbacks::ERROR_NO_CLIENT;
+  input->notify();
+  switch (notifyStatus) {
+    case BLECharacteristicCallbacks::SUCCESS_NOTIFY: return HID_SINK_SENT;
+    case BLECharacteristicCallbacks::ERROR_GATT:     return HID_SINK_BUSY;  // Out of buffers, or congested
+    default:                                         return HID_SINK_DISCARDED;
+  }
+}
+
 void ble_hid_setup() {
+  isConnected = false;
   BLEDevice::init("ESP32 HID Keypad");
   BLEServer *pServer = BLEDevice::createServer();
   pServer->setCallbacks(new MyServerCallbacks());
+  server = pServer;
+  conn_params_init(requestConnParams);
+  BLEDevice::setCustomGapHandler(onGapEvent);
+  BLEDevice::setCustomGattsHandler(onGattsEvent);
 
   hid = new BLEHIDDevice(pServer);
   hid->reportMap((uint8_t*)hidReportDescriptor, sizeof(hidReportDescriptor));
   hid->manufacturer()->setValue("ESP32 Keypad");
   hid->pnp(0x02, 0xe502, 0xa111, 0x0210);
 
-  keyboardInput = hid->inputReport(1);   // Report ID 1 (Keyboard)
-  mediaInput = hid->inputReport(2);      // Report ID 2 (Media Keys)
+  static InputReportCallbacks inputCallbacks;
+  keyboardInput = hid->inputReport(HID_REPORT_ID_KEYBOARD);   // Report ID 1 (Keyboard)
+  mediaInput = hid->inputReport(HID_REPORT_ID_MEDIA);         // Report ID 2 (Media Keys)
+  mouseInput = hid->inputReport(HID_REPORT_ID_MOUSE);         // Report ID 4 (Wheel)
+  keyboardInput->setCallbacks(&inputCallbacks);
+  mediaInput->setCallbacks(&inputCallbacks);
+  mouseInput->setCallbacks(&inputCallbacks);
+  mouseFeature = hid->featureReport(HID_REPORT_ID_MOUSE);     // Resolution Multiplier
+  uint8_t multiplier = 0;
+  mouseFeature->setValue(&multiplier, 1);
+  mouseFeature->setCallbacks(new WheelFeatureCallbacks());
+#ifdef HID_ENABLE_NKRO
+  nkroInput = hid->inputReport(HID_REPORT_ID_NKRO);           // Report ID 3 (NKRO Keyboard)
+  nkroInput->setCallbacks(&inputCallbacks);
+  keyboardCccd = (BLE2902*)nkroInput->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+#else
+  keyboardCccd = (BLE2902*)keyboardInput->getDescriptorByUUID(BLEUUID((uint16_t)0x2902));
+#endif
 
   hid->startServices();
+  ble_diag_setup(pServer);
+  ble_config_setup(pServer);
 
   BLESecurity *pSecurity = new BLESecurity();
   pSecurity->setAuthenticationMode(ESP_LE_AUTH_BOND);
@@ -129,61 +363,165 @@ void ble_hid_setup() {
   advertisementData.setCompleteServices(BLEUUID(hid->hidService()->getUUID()));
   advertisementData.setName("ESP32 HID Keypad");
   pAdvertising->setAdvertisementData(advertisementData);
-  
-  pAdvertising->start();
+
+  // Directed to the last host first, see Reconnect.h
+  reconnect_begin(pServer, millis());
+  keymap_set_handler(ACTION_HOST, handleHostKey);
 
   Serial.println("Advertising started. Connect to 'ESP32 HID Keypad'");
+
+  hid_report_reset();
+  wheelMultiplier.store(0);
+  memset(wheelRemainder, 0, sizeof(wheelRemainder));
+  hid_transport_set_relative(HID_REPORT_ID_MOUSE);
+  hid_transport_begin(sendReport);
 }
 
 bool ble_is_connected() {
   return isConnected;
 }
 
-void ble_send_key(char key, bool pressed) {
+bool ble_hid_ready() {
+  return isConnected && keyboardCccd && keyboardCccd->getNotifications();
+}
+
+void ble_send_key(uint8_t usage, bool pressed) {
   if (!isConnected) {
-    Serial.println("Not connected to any device");
+    LOG(LOG_EVT_NOT_CONNECTED);
     return;
   }
 
-  uint8_t hidCode = charToHidCode(key);
-  
-  if (pressed) {
-    // Key press report: modifier, reserved, key1, key2, key3, key4, key5, key6
-    uint8_t report[] = {0x00, 0x00, hidCode, 0x00, 0x00, 0x00, 0x00, 0x00};
-    keyboardInput->setValue(report, sizeof(report));
-    keyboardInput->notify();
-    Serial.print("Key pressed: ");
-    Serial.println(key);
-  } else {
-    // Key release report: all zeros except modifier and reserved
-    uint8_t report[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-    keyboardInput->setValue(report, sizeof(report));
-    keyboardInput->notify();
-    Serial.print("Key released: ");
-    Serial.println(key);
+  bool changed = pressed ? hid_report_press(usage) : hid_report_release(usage);
+  if (!changed) return;
+
+  // Only mark the report dirty; ble_hid_flush() sends one report per scan
+  if (keyboardDirty) coalescedChanges++;
+  keyboardDirty = true;
+}
+
+void ble_hid_flush() {
+  mediaWaitMs();  // Runs every loop, so a passed media release is always cleared in time
+  if (!keyboardDirty) return;
+  keyboardDirty = false;
+
+  // Report the whole held set, so rolling between keys never drops one
+  uint8_t report[HID_REPORT_MAX_LEN];
+#ifdef HID_ENABLE_NKRO
+  // Usages past the bitmap go in the boot report, sent only while it holds
+  // any or has just let the last of them go
+  static bool restHeld;
+  uint8_t rest[HID_BOOT_REPORT_LEN];
+  hid_report_build_nkro_rest(rest);
+  bool restNow = rest[2] != 0;
+  uint8_t len = hid_report_build_nkro(report);
+  bool queued = hid_transport_send(HID_REPORT_ID_NKRO, report, len);
+  if (queued && (restNow || restHeld)) {
+    queued = hid_transport_send(HID_REPORT_ID_KEYBOARD, rest, sizeof(rest));
+    if (queued) restHeld = restNow;
   }
+#else
+  uint8_t len = hid_report_build_boot(report);
+  bool queued = hid_transport_send(HID_REPORT_ID_KEYBOARD, report, len);
+#endif
+  // No room: the report is rebuilt from the held set on the next flush
+  if (!queued) {
+    keyboardDirty = true;
+    return;
+  }
+  hid_transport_wake();
+}
+
+void ble_hid_release_all() {
+  hid_report_reset();
+  keyboardDirty = true;
+  ble_hid_flush();
+}
+
+uint32_t ble_notifies_saved() {
+  HidTransportStats stats;
+  hid_transport_get_stats(&stats);
+  return coalescedChanges + stats.suppressed;
 }
 
 void ble_send_media_key(uint16_t keyCode) {
-  if (!isConnected) return;
   if (!isConnected) {
-    Serial.println("Not connected to any device");
+    LOG(LOG_EVT_NOT_CONNECTED);
     return;
   }
 
   // Convert the 16-bit key code to bytes (little-endian)
   uint8_t report[2] = {static_cast<uint8_t>(keyCode & 0xFF), static_cast<uint8_t>((keyCode >> 8) & 0xFF)};
-  mediaInput->setValue(report, sizeof(report));
-  mediaInput->notify();
+  int32_t wait = mediaWaitMs();
+  if (wait > UINT16_MAX - MEDIA_KEY_HOLD_MS) return;  // The release could not be scheduled
+  if (!hid_transport_send(HID_REPORT_ID_MEDIA, report, sizeof(report), wait)) return;
   
-  Serial.print("Media key sent: 0x");
-  Serial.println(keyCode, HEX);
+  LOG(LOG_EVT_MEDIA_KEY, keyCode, 1);
   
-  // Send a release report after a short delay
-  delay(50);
+  // Schedule the release on the transport's timer wheel instead of blocking
   uint8_t release[2] = {0x00, 0x00};
-  mediaInput->setValue(release, sizeof(release));
-  mediaInput->notify();
+  hid_transport_send(HID_REPORT_ID_MEDIA, release, sizeof(release), wait + MEDIA_KEY_HOLD_MS);
+  mediaReleaseMs = millis() + wait + MEDIA_KEY_HOLD_MS;
+  mediaReleasePending = true;
+  hid_transport_wake();
 }
 
+uint8_t ble_send_media_burst(uint16_t keyCode, uint8_t count) {
+  if (!isConnected) return count;
 
+  // Back-to-back press/release pairs; the transport keeps them in order. A
+  // press it refuses ends the burst, and its release always fits. Nothing
+  // goes ahead of a tap's scheduled release.
+  if (mediaWaitMs()) return 0;
+  uint8_t report[2] = {static_cast<uint8_t>(keyCode & 0xFF), static_cast<uint8_t>((keyCode >> 8) & 0xFF)};
+  uint8_t release[2] = {0x00, 0x00};
+  uint8_t sent = 0;
+  while (sent < count && hid_transport_send(HID_REPORT_ID_MEDIA, report, sizeof(report))) {
+    hid_transport_send(HID_REPORT_ID_MEDIA, release, sizeof(release));
+    sent++;
+  }
+  if (sent) {
+    LOG(LOG_EVT_MEDIA_KEY, keyCode, sent);
+    hid_transport_wake();
+  }
+  return sent;
+}
+
+bool ble_wheel_hires() {
+  return wheelMultiplier.load() & 0x03;
+}
+
+// Units to send on one axis: all of them with the multiplier on, otherwise
+// whole detents with the fraction kept, dropped when the direction turns
+static int32_t wheelUnits(int32_t amount, bool hires, int32_t* remainder) {
+  if (hires) return amount;
+  if ((*remainder ^ amount) < 0) *remainder = 0;
+  *remainder += amount;
+  int32_t detents = *remainder / HID_WHEEL_RESOLUTION;
+  *remainder -= detents * HID_WHEEL_RESOLUTION;
+  return detents;
+}
+
+static inline int16_t clampAxis(int32_t units) {
+  if (units > 32767) return 32767;
+  if (units < -32767) return -32767;
+  return (int16_t)units;
+}
+
+bool ble_send_wheel(int32_t vertical, int32_t horizontal) {
+  if (!isConnected) return true;
+  if (hid_transport_press_room() == 0) return false;
+
+  uint8_t multiplier = wheelMultiplier.load();
+  int16_t wheel = clampAxis(wheelUnits(vertical, multiplier & 0x03, &wheelRemainder[0]));
+  int16_t pan = clampAxis(wheelUnits(horizontal, multiplier & 0x0C, &wheelRemainder[1]));
+  if (wheel == 0 && pan == 0) return true;
+
+  uint8_t report[MOUSE_REPORT_LEN] = {
+    0, 0, 0,  // No buttons, no pointer movement
+    static_cast<uint8_t>(wheel & 0xFF), static_cast<uint8_t>((wheel >> 8) & 0xFF),
+    static_cast<uint8_t>(pan & 0xFF), static_cast<uint8_t>((pan >> 8) & 0xFF),
+  };
+  hid_transport_send(HID_REPORT_ID_MOUSE, report, sizeof(report));
+  hid_transport_wake();
+  return true;
+}
@@ -2,16 +2,38 @@
 #define BLE_HID_H
 
 #include <Arduino.h>
+#include "HID_Usages.h"
 
-// Define keys - use special codes for media keys
-#define KEY_PLAY_PAUSE 0x01
-#define KEY_VOL_UP     0x02
-#define KEY_VOL_DOWN   0x03
+// Report IDs in hidReportDescriptor
+#define HID_REPORT_ID_KEYBOARD 1
+#define HID_REPORT_ID_MEDIA    2
+#define HID_REPORT_ID_NKRO     3  // Only present with HID_ENABLE_NKRO
+#define HID_REPORT_ID_MOUSE    4  // Wheel and pan, with a Resolution Multiplier feature
+
+// Wheel units per detent once the host enables the Resolution Multiplier
+#define HID_WHEEL_RESOLUTION 16
+
+// How long a media key is held before its release report is sent
+#define MEDIA_KEY_HOLD_MS 20
 
 void ble_hid_setup();
 bool ble_is_connected();
-void ble_send_key(char key, bool pressed);
+bool ble_hid_ready();  // Connected, and the host has subscribed to key reports
+void ble_send_key(uint8_t usage, bool pressed);  // keyboard usage, see HID_Usages.h
+void ble_hid_flush();  // Send pending key changes as one report
+void ble_hid_release_all();  // Release every key and modifier on the host
+uint32_t ble_notifies_saved();
 void ble_send_media_key(uint16_t keyCode);
-uint16_t specialCodeToMediaCode(uint8_t code);
+// count taps in one burst; returns the taps queued, fewer when the
+// transport pushes back (see HID_Transport.h) and none while a tap from
+// ble_send_media_key() has not been released yet
+uint8_t ble_send_media_burst(uint16_t keyCode, uint8_t count);
+
+// Scroll by the given amounts in 1/HID_WHEEL_RESOLUTION detents, positive
+// up and right, in one report. Hosts that have not enabled the Resolution
+// Multiplier get whole detents, the remainder kept for the next call.
+// Returns false, having sent nothing, when the transport pushes back.
+bool ble_send_wheel(int32_t vertical, int32_t horizontal);
+bool ble_wheel_hires();  // The host enabled the multiplier for the wheel
 
 #endif // BLE_HID_H
\ No newline at end of file
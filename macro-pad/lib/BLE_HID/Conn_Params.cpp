@@ -0,0 +1,111 @@
+#include "Conn_Params.h"
+#include "Log.h"
+#include <atomic>
+#include <string.h>
+
+static const ConnParams profiles[CONN_PROFILE_COUNT] = {
+  {6, 9, 0, 400},     // LOW_LATENCY: 7.5-11.25 ms, 4 s timeout
+  {24, 40, 0, 500},   // BALANCED: 30-50 ms, 5 s timeout
+  {80, 100, 4, 600},  // IDLE: 100-125 ms, up to 625 ms between replies, 6 s timeout
+};
+
+static const char* const profileNames[CONN_PROFILE_COUNT] = {
+  "low-latency",
+  "balanced",
+  "idle",
+};
+
+static ConnParamsRequest request;
+static bool connected;
+static uint32_t lastInputMs;
+static uint32_t lastRequestMs;
+static std::atomic<bool> awaitingHost(false);  // Cleared by the BLE stack's callback
+static uint8_t forced = CONN_PROFILE_AUTO;
+static uint8_t requested = CONN_PROFILE_COUNT;  // none yet
+static ConnParamsStatus status;
+
+void conn_params_init(ConnParamsRequest sender) {
+  request = sender;
+  connected = false;
+  awaitingHost.store(false);
+  forced = CONN_PROFILE_AUTO;
+  requested = CONN_PROFILE_COUNT;
+  memset(&status, 0, sizeof(status));
+  status.forced = CONN_PROFILE_AUTO;
+}
+
+const ConnParams* conn_params_profile(ConnProfile profile) {
+  return profile < CONN_PROFILE_COUNT ? &profiles[profile] : nullptr;
+}
+
+const char* conn_profile_name(ConnProfile profile) {
+  return profile < CONN_PROFILE_COUNT ? profileNames[profile] : "auto";
+}
+
+void conn_params_activity(uint32_t nowMs) {
+  lastInputMs = nowMs;
+}
+
+static ConnProfile wanted(uint32_t nowMs) {
+  if (forced != CONN_PROFILE_AUTO) return (ConnProfile)forced;
+  uint32_t idleMs = nowMs - lastInputMs;
+  if (idleMs >= CONN_IDLE_AFTER_MS) return CONN_PROFILE_IDLE;
+  if (idleMs >= CONN_BALANCED_AFTER_MS) return CONN_PROFILE_BALANCED;
+  return CONN_PROFILE_LOW_LATENCY;
+}
+
+void conn_params_poll(bool isConnected, uint32_t nowMs) {
+  if (isConnected != connected) {
+    connected = isConnected;
+    awaitingHost.store(false);
+    requested = CONN_PROFILE_COUNT;
+    status.interval = status.latency = status.timeout = 0;
+    lastInputMs = nowMs;
+  }
+  if (!connected) return;
+
+  if (awaitingHost.load()) {
+    if (nowMs - lastRequestMs < CONN_UPDATE_TIMEOUT_MS) return;
+    awaitingHost.store(false);
+    status.failures++;
+  }
+
+  ConnProfile profile = wanted(nowMs);
+  if (profile == requested) return;
+  if (requested != CONN_PROFILE_COUNT && nowMs - lastRequestMs < CONN_UPDATE_GAP_MS) return;
+
+  lastRequestMs = nowMs;
+  requested = profile;
+  status.profile = profile;
+  status.requests++;
+  LOG(LOG_EVT_CONN_PROFILE, profile, profiles[profile].minInterval * 1250, profiles[profile].maxInterval * 1250);
+
+  // Set first: the answer can arrive before request() returns
+  awaitingHost.store(true);
+  if (!request(&profiles[profile])) {
+    awaitingHost.store(false);
+    status.failures++;
+  }
+}
+
+void conn_params_select(ConnProfile profile) {
+  forced = profile < CONN_PROFILE_COUNT ? profile : CONN_PROFILE_AUTO;
+  status.forced = forced;
+}
+
+void conn_params_negotiated(bool ok, uint16_t interval, uint16_t latency, uint16_t timeout) {
+  awaitingHost.store(false);
+  if (!ok) {
+    status.failures++;
+    return;
+  }
+  status.interval = interval;
+  status.latency = latency;
+  status.timeout = timeout;
+  status.updates++;
+  LOG(LOG_EVT_CONN_UPDATED, interval * 1250, latency, timeout * 10);
+}
+
+void conn_params_status(ConnParamsStatus* out) {
+  *out = status;
+}
@@ -0,0 +1,67 @@
+#ifndef CONN_PARAMS_H
+#define CONN_PARAMS_H
+
+#include <stdint.h>
+
+// --- Connection Parameter Profiles ---
+// Intervals are in 1.25 ms units and the supervision timeout in 10 ms units,
+// as on the air. The host picks the interval within [min, max] and may
+// refuse; what it settled on is reported back through conn_params_negotiated().
+enum ConnProfile : uint8_t {
+  CONN_PROFILE_LOW_LATENCY,  // Typing: 7.5 ms (Apple hosts settle on 11.25 ms)
+  CONN_PROFILE_BALANCED,     // Recently used: 30-50 ms
+  CONN_PROFILE_IDLE,         // Untouched: 100-125 ms, may skip 4 events
+  CONN_PROFILE_COUNT,
+  CONN_PROFILE_AUTO = 0xFF,  // conn_params_select(): follow activity again
+};
+
+struct ConnParams {
+  uint16_t minInterval;
+  uint16_t maxInterval;
+  uint16_t latency;   // Connection events the peripheral may skip
+  uint16_t timeout;
+};
+
+#define CONN_BALANCED_AFTER_MS  5000    // No input for this long: LOW_LATENCY -> BALANCED
+#define CONN_IDLE_AFTER_MS      60000   // ... and this long: -> IDLE
+#define CONN_UPDATE_GAP_MS      1000    // At most one update request per gap
+#define CONN_UPDATE_TIMEOUT_MS  5000    // Give up waiting for the host's answer
+
+// What diagnostics report, little-endian
+struct ConnParamsStatus {
+  uint8_t profile;         // Profile last requested
+  uint8_t forced;          // Profile chosen by conn_params_select(), or CONN_PROFILE_AUTO
+  uint16_t interval;       // Negotiated, 1.25 ms units; 0 before the first update
+  uint16_t latency;        // Negotiated
+  uint16_t timeout;        // Negotiated, 10 ms units
+  uint32_t requests;       // Update requests sent
+  uint32_t updates;        // Updates the host completed
+  uint32_t failures;       // Rejected or timed out
+};
+
+static_assert(sizeof(ConnParamsStatus) == 20, "ConnParamsStatus is sent as is");
+
+// Sends an update request for the current connection; false if it could not
+typedef bool (*ConnParamsRequest)(const ConnParams* params);
+
+// Portable core (no Arduino dependency). Call from the loop task, except
+// conn_params_negotiated() and conn_params_select(), which BLE callbacks may call.
+void conn_params_init(ConnParamsRequest request);
+const ConnParams* conn_params_profile(ConnProfile profile);
+
+void conn_params_activity(uint32_t nowMs);
+
+// Request the profile that fits the time since the last input. A new
+// connection starts at LOW_LATENCY, as if a key had just been pressed.
+void conn_params_poll(bool connected, uint32_t nowMs);
+
+// Pin a profile, or pass CONN_PROFILE_AUTO to follow activity again
+void conn_params_select(ConnProfile profile);
+
+// The host finished (ok) or refused an update
+void conn_params_negotiated(bool ok, uint16_t interval, uint16_t latency, uint16_t timeout);
+
+void conn_params_status(ConnParamsStatus* status);
+const char* conn_profile_name(ConnProfile profile);
+
+#endif // CONN_PARAMS_H
@@ -0,0 +1,109 @@
+#include "HID_Report.h"
+#include <string.h>
+
+// Held keys are kept twice: as a bitmap for O(1) membership and NKRO
+// reports, and in press order so boot report slots stay stable.
+static uint8_t heldBitmap[32];
+static uint8_t heldOrder[HID_MAX_HELD_KEYS];
+static uint8_t heldCount;
+static uint8_t modifiers;
+static bool overflow;  // more keys held than heldOrder can track
+
+static inline bool isModifier(uint8_t usage) {
+  return usage >= HID_USAGE_MODIFIER_FIRST && usage <= HID_USAGE_MODIFIER_LAST;
+}
+
+void hid_report_reset() {
+  memset(heldBitmap, 0, sizeof(heldBitmap));
+  heldCount = 0;
+  modifiers = 0;
+  overflow = false;
+}
+
+bool hid_report_is_held(uint8_t usage) {
+  return (heldBitmap[usage >> 3] >> (usage & 7)) & 1;
+}
+
+bool hid_report_press(uint8_t usage) {
+  if (usage == 0 || hid_report_is_held(usage)) return false;
+  heldBitmap[usage >> 3] |= 1 << (usage & 7);
+
+  if (isModifier(usage)) {
+    modifiers |= 1 << (usage - HID_USAGE_MODIFIER_FIRST);
+  } else if (heldCount < HID_MAX_HELD_KEYS) {
+    heldOrder[heldCount++] = usage;
+  } else {
+    overflow = true;
+  }
+  return true;
+}
+
+bool hid_report_release(uint8_t usage) {
+  if (usage == 0 || !hid_report_is_held(usage)) return false;
+  heldBitmap[usage >> 3] &= ~(1 << (usage & 7));
+
+  if (isModifier(usage)) {
+    modifiers &= ~(1 << (usage - HID_USAGE_MODIFIER_FIRST));
+    return true;
+  }
+
+  for (uint8_t i = 0; i < heldCount; i++) {
+    if (heldOrder[i] == usage) {
+      memmove(&heldOrder[i], &heldOrder[i + 1], heldCount - i - 1);
+      heldCount--;
+      break;
+    }
+  }
+  if (overflow && heldCount < HID_MAX_HELD_KEYS) {
+    // Rebuild the order list from the bitmap once there is room again
+    heldCount = 0;
+    for (uint16_t u = 1; u < HID_USAGE_MODIFIER_FIRST && heldCount < HID_MAX_HELD_KEYS; u++) {
+      if (hid_report_is_held(u)) heldOrder[heldCount++] = u;
+    }
+    overflow = heldCount == HID_MAX_HELD_KEYS;
+  }
+  return true;
+}
+
+uint8_t hid_report_modifiers() {
+  return modifiers;
+}
+
+uint8_t hid_report_held_count() {
+  return heldCount;
+}
+
+uint8_t hid_report_build_boot(uint8_t* out) {
+  memset(out, 0, HID_BOOT_REPORT_LEN);
+  out[0] = modifiers;
+
+  if (overflow || heldCount > HID_BOOT_KEY_SLOTS) {
+    memset(&out[2], HID_USAGE_ERROR_ROLLOVER, HID_BOOT_KEY_SLOTS);
+  } else {
+    memcpy(&out[2], heldOrder, heldCount);
+  }
+  return HID_BOOT_REPORT_LEN;
+}
+
+uint8_t hid_report_build_nkro(uint8_t* out) {
+  out[0] = modifiers;
+  memcpy(&out[1], heldBitmap, HID_NKRO_BITMAP_LEN);
+  // Usage 0 is "no event" and the last byte may hold bits past the range
+  out[1] &= ~1;
+  out[HID_NKRO_BITMAP_LEN] &= (1 << ((HID_NKRO_USAGE_MAX & 7) + 1)) - 1;
+  return HID_NKRO_REPORT_LEN;
+}
+
+uint8_t hid_report_build_nkro_rest(uint8_t* out) {
+  memset(out, 0, HID_BOOT_REPORT_LEN);
+  uint8_t slots = 0;
+  for (uint16_t u = HID_NKRO_USAGE_MAX + 1; u <= HID_BOOT_USAGE_MAX; u++) {
+    if (!hid_report_is_held(u)) continue;
+    if (slots == HID_BOOT_KEY_SLOTS) {
+      memset(&out[2], HID_USAGE_ERROR_ROLLOVER, HID_BOOT_KEY_SLOTS);
+      break;
+    }
+    out[2 + slots++] = u;
+  }
+  return HID_BOOT_REPORT_LEN;
+}
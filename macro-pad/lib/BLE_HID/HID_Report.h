@@ -0,0 +1,49 @@
+#ifndef HID_REPORT_H
+#define HID_REPORT_H
+
+#include <stdint.h>
+
+// --- Keyboard Report State ---
+// Define HID_ENABLE_NKRO (build_flags = -DHID_ENABLE_NKRO) to add the NKRO
+// bitmap collection to hidReportDescriptor and send keys through it. The
+// bitmap stops at HID_NKRO_USAGE_MAX so its report fits one notification at
+// the default MTU; usages past it up to HID_BOOT_USAGE_MAX (Stop, the
+// editing keys, Mute, international and language keys) go out in the boot
+// report alongside.
+#define HID_BOOT_REPORT_LEN  8    // modifier, reserved, 6 key slots
+#define HID_BOOT_KEY_SLOTS   6
+#define HID_MAX_HELD_KEYS    16   // keys tracked in press order for the boot report
+#define HID_NKRO_USAGE_MAX   0x77 // last usage covered by the NKRO bitmap
+#define HID_BOOT_USAGE_MAX   0xA4 // last usage the boot report declares
+#define HID_NKRO_BITMAP_LEN  ((HID_NKRO_USAGE_MAX + 8) / 8)
+#define HID_NKRO_REPORT_LEN  (1 + HID_NKRO_BITMAP_LEN)  // modifier byte + bitmap
+
+#define HID_USAGE_ERROR_ROLLOVER 0x01
+#define HID_USAGE_MODIFIER_FIRST 0xE0
+#define HID_USAGE_MODIFIER_LAST  0xE7
+
+// Clear all held keys and modifiers
+void hid_report_reset();
+
+// Track a key or modifier (0xE0-0xE7) going down or up.
+// Returns false when the held set did not change.
+bool hid_report_press(uint8_t usage);
+bool hid_report_release(uint8_t usage);
+
+bool hid_report_is_held(uint8_t usage);
+uint8_t hid_report_modifiers();
+uint8_t hid_report_held_count();
+
+// Build a 6KRO boot report from the held set. More than six held keys
+// produce ErrorRollOver in every slot, as the HID spec requires.
+uint8_t hid_report_build_boot(uint8_t* out);
+
+// Build an NKRO report: modifier byte followed by one bit per usage
+uint8_t hid_report_build_nkro(uint8_t* out);
+
+// Build the boot report that goes with an NKRO report: held usages past
+// HID_NKRO_USAGE_MAX, up to HID_BOOT_USAGE_MAX, and no modifiers, which the NKRO report carries. More
+// than six produce ErrorRollOver, as in hid_report_build_boot().
+uint8_t hid_report_build_nkro_rest(uint8_t* out);
+
+#endif // HID_REPORT_H
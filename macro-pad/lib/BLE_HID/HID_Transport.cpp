@@ -0,0 +1,349 @@
+#include "HID_Transport.h"
+#include "Latency.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+struct QueuedReport {
+  HidReport report;
+  uint16_t delayMs;
+};
+
+// Single producer (loop task) / single consumer (transport task) queue
+static QueuedReport queue[HID_TRANSPORT_QUEUE_LEN];
+static std::atomic<uint8_t> queueHead(0);
+static std::atomic<uint8_t> queueTail(0);
+
+// Hashed timer wheel, owned by the consumer. Each slot holds a FIFO list of
+// pool entries; rounds counts the full wheel turns left before an entry is due.
+struct WheelEntry {
+  HidReport report;
+  uint16_t rounds;
+  int8_t next;
+};
+
+static WheelEntry wheelPool[HID_WHEEL_CAPACITY];
+static int8_t wheelFree;
+static int8_t slotHead[HID_WHEEL_SLOTS];
+static int8_t slotTail[HID_WHEEL_SLOTS];
+static uint32_t wheelTick;  // last millisecond processed
+
+// Entries that are due, in order, waiting for a credit
+static int8_t readyHead;
+static int8_t readyTail;
+
+// Last report handed to the sink per report ID, for duplicate suppression
+static HidReport lastSent[HID_MAX_REPORT_ID + 1];
+static std::atomic<bool> lastSentValid(false);
+
+// Report IDs that carry relative data: two equal reports are two movements
+static uint8_t relativeIds;
+
+// Credits: in flight is handedOut - txDone. handedOut belongs to the
+// consumer; txDone is counted on the BLE task.
+static uint32_t handedOut;
+static std::atomic<uint32_t> txDone(0);
+static std::atomic<bool> creditsValid(false);
+static uint32_t stallDone;     // txDone when the credits last ran out
+static uint32_t stallSinceMs;
+static bool stalled;
+
+static HidReportSink reportSink;
+
+// The producer counts queued, dropped and refused and keeps maxQueueDepth;
+// the consumer keeps the rest. Each field has one writer, and all are
+// atomic so a snapshot from another task is never torn.
+struct SharedStats {
+  std::atomic<uint32_t> queued;
+  std::atomic<uint32_t> sent;
+  std::atomic<uint32_t> scheduled;
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> refused;
+  std::atomic<uint32_t> retried;
+  std::atomic<uint32_t> stalls;
+  std::atomic<uint32_t> suppressed;
+  std::atomic<uint8_t> maxQueueDepth;
+  std::atomic<uint8_t> maxInFlight;
+};
+static SharedStats stats;
+
+static inline void count(std::atomic<uint32_t>& counter) {
+  counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+static inline void raise(std::atomic<uint8_t>& high, uint8_t value) {
+  if (value > high.load(std::memory_order_relaxed)) high.store(value, std::memory_order_relaxed);
+}
+
+static inline uint8_t inFlight() {
+  return (uint8_t)(handedOut - txDone.load(std::memory_order_acquire));
+}
+
+// Returns false when the report has to wait: out of credits, or the stack
+// refused it. Everything else (sent, suppressed, discarded) is done with.
+static bool deliver(const HidReport* report) {
+  if (!lastSentValid.exchange(true)) {
+    memset(lastSent, 0, sizeof(lastSent));
+  }
+  bool tracked = report->id <= HID_MAX_REPORT_ID && !((relativeIds >> report->id) & 1);
+  if (tracked) {
+    const HidReport& last = lastSent[report->id];
+    if (last.len == report->len && memcmp(last.data, report->data, report->len) == 0) {
+      count(stats.suppressed);
+      return true;
+    }
+  }
+  if (inFlight() >= HID_TX_CREDITS) return false;
+
+  HidSinkResult result = reportSink(report);
+  if (result == HID_SINK_BUSY) {
+    count(stats.retried);
+    return false;
+  }
+  if (tracked) lastSent[report->id] = *report;
+  if (result == HID_SINK_SENT) {
+    handedOut++;
+    raise(stats.maxInFlight, inFlight());
+  }
+  count(stats.sent);
+
+  if (report->traced) {
+    uint32_t now = latency_now();
+    latency_record(LATENCY_NOTIFY, report->buildCycles, now);
+    latency_record(LATENCY_TOTAL, report->detectCycles, now);
+  }
+  return true;
+}
+
+// A release clears everything its report carries, so it is all zero
+static bool isRelease(const uint8_t* data, uint8_t len) {
+  for (uint8_t i = 0; i < len; i++) {
+    if (data[i]) return false;
+  }
+  return true;
+}
+
+static bool wheelInsert(const HidReport* report, uint16_t delayMs) {
+  if (wheelFree < 0) return false;
+  int8_t e = wheelFree;
+  wheelFree = wheelPool[e].next;
+
+  uint32_t due = wheelTick + delayMs;
+  uint8_t slot = due % HID_WHEEL_SLOTS;
+  wheelPool[e].report = *report;
+  wheelPool[e].rounds = (delayMs - 1) / HID_WHEEL_SLOTS;
+  wheelPool[e].next = -1;
+
+  if (slotTail[slot] < 0) {
+    slotHead[slot] = e;
+  } else {
+    wheelPool[slotTail[slot]].next = e;
+  }
+  slotTail[slot] = e;
+  return true;
+}
+
+// Move everything due in one slot to the ready list, keeping the order
+// reports were scheduled in
+static void wheelExpire(uint8_t slot) {
+  int8_t prev = -1;
+  int8_t e = slotHead[slot];
+  while (e >= 0) {
+    int8_t next = wheelPool[e].next;
+    if (wheelPool[e].rounds > 0) {
+      wheelPool[e].rounds--;
+      prev = e;
+    } else {
+      if (prev < 0) slotHead[slot] = next; else wheelPool[prev].next = next;
+      if (slotTail[slot] == e) slotTail[slot] = prev;
+      wheelPool[e].next = -1;
+      if (readyTail < 0) readyHead = e; else wheelPool[readyTail].next = e;
+      readyTail = e;
+    }
+    e = next;
+  }
+}
+
+// Send due entries until one has to wait. Returns true when all went out.
+static bool drainReady() {
+  while (readyHead >= 0) {
+    int8_t e = readyHead;
+    if (!deliver(&wheelPool[e].report)) return false;
+    readyHead = wheelPool[e].next;
+    if (readyHead < 0) readyTail = -1;
+    wheelPool[e].next = wheelFree;
+    wheelFree = e;
+  }
+  return true;
+}
+
+// Take the credits back when none has come back for HID_TX_STALL_MS, so a
+// lost completion cannot stop the transport for good
+static void checkStall(uint32_t nowMs) {
+  uint32_t done = txDone.load(std::memory_order_acquire);
+  if ((uint8_t)(handedOut - done) < HID_TX_CREDITS) {
+    stalled = false;
+    return;
+  }
+  if (!stalled || done != stallDone) {
+    stalled = true;
+    stallDone = done;
+    stallSinceMs = nowMs;
+  } else if (nowMs - stallSinceMs >= HID_TX_STALL_MS) {
+    handedOut = done;
+    stalled = false;
+    count(stats.stalls);
+  }
+}
+
+void hid_transport_init(HidReportSink sink, uint32_t nowMs) {
+  reportSink = sink;
+  queueHead.store(0);
+  queueTail.store(0);
+
+  for (uint8_t i = 0; i < HID_WHEEL_CAPACITY; i++) {
+    wheelPool[i].next = (i + 1 < HID_WHEEL_CAPACITY) ? i + 1 : -1;
+  }
+  wheelFree = 0;
+  memset(slotHead, -1, sizeof(slotHead));
+  memset(slotTail, -1, sizeof(slotTail));
+  readyHead = readyTail = -1;
+  wheelTick = nowMs;
+
+  lastSentValid.store(false);
+  handedOut = txDone.load();
+  creditsValid.store(true);
+  stalled = false;
+  stats.queued.store(0, std::memory_order_relaxed);
+  stats.sent.store(0, std::memory_order_relaxed);
+  stats.scheduled.store(0, std::memory_order_relaxed);
+  stats.dropped.store(0, std::memory_order_relaxed);
+  stats.refused.store(0, std::memory_order_relaxed);
+  stats.retried.store(0, std::memory_order_relaxed);
+  stats.stalls.store(0, std::memory_order_relaxed);
+  stats.suppressed.store(0, std::memory_order_relaxed);
+  stats.maxQueueDepth.store(0, std::memory_order_relaxed);
+  stats.maxInFlight.store(0, std::memory_order_relaxed);
+}
+
+bool hid_transport_send(uint8_t reportId, const uint8_t* data, uint8_t len, uint16_t delayMs) {
+  if (len > HID_REPORT_MAX_LEN) return false;
+
+  uint8_t head = queueHead.load(std::memory_order_relaxed);
+  uint8_t tail = queueTail.load(std::memory_order_acquire);
+  uint8_t next = (head + 1) & (HID_TRANSPORT_QUEUE_LEN - 1);
+  if (next == tail) {
+    count(stats.dropped);
+    return false;
+  }
+  uint8_t free = HID_TRANSPORT_QUEUE_LEN - 1 - ((head - tail) & (HID_TRANSPORT_QUEUE_LEN - 1));
+  if (free <= HID_RELEASE_RESERVE && !isRelease(data, len)) {
+    count(stats.refused);
+    return false;
+  }
+
+  QueuedReport& q = queue[head];
+  q.report.id = reportId;
+  q.report.len = len;
+  memcpy(q.report.data, data, len);
+  q.delayMs = delayMs;
+
+  // The first report after an input event closes its build stage
+  uint32_t acceptCycles;
+  q.report.traced = latency_take_input(&q.report.detectCycles, &acceptCycles);
+  if (q.report.traced) {
+    q.report.buildCycles = latency_now();
+    latency_record(LATENCY_BUILD, acceptCycles, q.report.buildCycles);
+  }
+  queueHead.store(next, std::memory_order_release);
+
+  raise(stats.maxQueueDepth, (next - tail) & (HID_TRANSPORT_QUEUE_LEN - 1));
+  count(stats.queued);
+  return true;
+}
+
+uint8_t hid_transport_queue_free() {
+  uint8_t head = queueHead.load(std::memory_order_relaxed);
+  uint8_t tail = queueTail.load(std::memory_order_acquire);
+  return HID_TRANSPORT_QUEUE_LEN - 1 - ((head - tail) & (HID_TRANSPORT_QUEUE_LEN - 1));
+}
+
+uint8_t hid_transport_press_room() {
+  uint8_t free = hid_transport_queue_free();
+  return free > HID_RELEASE_RESERVE ? free - HID_RELEASE_RESERVE : 0;
+}
+
+void hid_transport_poll(uint32_t nowMs) {
+  if (!creditsValid.exchange(true)) {
+    handedOut = txDone.load();  // A new link starts with empty stack buffers
+    stalled = false;
+  }
+  checkStall(nowMs);
+
+  // Timed follow-ups were scheduled before anything still in the queue
+  while ((int32_t)(nowMs - wheelTick) > 0) {
+    wheelTick++;
+    wheelExpire(wheelTick % HID_WHEEL_SLOTS);
+  }
+  if (!drainReady()) return;
+
+  uint8_t tail = queueTail.load(std::memory_order_relaxed);
+  while (tail != queueHead.load(std::memory_order_acquire)) {
+    QueuedReport& q = queue[tail];
+    // Either way a report with nowhere to go stays at the head until there
+    // is room: a delayed one is a media release, and losing it would leave
+    // the usage held on the host
+    if (q.delayMs == 0) {
+      if (!deliver(&q.report)) break;
+    } else {
+      if (!wheelInsert(&q.report, q.delayMs)) break;
+      count(stats.scheduled);
+    }
+    tail = (tail + 1) & (HID_TRANSPORT_QUEUE_LEN - 1);
+    queueTail.store(tail, std::memory_order_release);
+  }
+}
+
+void hid_transport_tx_done() {
+  txDone.fetch_add(1, std::memory_order_release);
+}
+
+uint8_t hid_transport_in_flight() {
+  return inFlight();
+}
+
+void hid_transport_get_stats(HidTransportStats* out) {
+  out->queued = stats.queued.load(std::memory_order_relaxed);
+  out->sent = stats.sent.load(std::memory_order_relaxed);
+  out->scheduled = stats.scheduled.load(std::memory_order_relaxed);
+  out->dropped = stats.dropped.load(std::memory_order_relaxed);
+  out->refused = stats.refused.load(std::memory_order_relaxed);
+  out->retried = stats.retried.load(std::memory_order_relaxed);
+  out->stalls = stats.stalls.load(std::memory_order_relaxed);
+  out->suppressed = stats.suppressed.load(std::memory_order_relaxed);
+  out->maxQueueDepth = stats.maxQueueDepth.load(std::memory_order_relaxed);
+  out->maxInFlight = stats.maxInFlight.load(std::memory_order_relaxed);
+}
+
+size_t hid_transport_format(char* buffer, size_t size) {
+  HidTransportStats s;
+  hid_transport_get_stats(&s);
+  int n = snprintf(buffer, size,
+                   "HID: %u queued, %u sent, %u suppressed, %u scheduled; %u dropped, %u refused, "
+                   "%u retried, %u stalls; queue high water %u/%u, in flight %u (max %u/%u)\n",
+                   (unsigned)s.queued, (unsigned)s.sent, (unsigned)s.suppressed,
+                   (unsigned)s.scheduled, (unsigned)s.dropped, (unsigned)s.refused,
+                   (unsigned)s.retried, (unsigned)s.stalls, s.maxQueueDepth,
+                   HID_TRANSPORT_QUEUE_LEN - 1, inFlight(), s.maxInFlight, HID_TX_CREDITS);
+  if (n < 0) return 0;
+  return (size_t)n < size ? n : size - 1;
+}
+
+void hid_transport_set_relative(uint8_t reportId) {
+  if (reportId <= HID_MAX_REPORT_ID) relativeIds |= 1 << reportId;
+}
+
+void hid_transport_invalidate() {
+  lastSentValid.store(false);
+  creditsValid.store(false);
+}
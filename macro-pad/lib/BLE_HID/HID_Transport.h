@@ -0,0 +1,106 @@
+#ifndef HID_TRANSPORT_H
+#define HID_TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- HID Transport Configuration ---
+#define HID_REPORT_MAX_LEN      16   // Fits the NKRO report (see HID_Report.h)
+#define HID_TRANSPORT_QUEUE_LEN 32   // Must be a power of two
+#define HID_WHEEL_SLOTS         32   // Timer wheel slots, 1 ms each
+#define HID_WHEEL_CAPACITY      32   // Reports that can be scheduled at once
+#define HID_MAX_REPORT_ID       7    // Highest report ID tracked for duplicate suppression
+#define HID_TX_CREDITS          6    // Notifications in the BLE stack, not yet on air, at once
+#define HID_TX_STALL_MS         250  // No completion for this long: the credits are assumed lost
+#define HID_RELEASE_RESERVE     4    // Queue slots only release reports may take
+
+struct HidReport {
+  uint8_t id;
+  uint8_t len;
+  uint8_t data[HID_REPORT_MAX_LEN];
+  bool traced;            // carries an input latency trace (see Latency.h)
+  uint32_t detectCycles;
+  uint32_t buildCycles;
+};
+
+// --- Flow Control ---
+// The stack takes only so many notifications before its buffers run out,
+// and then drops or refuses them. The transport keeps at most
+// HID_TX_CREDITS in flight: one is taken when the sink hands a report to
+// the stack and returned by hid_transport_tx_done() once it has gone out in
+// a connection event. A report the stack refuses stays at the head of the
+// queue and is retried, so reports are never reordered or lost there. A
+// delayed report waits there the same way while the timer wheel is full.
+//
+// Producers feel the backpressure as hid_transport_send() refusing. The
+// last HID_RELEASE_RESERVE queue slots only take release reports (all
+// zero: no keys, no usage), so a burst of presses can never leave a key
+// stuck down on the host. State reports (the keyboard) are simply rebuilt
+// and sent again once there is room.
+
+enum HidSinkResult : uint8_t {
+  HID_SINK_SENT,       // Taken by the stack; hid_transport_tx_done() follows
+  HID_SINK_DISCARDED,  // Nobody to send to (no link, or notifications off)
+  HID_SINK_BUSY,       // The stack has no room; retried on the next poll
+};
+
+// Delivers a report to the BLE stack (setValue + notify)
+typedef HidSinkResult (*HidReportSink)(const HidReport* report);
+
+struct HidTransportStats {
+  uint32_t queued;       // reports accepted by hid_transport_send()
+  uint32_t sent;         // reports handed to the sink
+  uint32_t scheduled;    // reports that went through the timer wheel
+  uint32_t dropped;      // reports rejected because the queue was full
+  uint32_t refused;      // presses turned away to keep room for releases
+  uint32_t retried;      // sends the stack refused, tried again later
+  uint32_t stalls;       // credits taken back after HID_TX_STALL_MS without a completion
+  uint32_t suppressed;   // reports identical to the last one sent for their ID
+  uint8_t maxQueueDepth;
+  uint8_t maxInFlight;
+};
+
+// Portable transport core (no Arduino dependency)
+void hid_transport_init(HidReportSink sink, uint32_t nowMs);
+
+// Enqueue a report and return at once. With delayMs > 0 the report is held
+// on the timer wheel and sent that many milliseconds later. Returns false
+// when there is no room for it (see Flow Control).
+// Producer side is single-threaded: call from the loop task only.
+bool hid_transport_send(uint8_t reportId, const uint8_t* data, uint8_t len, uint16_t delayMs = 0);
+
+// Free queue slots, as seen by the producer. Bulk senders (macros) check
+// this so they never take the room a key press needs.
+uint8_t hid_transport_queue_free();
+
+// Free slots a report that presses something can take (the release reserve
+// left out)
+uint8_t hid_transport_press_room();
+
+// Consumer side: advance the timer wheel to nowMs and drain the queue into
+// the sink, as far as the credits go
+void hid_transport_poll(uint32_t nowMs);
+
+// A notification taken by the stack has gone out (GATTS confirm event).
+// Safe from any task; wake the transport afterwards.
+void hid_transport_tx_done();
+uint8_t hid_transport_in_flight();
+
+void hid_transport_get_stats(HidTransportStats* stats);
+size_t hid_transport_format(char* buffer, size_t size);  // For the serial command
+
+// Never suppress duplicates of this report ID: its fields are deltas, so a
+// repeat is more movement, not a repeat of state. Call before
+// hid_transport_begin(); it holds across hid_transport_init().
+void hid_transport_set_relative(uint8_t reportId);
+
+// Forget the last sent reports so the next one of each ID always goes out,
+// and return all credits (call when a new connection is made, or the link
+// drops). Safe from any task.
+void hid_transport_invalidate();
+
+// Start the dedicated transport task and wake it after enqueueing (ESP32 only)
+void hid_transport_begin(HidReportSink sink);
+void hid_transport_wake();
+
+#endif // HID_TRANSPORT_H
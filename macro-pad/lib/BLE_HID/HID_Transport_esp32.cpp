@@ -0,0 +1,31 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include "HID_Transport.h"
+
+// The transport task owns the timer wheel and all notify() calls, so the
+// loop task never waits on the BLE stack.
+#define HID_TASK_PRIORITY   (configMAX_PRIORITIES - 3)
+#define HID_TASK_STACK      4096
+
+static TaskHandle_t transportTask = NULL;
+
+static void transportTaskMain(void*) {
+  for (;;) {
+    // Wake on new reports, or once per tick to advance the timer wheel
+    ulTaskNotifyTake(pdTRUE, 1);
+    hid_transport_poll(millis());
+  }
+}
+
+void hid_transport_begin(HidReportSink sink) {
+  hid_transport_init(sink, millis());
+  xTaskCreate(transportTaskMain, "hid_tx", HID_TASK_STACK, NULL,
+              HID_TASK_PRIORITY, &transportTask);
+}
+
+void hid_transport_wake() {
+  if (transportTask) xTaskNotifyGive(transportTask);
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,184 @@
+#ifndef HID_USAGES_H
+#define HID_USAGES_H
+
+#include <stdint.h>
+
+// --- Keyboard/Keypad Usage Page (0x07) ---
+enum HidKeyUsage : uint8_t {
+  HID_KEY_NONE = 0x00,
+  HID_KEY_A = 0x04, HID_KEY_B, HID_KEY_C, HID_KEY_D, HID_KEY_E, HID_KEY_F,
+  HID_KEY_G, HID_KEY_H, HID_KEY_I, HID_KEY_J, HID_KEY_K, HID_KEY_L, HID_KEY_M,
+  HID_KEY_N, HID_KEY_O, HID_KEY_P, HID_KEY_Q, HID_KEY_R, HID_KEY_S, HID_KEY_T,
+  HID_KEY_U, HID_KEY_V, HID_KEY_W, HID_KEY_X, HID_KEY_Y, HID_KEY_Z,
+  HID_KEY_1 = 0x1E, HID_KEY_2, HID_KEY_3, HID_KEY_4, HID_KEY_5,
+  HID_KEY_6, HID_KEY_7, HID_KEY_8, HID_KEY_9, HID_KEY_0,
+  HID_KEY_ENTER = 0x28,
+  HID_KEY_ESCAPE,
+  HID_KEY_BACKSPACE,
+  HID_KEY_TAB,
+  HID_KEY_SPACE,
+  HID_KEY_MINUS,
+  HID_KEY_EQUAL,
+  HID_KEY_LEFT_BRACKET,
+  HID_KEY_RIGHT_BRACKET,
+  HID_KEY_BACKSLASH,
+  HID_KEY_NON_US_HASH,
+  HID_KEY_SEMICOLON,
+  HID_KEY_APOSTROPHE,
+  HID_KEY_GRAVE,
+  HID_KEY_COMMA,
+  HID_KEY_PERIOD,
+  HID_KEY_SLASH,
+  HID_KEY_CAPS_LOCK,
+  HID_KEY_F1 = 0x3A, HID_KEY_F2, HID_KEY_F3, HID_KEY_F4, HID_KEY_F5, HID_KEY_F6,
+  HID_KEY_F7, HID_KEY_F8, HID_KEY_F9, HID_KEY_F10, HID_KEY_F11, HID_KEY_F12,
+  HID_KEY_PRINT_SCREEN = 0x46,
+  HID_KEY_SCROLL_LOCK,
+  HID_KEY_PAUSE,
+  HID_KEY_INSERT,
+  HID_KEY_HOME,
+  HID_KEY_PAGE_UP,
+  HID_KEY_DELETE,
+  HID_KEY_END,
+  HID_KEY_PAGE_DOWN,
+  HID_KEY_RIGHT_ARROW,
+  HID_KEY_LEFT_ARROW,
+  HID_KEY_DOWN_ARROW,
+  HID_KEY_UP_ARROW,
+  HID_KEY_NUM_LOCK,
+  HID_KEY_KP_SLASH,
+  HID_KEY_KP_ASTERISK,
+  HID_KEY_KP_MINUS,
+  HID_KEY_KP_PLUS,
+  HID_KEY_KP_ENTER,
+  HID_KEY_KP_1 = 0x59, HID_KEY_KP_2, HID_KEY_KP_3, HID_KEY_KP_4, HID_KEY_KP_5,
+  HID_KEY_KP_6, HID_KEY_KP_7, HID_KEY_KP_8, HID_KEY_KP_9, HID_KEY_KP_0,
+  HID_KEY_KP_DOT = 0x63,
+  HID_KEY_NON_US_BACKSLASH,
+  HID_KEY_APPLICATION,
+  HID_KEY_POWER,
+  HID_KEY_KP_EQUAL,
+  HID_KEY_F13 = 0x68, HID_KEY_F14, HID_KEY_F15, HID_KEY_F16, HID_KEY_F17, HID_KEY_F18,
+  HID_KEY_F19, HID_KEY_F20, HID_KEY_F21, HID_KEY_F22, HID_KEY_F23, HID_KEY_F24,
+  HID_KEY_EXECUTE = 0x74,
+  HID_KEY_HELP,
+  HID_KEY_MENU,
+  HID_KEY_SELECT,
+  HID_KEY_STOP,
+  HID_KEY_AGAIN,
+  HID_KEY_UNDO,
+  HID_KEY_CUT,
+  HID_KEY_COPY,
+  HID_KEY_PASTE,
+  HID_KEY_FIND,
+  HID_KEY_MUTE,
+  HID_KEY_VOLUME_UP,
+  HID_KEY_VOLUME_DOWN,
+  HID_KEY_LOCKING_CAPS_LOCK,
+  HID_KEY_LOCKING_NUM_LOCK,
+  HID_KEY_LOCKING_SCROLL_LOCK,
+  HID_KEY_KP_COMMA,
+  HID_KEY_KP_EQUAL_AS400,
+  HID_KEY_INTERNATIONAL1 = 0x87, HID_KEY_INTERNATIONAL2, HID_KEY_INTERNATIONAL3,
+  HID_KEY_INTERNATIONAL4, HID_KEY_INTERNATIONAL5, HID_KEY_INTERNATIONAL6,
+  HID_KEY_INTERNATIONAL7, HID_KEY_INTERNATIONAL8, HID_KEY_INTERNATIONAL9,
+  HID_KEY_LANG1 = 0x90, HID_KEY_LANG2, HID_KEY_LANG3, HID_KEY_LANG4, HID_KEY_LANG5,
+  HID_KEY_LANG6, HID_KEY_LANG7, HID_KEY_LANG8, HID_KEY_LANG9,
+  HID_KEY_ALTERNATE_ERASE = 0x99,
+  HID_KEY_SYSREQ,
+  HID_KEY_CANCEL,
+  HID_KEY_CLEAR,
+  HID_KEY_PRIOR,
+  HID_KEY_RETURN,
+  HID_KEY_SEPARATOR,
+  HID_KEY_OUT,
+  HID_KEY_OPER,
+  HID_KEY_CLEAR_AGAIN,
+  HID_KEY_CRSEL,
+  HID_KEY_EXSEL,                    // 0xA4, last usage the keyboard report carries
+  HID_KEY_LEFT_CTRL = 0xE0,
+  HID_KEY_LEFT_SHIFT,
+  HID_KEY_LEFT_ALT,
+  HID_KEY_LEFT_GUI,
+  HID_KEY_RIGHT_CTRL,
+  HID_KEY_RIGHT_SHIFT,
+  HID_KEY_RIGHT_ALT,
+  HID_KEY_RIGHT_GUI,
+};
+
+// Modifier byte bits, in the order of usages 0xE0-0xE7
+#define HID_MOD_LEFT_CTRL   0x01
+#define HID_MOD_LEFT_SHIFT  0x02
+#define HID_MOD_LEFT_ALT    0x04
+#define HID_MOD_LEFT_GUI    0x08
+#define HID_MOD_RIGHT_CTRL  0x10
+#define HID_MOD_RIGHT_SHIFT 0x20
+#define HID_MOD_RIGHT_ALT   0x40
+#define HID_MOD_RIGHT_GUI   0x80
+
+// --- Consumer Usage Page (0x0C) ---
+#define HID_CONSUMER_NEXT_TRACK  0x00B5
+#define HID_CONSUMER_PREV_TRACK  0x00B6
+#define HID_CONSUMER_STOP        0x00B7
+#define HID_CONSUMER_PLAY_PAUSE  0x00CD
+#define HID_CONSUMER_MUTE        0x00E2
+#define HID_CONSUMER_VOLUME_UP   0x00E9
+#define HID_CONSUMER_VOLUME_DOWN 0x00EA
+
+// --- US Layout ASCII Table ---
+// One byte per 7-bit character: the usage, with HID_ASCII_SHIFT set when the
+// character needs Shift. 0 marks characters with no key (most controls).
+#define HID_ASCII_SHIFT 0x80
+
+struct HidAsciiTable {
+  uint8_t entry[128];
+};
+
+constexpr HidAsciiTable hidBuildAsciiTable() {
+  HidAsciiTable t = {};
+  for (uint8_t i = 0; i < 26; i++) {
+    t.entry['a' + i] = HID_KEY_A + i;
+    t.entry['A' + i] = (HID_KEY_A + i) | HID_ASCII_SHIFT;
+  }
+
+  const char digits[] = "1234567890";
+  const char digitsShifted[] = "!@#$%^&*()";
+  for (uint8_t i = 0; i < 10; i++) {
+    t.entry[(uint8_t)digits[i]] = HID_KEY_1 + i;
+    t.entry[(uint8_t)digitsShifted[i]] = (HID_KEY_1 + i) | HID_ASCII_SHIFT;
+  }
+
+  const char symbols[] = "-=[]\\;'`,./";
+  const char symbolsShifted[] = "_+{}|:\"~<>?";
+  const uint8_t symbolKeys[] = {
+    HID_KEY_MINUS, HID_KEY_EQUAL, HID_KEY_LEFT_BRACKET, HID_KEY_RIGHT_BRACKET,
+    HID_KEY_BACKSLASH, HID_KEY_SEMICOLON, HID_KEY_APOSTROPHE, HID_KEY_GRAVE,
+    HID_KEY_COMMA, HID_KEY_PERIOD, HID_KEY_SLASH,
+  };
+  for (uint8_t i = 0; i < sizeof(symbolKeys); i++) {
+    t.entry[(uint8_t)symbols[i]] = symbolKeys[i];
+    t.entry[(uint8_t)symbolsShifted[i]] = symbolKeys[i] | HID_ASCII_SHIFT;
+  }
+
+  t.entry[' '] = HID_KEY_SPACE;
+  t.entry['\b'] = HID_KEY_BACKSPACE;
+  t.entry['\t'] = HID_KEY_TAB;
+  t.entry['\n'] = HID_KEY_ENTER;
+  t.entry['\r'] = HID_KEY_ENTER;
+  t.entry[0x1B] = HID_KEY_ESCAPE;
+  t.entry[0x7F] = HID_KEY_DELETE;
+  return t;
+}
+
+// Built at compile time and placed in flash with the other constant data
+inline constexpr HidAsciiTable hidAsciiTable = hidBuildAsciiTable();
+
+constexpr uint8_t hid_ascii_usage(char c) {
+  return hidAsciiTable.entry[(uint8_t)c & 0x7F] & ~HID_ASCII_SHIFT;
+}
+
+constexpr bool hid_ascii_shift(char c) {
+  return hidAsciiTable.entry[(uint8_t)c & 0x7F] & HID_ASCII_SHIFT;
+}
+
+#endif // HID_USAGES_H
@@ -0,0 +1,230 @@
+#include "Reconnect.h"
+#include "Log.h"
+#include <atomic>
+#include <string.h>
+
+static const char* const modeNames[ADV_MODE_COUNT] = {
+  "off",
+  "directed",
+  "whitelist",
+  "open",
+};
+
+static ReconnectIo io;
+static BondedHostTable table;
+static ReconnectStats stats;
+
+// Written by the BLE task before it bumps linkChanges / sets bondPending
+static std::atomic<bool> linkUp(false);
+static std::atomic<uint32_t> linkChanges(0);
+static uint8_t peer[6];
+static std::atomic<bool> bondPending(false);
+static BondedHost bond;
+static std::atomic<uint8_t> pendingSelect(RECONNECT_SELECT_NONE);
+
+// Loop task state
+static uint32_t seenChanges;
+static bool connected;
+static int8_t connectedSlot = -1;  // Host on the link, -1 until known
+static uint32_t searchStartMs;     // Disconnect, host switch or boot
+static uint32_t phaseEndMs;
+static bool switching;             // Dropped the link to change hosts
+static uint32_t switchMs;
+static AdvMode mode = ADV_OFF;
+
+static int8_t findHost(const uint8_t* addr) {
+  for (uint8_t i = 0; i < RECONNECT_MAX_HOSTS; i++) {
+    if (table.hosts[i].valid && memcmp(table.hosts[i].addr, addr, 6) == 0) return i;
+  }
+  return -1;
+}
+
+static const BondedHost* selectedHost() {
+  const BondedHost* host = &table.hosts[table.selected];
+  return host->valid ? host : nullptr;
+}
+
+static void setSelected(uint8_t slot) {
+  if (slot == table.selected) return;
+  table.selected = slot;
+  stats.selected = slot;
+  io.save(&table);
+}
+
+static void startMode(AdvMode next, uint32_t nowMs) {
+  mode = next;
+  stats.mode = next;
+  switch (next) {
+    case ADV_DIRECTED:  phaseEndMs = nowMs + RECONNECT_DIRECTED_MS; break;
+    case ADV_WHITELIST: phaseEndMs = nowMs + RECONNECT_WHITELIST_MS; break;
+    default:            phaseEndMs = nowMs; break;
+  }
+  io.advertise(next, next == ADV_DIRECTED || next == ADV_WHITELIST ? selectedHost() : nullptr);
+  LOG(LOG_EVT_RECONNECT_ADV, next, table.selected);
+}
+
+// Fastest phase first; a slot with no host to aim at can only be paired
+static void startSearch(uint32_t nowMs) {
+  searchStartMs = nowMs;
+  startMode(selectedHost() ? ADV_DIRECTED : ADV_OPEN, nowMs);
+}
+
+void reconnect_init(const ReconnectIo* ops, const BondedHostTable* stored, uint32_t nowMs) {
+  io = *ops;
+  memset(&table, 0, sizeof(table));
+  if (stored) table = *stored;
+  if (table.selected >= RECONNECT_MAX_HOSTS) table.selected = 0;
+  memset(&stats, 0, sizeof(stats));
+  stats.selected = table.selected;
+  linkUp.store(false);
+  linkChanges.store(0);
+  bondPending.store(false);
+  pendingSelect.store(RECONNECT_SELECT_NONE);
+  seenChanges = 0;
+  connected = false;
+  connectedSlot = -1;
+  switching = false;
+  startSearch(nowMs);
+}
+
+void reconnect_link_up(const uint8_t* addr) {
+  memcpy(peer, addr, sizeof(peer));
+  linkUp.store(true);
+  linkChanges.fetch_add(1);
+}
+
+void reconnect_link_down() {
+  linkUp.store(false);
+  linkChanges.fetch_add(1);
+}
+
+void reconnect_bonded(const uint8_t* addr, uint8_t addrType) {
+  memcpy(bond.addr, addr, sizeof(bond.addr));
+  bond.addrType = addrType;
+  bond.valid = 1;
+  bondPending.store(true);
+}
+
+static void onConnected(uint32_t nowMs) {
+  connected = true;
+  uint32_t elapsed = nowMs - searchStartMs;
+  stats.reconnects++;
+  stats.lastMs = elapsed;
+  stats.totalMs += elapsed;
+  if (stats.reconnects == 1 || elapsed < stats.minMs) stats.minMs = elapsed;
+  if (elapsed > stats.maxMs) stats.maxMs = elapsed;
+  stats.byMode[mode]++;
+
+  // Whoever came in while the pad was open for anyone is the host now
+  connectedSlot = findHost(peer);
+  if (connectedSlot >= 0) setSelected(connectedSlot);
+  LOG(LOG_EVT_RECONNECTED, elapsed, mode, connectedSlot);
+
+  mode = ADV_OFF;  // The controller stops advertising on connect
+  stats.mode = ADV_OFF;
+}
+
+// A new host goes into the selected slot if that is free, else the first
+// free one, else it replaces the selected host
+static void storeBond() {
+  int8_t slot = findHost(bond.addr);
+  if (slot < 0) {
+    slot = table.selected;
+    if (table.hosts[slot].valid) {
+      for (uint8_t i = 0; i < RECONNECT_MAX_HOSTS; i++) {
+        if (!table.hosts[i].valid) {
+          slot = i;
+          break;
+        }
+      }
+    }
+  } else if (memcmp(&table.hosts[slot], &bond, sizeof(bond)) == 0) {
+    // Re-encryption of a known host: nothing to store
+    connectedSlot = slot;
+    setSelected(slot);
+    return;
+  }
+  table.hosts[slot] = bond;
+  table.selected = slot;
+  stats.selected = slot;
+  connectedSlot = slot;
+  io.save(&table);
+  LOG(LOG_EVT_HOST_BONDED, slot);
+}
+
+static void switchHost(uint8_t slot, uint32_t nowMs) {
+  if (slot == RECONNECT_SELECT_ANY) {
+    // Next bonded slot after the selected one; stay put if there is none
+    slot = table.selected;
+    for (uint8_t i = 1; i < RECONNECT_MAX_HOSTS; i++) {
+      uint8_t next = (table.selected + i) % RECONNECT_MAX_HOSTS;
+      if (table.hosts[next].valid) {
+        slot = next;
+        break;
+      }
+    }
+  }
+  if (slot >= RECONNECT_MAX_HOSTS) return;
+
+  setSelected(slot);
+  LOG(LOG_EVT_HOST_SELECTED, slot, table.hosts[slot].valid);
+  if (!connected) {
+    startSearch(nowMs);
+  } else if (connectedSlot != slot) {
+    // Timed from the key press; poll starts advertising once the link drops
+    switching = true;
+    switchMs = nowMs;
+    io.disconnect();
+  }
+}
+
+void reconnect_poll(uint32_t nowMs) {
+  uint32_t changes = linkChanges.load();
+  if (changes != seenChanges) {
+    seenChanges = changes;
+    bool up = linkUp.load();
+    // Down, or down and up again since the last poll. A link that came and
+    // went while searching counts too: the stack stopped advertising when it
+    // connected, so the search has to start again. One that is back up
+    // needs no advertising, only its reconnect recorded.
+    if (connected || !up) {
+      connected = false;
+      connectedSlot = -1;
+      if (up) {
+        searchStartMs = nowMs;
+      } else {
+        startSearch(nowMs);
+      }
+      if (switching) searchStartMs = switchMs;
+      switching = false;
+    }
+    if (up) onConnected(nowMs);
+  }
+
+  if (bondPending.load()) {
+    bondPending.store(false);
+    storeBond();
+  }
+
+  uint8_t slot = pendingSelect.exchange(RECONNECT_SELECT_NONE);
+  if (slot != RECONNECT_SELECT_NONE) switchHost(slot, nowMs);
+
+  if (connected) return;
+  if (mode == ADV_DIRECTED && (int32_t)(nowMs - phaseEndMs) >= 0) {
+    startMode(ADV_WHITELIST, nowMs);
+  } else if (mode == ADV_WHITELIST && (int32_t)(nowMs - phaseEndMs) >= 0) {
+    startMode(ADV_OPEN, nowMs);
+  }
+}
+
+void reconnect_select(uint8_t slot) {
+  pendingSelect.store(slot);
+}
+
+void reconnect_get_stats(ReconnectStats* out) {
+  *out = stats;
+}
+
+const char* adv_mode_name(AdvMode m) {
+  return m < ADV_MODE_COUNT ? modeNames[m] : "?";
+}
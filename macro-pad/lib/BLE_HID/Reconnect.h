@@ -0,0 +1,88 @@
+#ifndef RECONNECT_H
+#define RECONNECT_H
+
+#include <stdint.h>
+
+// --- Reconnect Manager ---
+// Keeps up to RECONNECT_MAX_HOSTS bonded hosts, one of them selected. While
+// disconnected it advertises in phases, fastest first:
+//   directed:  high duty cycle, addressed to the selected host only
+//   whitelist: undirected, only the selected host may connect
+//   open:      undirected, anyone may connect (pairing, or a host whose
+//              address changed)
+// Phases the selected slot cannot use are skipped; an empty slot goes
+// straight to open, which is how a new host is paired into it.
+#define RECONNECT_MAX_HOSTS     4
+#define RECONNECT_DIRECTED_MS   1280   // Longest high duty directed advertising allowed
+#define RECONNECT_WHITELIST_MS  30000  // Then 30 s at 20-30 ms
+#define RECONNECT_SELECT_ANY    0xFF   // action_host(): next bonded host
+#define RECONNECT_SELECT_NONE   0xFE   // Internal: no switch pending
+
+enum AdvMode : uint8_t {
+  ADV_OFF,
+  ADV_DIRECTED,
+  ADV_WHITELIST,  // 20-30 ms interval
+  ADV_OPEN,       // 152.5-211.25 ms interval, indefinitely
+  ADV_MODE_COUNT
+};
+
+struct BondedHost {
+  uint8_t addr[6];
+  uint8_t addrType;  // Public or random (identity) address
+  uint8_t valid;
+};
+
+// The table as stored: hosts, then the selected slot
+struct BondedHostTable {
+  BondedHost hosts[RECONNECT_MAX_HOSTS];
+  uint8_t selected;
+};
+
+// What diagnostics report, little-endian. Times run from the disconnect,
+// host switch or boot that started the search to the link coming up.
+struct ReconnectStats {
+  uint32_t reconnects;
+  uint32_t lastMs;
+  uint32_t minMs;
+  uint32_t maxMs;
+  uint32_t totalMs;
+  uint32_t byMode[ADV_MODE_COUNT];  // Which phase each connection came in on
+  uint8_t mode;      // AdvMode now
+  uint8_t selected;  // Host slot
+  uint8_t reserved[2];
+};
+
+static_assert(sizeof(ReconnectStats) == 40, "ReconnectStats is sent as is");
+
+struct ReconnectIo {
+  // Stop advertising, then start in mode. target is the selected host for
+  // ADV_DIRECTED and ADV_WHITELIST.
+  void (*advertise)(AdvMode mode, const BondedHost* target);
+  void (*disconnect)();
+  void (*save)(const BondedHostTable* table);
+};
+
+// Portable core (no Arduino dependency). The link callbacks may come from
+// the BLE task; everything else runs on the loop task.
+void reconnect_init(const ReconnectIo* io, const BondedHostTable* stored, uint32_t nowMs);
+void reconnect_link_up(const uint8_t* addr);
+void reconnect_link_down();
+void reconnect_bonded(const uint8_t* addr, uint8_t addrType);  // Pairing finished
+
+// Advance the schedule and handle link changes
+void reconnect_poll(uint32_t nowMs);
+
+// Switch hosts: drop the link if it is to another host and go after this
+// one. RECONNECT_SELECT_ANY moves to the next bonded slot. Any task; the
+// switch happens in the next reconnect_poll().
+void reconnect_select(uint8_t slot);
+
+void reconnect_get_stats(ReconnectStats* stats);
+const char* adv_mode_name(AdvMode mode);
+
+// Load the stored table and start advertising (ESP32: NVS and raw GAP
+// advertising; the host build uses the sim's hosts)
+class BLEServer;
+void reconnect_begin(BLEServer* server, uint32_t nowMs);
+
+#endif // RECONNECT_H
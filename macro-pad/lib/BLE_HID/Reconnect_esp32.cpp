@@ -0,0 +1,83 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <BLEServer.h>
+#include <Preferences.h>
+#include <esp_gap_ble_api.h>
+#include "Reconnect.h"
+
+// Advertising goes straight to the GAP API: BLEAdvertising can neither
+// direct nor filter. The advertisement data itself was set up once by
+// ble_hid_setup() and stays in the controller across restarts.
+#define RECONNECT_NVS_NAMESPACE "reconnect"
+#define RECONNECT_NVS_KEY       "hosts"
+
+// Intervals in 0.625 ms units
+#define ADV_FAST_MIN  0x20   // 20 ms
+#define ADV_FAST_MAX  0x30   // 30 ms
+#define ADV_SLOW_MIN  0xF4   // 152.5 ms
+#define ADV_SLOW_MAX  0x152  // 211.25 ms
+
+static BLEServer* server;
+static Preferences prefs;
+
+static void espAdvertise(AdvMode mode, const BondedHost* target) {
+  esp_ble_gap_stop_advertising();
+  if (mode == ADV_OFF) return;
+
+  esp_ble_adv_params_t params = {};
+  params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+  params.channel_map = ADV_CHNL_ALL;
+  params.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+
+  switch (mode) {
+    case ADV_DIRECTED:
+      // High duty cycle; the controller gives up by itself after 1.28 s
+      params.adv_type = ADV_TYPE_DIRECT_IND_HIGH;
+      params.adv_int_min = params.adv_int_max = ADV_FAST_MIN;
+      memcpy(params.peer_addr, target->addr, sizeof(params.peer_addr));
+      params.peer_addr_type = (esp_ble_addr_type_t)target->addrType;
+      break;
+    case ADV_WHITELIST:
+      esp_ble_gap_clear_whitelist();
+      esp_ble_gap_update_whitelist(true, (uint8_t*)target->addr,
+                                   target->addrType == BLE_ADDR_TYPE_PUBLIC ? BLE_WL_ADDR_TYPE_PUBLIC
+                                                                            : BLE_WL_ADDR_TYPE_RANDOM);
+      params.adv_type = ADV_TYPE_IND;
+      params.adv_int_min = ADV_FAST_MIN;
+      params.adv_int_max = ADV_FAST_MAX;
+      params.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_WLST;
+      break;
+    default:
+      params.adv_type = ADV_TYPE_IND;
+      params.adv_int_min = ADV_SLOW_MIN;
+      params.adv_int_max = ADV_SLOW_MAX;
+      break;
+  }
+  esp_ble_gap_start_advertising(&params);
+}
+
+static void espDisconnect() {
+  server->disconnect(server->getConnId());
+}
+
+static void espSave(const BondedHostTable* table) {
+  prefs.putBytes(RECONNECT_NVS_KEY, table, sizeof(*table));
+}
+
+static const ReconnectIo espReconnect = {
+  espAdvertise,
+  espDisconnect,
+  espSave,
+};
+
+void reconnect_begin(BLEServer* bleServer, uint32_t nowMs) {
+  server = bleServer;
+  prefs.begin(RECONNECT_NVS_NAMESPACE);
+
+  BondedHostTable stored;
+  bool loaded = prefs.getBytes(RECONNECT_NVS_KEY, &stored, sizeof(stored)) == sizeof(stored);
+  reconnect_init(&espReconnect, loaded ? &stored : nullptr, nowMs);
+}
+
+#endif // ARDUINO_ARCH_ESP32
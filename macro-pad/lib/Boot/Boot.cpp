@@ -0,0 +1,207 @@
+#include "Boot.h"
+#include "Log.h"
+#include <stdio.h>
+#include <string.h>
+
+// --- Boot Phases ---
+
+static const char* const phaseNames[BOOT_PHASE_COUNT] = {
+  "config",
+  "input",
+  "ble",
+  "ready",
+  "connected",
+  "subscribed",
+};
+
+static uint32_t phaseUs[BOOT_PHASE_COUNT];
+static bool phaseSeen[BOOT_PHASE_COUNT];
+
+void boot_mark(BootPhase phase, uint32_t nowUs) {
+  if (phase >= BOOT_PHASE_COUNT || phaseSeen[phase]) return;
+  phaseSeen[phase] = true;
+  phaseUs[phase] = nowUs;
+  LOG(LOG_EVT_BOOT_PHASE, phase, nowUs);
+}
+
+uint32_t boot_phase_us(BootPhase phase) {
+  return phase < BOOT_PHASE_COUNT ? phaseUs[phase] : 0;
+}
+
+const char* boot_phase_name(BootPhase phase) {
+  return phase < BOOT_PHASE_COUNT ? phaseNames[phase] : "?";
+}
+
+// Length after an snprintf() that returned n, never past the buffer's end
+static size_t append(size_t size, size_t len, int n) {
+  if (n < 0) return len;
+  return len + n < size ? len + n : size - 1;
+}
+
+size_t boot_format(char* buffer, size_t size) {
+  size_t len = append(size, 0, snprintf(buffer, size, "Boot (ms):"));
+  for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+    if (phaseSeen[i]) {
+      len = append(size, len, snprintf(buffer + len, size - len, " %s %u.%03u", phaseNames[i],
+                                       (unsigned)(phaseUs[i] / 1000), (unsigned)(phaseUs[i] % 1000)));
+    } else {
+      len = append(size, len, snprintf(buffer + len, size - len, " %s -", phaseNames[i]));
+    }
+  }
+  return append(size, len, snprintf(buffer + len, size - len, "; %u buffered key edges dropped\n",
+                                    (unsigned)boot_input_dropped()));
+}
+
+// --- Pre-connection Input ---
+
+#define KEY_BITS (KEYPAD_MAX_ROWS * KEYPAD_MAX_COLS)
+
+static PendingKey ring[BOOT_INPUT_LEN];
+static uint8_t head;  // Next to pop
+static uint8_t count;
+static uint8_t openCount;            // Buffered presses whose release is not buffered yet
+static uint32_t openKeys[KEY_BITS / 32];
+static uint32_t droppedKeys[KEY_BITS / 32];  // Press dropped: drop the release too
+static uint32_t owedKeys[KEY_BITS / 32];     // Release of a press that reached the keymap
+static uint8_t owedCount;
+static uint32_t dropped;
+
+static inline uint16_t keyIndex(uint8_t row, uint8_t col) {
+  return row * KEYPAD_MAX_COLS + col;
+}
+
+static inline bool testBit(const uint32_t* bits, uint16_t i) {
+  return bits[i / 32] & (1u << (i % 32));
+}
+
+static inline void setBit(uint32_t* bits, uint16_t i, bool value) {
+  if (value) {
+    bits[i / 32] |= 1u << (i % 32);
+  } else {
+    bits[i / 32] &= ~(1u << (i % 32));
+  }
+}
+
+// A release with no room or gone stale whose press went out before the link
+// dropped. The keymap still holds that key, so the release is kept as a bit
+// and handed out ahead of the buffer rather than dropped.
+static void owe(uint16_t key) {
+  if (testBit(owedKeys, key)) return;
+  setBit(owedKeys, key, true);
+  owedCount++;
+}
+
+bool boot_input_push(const InputEvent* event) {
+  uint16_t key = keyIndex(event->row, event->col);
+  if (event->value) {
+    // Keep a slot for this press's release and every open one
+    if (count + openCount + 2 > BOOT_INPUT_LEN) {
+      setBit(droppedKeys, key, true);
+      dropped++;
+      return false;
+    }
+    setBit(droppedKeys, key, false);
+    setBit(openKeys, key, true);
+    openCount++;
+  } else {
+    if (testBit(droppedKeys, key)) {
+      setBit(droppedKeys, key, false);
+      dropped++;
+      return false;
+    }
+    if (testBit(openKeys, key)) {
+      setBit(openKeys, key, false);
+      openCount--;
+    } else if (count == BOOT_INPUT_LEN) {
+      owe(key);  // Held since before the link dropped
+      return true;
+    }
+  }
+
+  PendingKey& slot = ring[(head + count) & (BOOT_INPUT_LEN - 1)];
+  slot.timestamp = event->timestamp;
+  slot.row = event->row;
+  slot.col = event->col;
+  slot.pressed = event->value != 0;
+  count++;
+  return true;
+}
+
+bool boot_input_empty() {
+  return count == 0 && owedCount == 0;
+}
+
+static bool stale(const PendingKey& key, uint32_t nowUs) {
+  return nowUs - key.timestamp > BOOT_INPUT_MAX_AGE_MS * 1000UL;
+}
+
+// Remove the front edge; true when it should be sent
+static bool take(PendingKey* out, uint32_t nowUs) {
+  *out = ring[head];
+  head = (head + 1) & (BOOT_INPUT_LEN - 1);
+  count--;
+
+  uint16_t key = keyIndex(out->row, out->col);
+  if (out->pressed) {
+    if (testBit(openKeys, key)) {
+      setBit(openKeys, key, false);
+      openCount--;
+    }
+    if (!stale(*out, nowUs)) return true;
+    setBit(droppedKeys, key, true);
+    dropped++;
+    return false;
+  }
+  if (testBit(droppedKeys, key)) {
+    setBit(droppedKeys, key, false);
+    dropped++;
+    return false;
+  }
+  return true;
+}
+
+// Any owed release; it is older than everything in the buffer
+static bool takeOwed(PendingKey* out, uint32_t nowUs) {
+  for (uint16_t i = 0; owedCount && i < KEY_BITS; i++) {
+    if (!testBit(owedKeys, i)) continue;
+    setBit(owedKeys, i, false);
+    owedCount--;
+    out->timestamp = nowUs;
+    out->row = i / KEYPAD_MAX_COLS;
+    out->col = i % KEYPAD_MAX_COLS;
+    out->pressed = false;
+    return true;
+  }
+  return false;
+}
+
+bool boot_input_pop(PendingKey* key, uint32_t nowUs) {
+  if (takeOwed(key, nowUs)) return true;
+  while (count) {
+    if (take(key, nowUs)) return true;
+  }
+  return false;
+}
+
+void boot_input_expire(uint32_t nowUs) {
+  PendingKey key;
+  while (count && stale(ring[head], nowUs)) {
+    if (take(&key, nowUs)) owe(keyIndex(key.row, key.col));  // Only a release is sent once stale
+  }
+}
+
+uint32_t boot_input_dropped() {
+  return dropped;
+}
+
+// --- Reset ---
+
+void boot_init() {
+  memset(phaseUs, 0, sizeof(phaseUs));
+  memset(phaseSeen, 0, sizeof(phaseSeen));
+  head = count = openCount = owedCount = 0;
+  memset(openKeys, 0, sizeof(openKeys));
+  memset(droppedKeys, 0, sizeof(droppedKeys));
+  memset(owedKeys, 0, sizeof(owedKeys));
+  dropped = 0;
+}
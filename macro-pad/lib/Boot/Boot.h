@@ -0,0 +1,62 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Input_Bus.h"
+#include "Keypad.h"
+
+// Clear the phase times and the input buffer; first thing in setup()
+void boot_init();
+
+// --- Boot Phases ---
+// setup() marks each phase as it finishes and loop() marks the link coming
+// up, all in micros() since power-on. Each phase is logged once.
+enum BootPhase : uint8_t {
+  BOOT_PHASE_CONFIG,      // Config view loaded
+  BOOT_PHASE_INPUT,       // Scanner and encoder running
+  BOOT_PHASE_BLE,         // Stack up and advertising
+  BOOT_PHASE_READY,       // setup() done
+  BOOT_PHASE_CONNECTED,   // First host link
+  BOOT_PHASE_SUBSCRIBED,  // Host enabled keyboard notifications
+  BOOT_PHASE_COUNT
+};
+
+void boot_mark(BootPhase phase, uint32_t nowUs);  // Later marks of a phase are ignored
+uint32_t boot_phase_us(BootPhase phase);          // 0 until reached
+const char* boot_phase_name(BootPhase phase);
+
+// Text dump for the serial command
+size_t boot_format(char* buffer, size_t size);
+
+// --- Pre-connection Input ---
+// Key edges seen before a host is listening wait here, in order, and are
+// replayed once it subscribes to the keyboard report. Edges older than
+// BOOT_INPUT_MAX_AGE_MS when their turn comes are dropped with their
+// partner edge, so a stale press never reaches the host and no key is
+// left held. A press is only taken while there is room for its release.
+// The release of a key pressed before the link dropped is never dropped:
+// its press reached the keymap, so when it has no room or goes stale it is
+// kept aside and popped ahead of the buffer.
+#define BOOT_INPUT_LEN         16     // Edges, must be a power of two
+#define BOOT_INPUT_MAX_AGE_MS  3000
+
+struct PendingKey {
+  uint32_t timestamp;  // micros() at the scan that accepted the edge
+  uint8_t row;
+  uint8_t col;
+  bool pressed;
+};
+
+bool boot_input_push(const InputEvent* event);  // INPUT_KEY only; false when dropped
+bool boot_input_empty();
+
+// Next edge young enough to send; drops stale ones on the way
+bool boot_input_pop(PendingKey* key, uint32_t nowUs);
+
+// Drop stale edges from the front, so a long wait cannot fill the buffer
+void boot_input_expire(uint32_t nowUs);
+
+uint32_t boot_input_dropped();  // Edges dropped for age or space since boot
+
+#endif // BOOT_H
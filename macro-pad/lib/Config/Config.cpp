@@ -0,0 +1,228 @@
+#include "Config.h"
+#include "Debounce.h"
+#include "MacroPad.h"
+#include <stddef.h>
+#include <string.h>
+
+#define CONFIG_CRC_START offsetof(ConfigHeader, version)
+
+static inline uint32_t align4(uint32_t n) {
+  return (n + 3) & ~3u;
+}
+
+// --- Format ---
+
+// Reflected CRC-32 (IEEE), nibble table: small and fast enough for 64 KB
+uint32_t config_crc32(const uint8_t* data, uint32_t len, uint32_t crc) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  crc = ~crc;
+  for (uint32_t i = 0; i < len; i++) {
+    crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+uint32_t config_build(const ConfigSource* src, uint8_t* out, uint32_t cap) {
+  if (src->layers < 1 || src->layers > KEYMAP_MAX_LAYERS) return 0;
+  if (src->rows > KEYPAD_MAX_ROWS || src->cols > KEYPAD_MAX_COLS) return 0;
+  if (src->macroCount > CONFIG_MAX_MACROS) return 0;
+  if (src->danceCount > RESOLVE_MAX_DANCES || src->comboCount > RESOLVE_MAX_COMBOS) return 0;
+
+  uint32_t keyCount = src->layers * src->rows * src->cols;
+  ConfigHeader h = {};
+  h.version = CONFIG_VERSION;
+  h.headerLen = sizeof(ConfigHeader);
+  h.layers = src->layers;
+  h.rows = src->rows;
+  h.cols = src->cols;
+  h.macroCount = src->macroCount;
+  h.danceCount = src->danceCount;
+  h.comboCount = src->comboCount;
+  h.settings = *src->settings;
+  h.keysOffset = align4(sizeof(ConfigHeader));
+  h.encoderOffset = align4(h.keysOffset + keyCount * sizeof(KeyAction));
+  h.dancesOffset = align4(h.encoderOffset + src->layers * sizeof(EncoderBinding));
+  h.combosOffset = h.dancesOffset + src->danceCount * sizeof(TapDance);
+  h.macrosOffset = h.combosOffset + src->comboCount * sizeof(Combo);
+
+  uint32_t at = h.macrosOffset + src->macroCount * sizeof(uint32_t);
+  uint32_t macroLen[CONFIG_MAX_MACROS];
+  for (uint8_t i = 0; i < src->macroCount; i++) {
+    macroLen[i] = macro_code_len(src->macros[i], CONFIG_SLOT_SIZE);
+    if (!macroLen[i]) return 0;
+    at += macroLen[i];
+  }
+  h.length = at;
+  if (h.length > cap) return 0;
+
+  memset(out, 0, h.length);
+  memcpy(out + h.keysOffset, src->keys, keyCount * sizeof(KeyAction));
+  memcpy(out + h.encoderOffset, src->encoder, src->layers * sizeof(EncoderBinding));
+  if (src->danceCount) memcpy(out + h.dancesOffset, src->dances, src->danceCount * sizeof(TapDance));
+  if (src->comboCount) memcpy(out + h.combosOffset, src->combos, src->comboCount * sizeof(Combo));
+
+  at = h.macrosOffset + src->macroCount * sizeof(uint32_t);
+  for (uint8_t i = 0; i < src->macroCount; i++) {
+    memcpy(out + h.macrosOffset + i * sizeof(uint32_t), &at, sizeof(uint32_t));
+    memcpy(out + at, src->macros[i], macroLen[i]);
+    at += macroLen[i];
+  }
+
+  h.magic = CONFIG_MAGIC;
+  memcpy(out, &h, sizeof(h));
+  h.crc = config_crc32(out + CONFIG_CRC_START, h.length - CONFIG_CRC_START);
+  memcpy(out, &h, sizeof(h));
+  return h.length;
+}
+
+// Every key of a combo on the matrix, at least two of them, none twice
+static bool comboValid(const Combo* combo, uint8_t rows, uint8_t cols) {
+  uint8_t size = 0;
+  for (uint8_t i = 0; i < RESOLVE_COMBO_KEYS; i++) {
+    uint8_t k = combo->keys[i];
+    if (k == RESOLVE_NO_KEY) continue;
+    if ((k >> 4) >= rows || (k & 0x0F) >= cols) return false;
+    if (memchr(combo->keys, k, i)) return false;
+    size++;
+  }
+  return size >= 2;
+}
+
+static bool sectionFits(const ConfigHeader* h, uint32_t offset, uint32_t len) {
+  return (offset & 3) == 0 && offset >= sizeof(ConfigHeader) &&
+         offset <= h->length && len <= h->length - offset;
+}
+
+const ConfigHeader* config_validate(const uint8_t* blob, uint32_t cap) {
+  const ConfigHeader* h = (const ConfigHeader*)blob;
+  if (cap < sizeof(ConfigHeader)) return nullptr;
+  if (h->magic != CONFIG_MAGIC || h->version != CONFIG_VERSION) return nullptr;
+  if (h->headerLen != sizeof(ConfigHeader)) return nullptr;
+  if (h->length < sizeof(ConfigHeader) || h->length > cap) return nullptr;
+  if (config_crc32(blob + CONFIG_CRC_START, h->length - CONFIG_CRC_START) != h->crc) return nullptr;
+
+  // The CRC only proves the blob is what the writer made; check it is sane too
+  if (h->layers < 1 || h->layers > KEYMAP_MAX_LAYERS) return nullptr;
+  if (h->rows > KEYPAD_MAX_ROWS || h->cols > KEYPAD_MAX_COLS) return nullptr;
+  if (h->macroCount > CONFIG_MAX_MACROS) return nullptr;
+  uint16_t scanHz = h->settings.scanHz < KEYPAD_SCAN_HZ_MAX ? h->settings.scanHz : KEYPAD_SCAN_HZ_MAX;
+  if (!debounce_time_fits(h->settings.debounceMs, scanHz)) return nullptr;
+  if (h->danceCount > RESOLVE_MAX_DANCES || h->comboCount > RESOLVE_MAX_COMBOS) return nullptr;
+  if (!sectionFits(h, h->keysOffset, h->layers * h->rows * h->cols * sizeof(KeyAction))) return nullptr;
+  if (!sectionFits(h, h->encoderOffset, h->layers * sizeof(EncoderBinding))) return nullptr;
+  if (!sectionFits(h, h->dancesOffset, h->danceCount * sizeof(TapDance))) return nullptr;
+  if (!sectionFits(h, h->combosOffset, h->comboCount * sizeof(Combo))) return nullptr;
+  if (!sectionFits(h, h->macrosOffset, h->macroCount * sizeof(uint32_t))) return nullptr;
+
+  const Combo* combos = (const Combo*)(blob + h->combosOffset);
+  for (uint8_t i = 0; i < h->comboCount; i++) {
+    if (!comboValid(&combos[i], h->rows, h->cols)) return nullptr;
+  }
+
+  const uint32_t* offsets = (const uint32_t*)(blob + h->macrosOffset);
+  for (uint8_t i = 0; i < h->macroCount; i++) {
+    if (offsets[i] >= h->length) return nullptr;
+    if (!macro_code_len(blob + offsets[i], h->length - offsets[i])) return nullptr;
+  }
+  return h;
+}
+
+void config_view(const ConfigHeader* h, ConfigView* view) {
+  const uint8_t* blob = (const uint8_t*)h;
+  view->header = h;
+  view->settings = &h->settings;
+  view->keys = (const KeyAction*)(blob + h->keysOffset);
+  view->encoder = (const EncoderBinding*)(blob + h->encoderOffset);
+  view->dances = (const TapDance*)(blob + h->dancesOffset);
+  view->combos = (const Combo*)(blob + h->combosOffset);
+  view->layers = h->layers;
+  view->rows = h->rows;
+  view->cols = h->cols;
+  view->macroCount = h->macroCount;
+  view->danceCount = h->danceCount;
+  view->comboCount = h->comboCount;
+
+  const uint32_t* offsets = (const uint32_t*)(blob + h->macrosOffset);
+  for (uint8_t i = 0; i < h->macroCount; i++) view->macros[i] = blob + offsets[i];
+}
+
+void config_view_source(const ConfigSource* src, ConfigView* view) {
+  view->header = nullptr;
+  view->settings = src->settings;
+  view->keys = src->keys;
+  view->encoder = src->encoder;
+  view->dances = src->dances;
+  view->combos = src->combos;
+  view->layers = src->layers;
+  view->rows = src->rows;
+  view->cols = src->cols;
+  view->danceCount = src->danceCount > RESOLVE_MAX_DANCES ? RESOLVE_MAX_DANCES : src->danceCount;
+  view->comboCount = src->comboCount > RESOLVE_MAX_COMBOS ? RESOLVE_MAX_COMBOS : src->comboCount;
+  view->macroCount = src->macroCount > CONFIG_MAX_MACROS ? CONFIG_MAX_MACROS : src->macroCount;
+  for (uint8_t i = 0; i < view->macroCount; i++) view->macros[i] = src->macros[i];
+}
+
+// --- A/B Store ---
+
+static ConfigFlashIo flash;
+static int8_t activeSlot = -1;
+
+static const ConfigHeader* slotHeader(uint8_t slot) {
+  return config_validate(flash.slot(slot), CONFIG_SLOT_SIZE);
+}
+
+static void selectActive() {
+  const ConfigHeader* a = slotHeader(0);
+  const ConfigHeader* b = slotHeader(1);
+  if (a && b) {
+    // Sequence numbers wrap; compare by difference
+    activeSlot = (int32_t)(b->sequence - a->sequence) > 0 ? 1 : 0;
+  } else {
+    activeSlot = a ? 0 : b ? 1 : -1;
+  }
+}
+
+void config_store_init(const ConfigFlashIo* io) {
+  flash = *io;
+  selectActive();
+}
+
+const ConfigHeader* config_store_active() {
+  return activeSlot < 0 ? nullptr : (const ConfigHeader*)flash.slot(activeSlot);
+}
+
+int8_t config_store_active_slot() {
+  return activeSlot;
+}
+
+bool config_store_write(const uint8_t* blob, uint32_t len) {
+  if (len < sizeof(ConfigHeader) || len > CONFIG_SLOT_SIZE) return false;
+  if (!config_validate(blob, len)) return false;
+
+  const ConfigHeader* current = config_store_active();
+  uint8_t target = activeSlot == 0 ? 1 : 0;
+
+  // Restamp the header with the next sequence; the magic stays erased for now
+  ConfigHeader h;
+  memcpy(&h, blob, sizeof(h));
+  h.sequence = current ? current->sequence + 1 : 1;
+  h.magic = 0xFFFFFFFF;
+  uint32_t crc = config_crc32((const uint8_t*)&h + CONFIG_CRC_START, sizeof(h) - CONFIG_CRC_START);
+  h.crc = config_crc32(blob + sizeof(h), len - sizeof(h), crc);
+
+  if (!flash.erase(target, len)) return false;
+  if (!flash.write(target, sizeof(h), blob + sizeof(h), len - sizeof(h))) return false;
+  if (!flash.write(target, 0, &h, sizeof(h))) return false;
+
+  // Commit: until this word lands the slot is invalid and the old one wins
+  uint32_t magic = CONFIG_MAGIC;
+  if (!flash.write(target, 0, &magic, sizeof(magic))) return false;
+
+  if (!slotHeader(target)) return false;
+  activeSlot = target;
+  return true;
+}
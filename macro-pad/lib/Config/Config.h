@@ -0,0 +1,150 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <stdint.h>
+#include "Keypad.h"
+#include "Key_Resolve.h"
+#include "Keymap.h"
+
+// --- Config Store Configuration ---
+#define CONFIG_MAGIC      0x4643504D  // "MPCF", written last: the commit mark
+#define CONFIG_VERSION    2           // 2: tap-dance and combo sections, resolve terms
+#define CONFIG_SLOT_SIZE  0x10000     // Two slots (A/B) in the "config" partition
+#define CONFIG_SECTOR_SIZE 0x1000     // Flash erase unit; a write erases only what it needs
+#define CONFIG_MAX_MACROS 64
+
+// --- Blob Format ---
+// One blob per slot, little-endian, read in place: the keymap and macro
+// engines get pointers straight into flash. All section offsets are from
+// the start of the blob and 4-byte aligned.
+//
+//   ConfigHeader
+//   KeyAction      keys[layers][rows][cols]
+//   EncoderBinding encoder[layers]
+//   TapDance       dances[danceCount]   (see Key_Resolve.h)
+//   Combo          combos[comboCount]
+//   uint32_t       macroOffsets[macroCount]
+//   uint8_t        macro bytecode (see MacroPad.h)
+struct ConfigSettings {
+  uint16_t scanHz;
+  uint8_t debounceMs;
+  uint8_t encoderPinA;
+  uint8_t encoderPinB;
+  uint8_t rowPins[KEYPAD_MAX_ROWS];
+  uint8_t colPins[KEYPAD_MAX_COLS];
+  uint8_t idleMinutes;     // Before the pad sleeps; 0 for POWER_IDLE_MS
+  uint8_t comboTermMs;     // 0 for RESOLVE_COMBO_TERM_MS
+  uint8_t reserved0;       // Zero
+  uint16_t tapTermMs;      // 0 for RESOLVE_TAP_TERM_MS
+  uint16_t replayGapMs;    // Longest pause when playing a recording; 0 keeps the recorded timing
+};
+
+struct ConfigHeader {
+  uint32_t magic;
+  uint32_t crc;            // CRC-32 of everything after this field, up to `length`
+  uint16_t version;
+  uint16_t headerLen;      // sizeof(ConfigHeader) of the writer
+  uint32_t sequence;       // Higher wins when both slots are valid
+  uint32_t length;         // Whole blob, header included
+  uint8_t layers;
+  uint8_t rows;
+  uint8_t cols;
+  uint8_t macroCount;
+  uint32_t keysOffset;
+  uint32_t encoderOffset;
+  uint32_t macrosOffset;
+  uint32_t dancesOffset;
+  uint32_t combosOffset;
+  uint8_t danceCount;
+  uint8_t comboCount;
+  uint8_t reserved[2];     // Zero
+  ConfigSettings settings;
+};
+
+// The blob is the in-memory layout, so it must not change silently
+static_assert(sizeof(KeyAction) == 4, "KeyAction layout is part of the config format");
+static_assert(sizeof(EncoderBinding) == 6, "EncoderBinding layout is part of the config format");
+static_assert(sizeof(TapDance) == 16, "TapDance layout is part of the config format");
+static_assert(sizeof(Combo) == 8, "Combo layout is part of the config format");
+static_assert(sizeof(ConfigHeader) == 84, "ConfigHeader layout is part of the config format");
+
+// Pointers into a validated blob
+struct ConfigView {
+  const ConfigHeader* header;
+  const ConfigSettings* settings;
+  const KeyAction* keys;
+  const EncoderBinding* encoder;
+  const uint8_t* macros[CONFIG_MAX_MACROS];
+  const TapDance* dances;
+  const Combo* combos;
+  uint8_t layers;
+  uint8_t rows;
+  uint8_t cols;
+  uint8_t macroCount;
+  uint8_t danceCount;
+  uint8_t comboCount;
+};
+
+// What config_build() serializes
+struct ConfigSource {
+  const ConfigSettings* settings;
+  const KeyAction* keys;  // [layers][rows][cols]
+  const EncoderBinding* encoder;  // [layers]
+  uint8_t layers;
+  uint8_t rows;
+  uint8_t cols;
+  const uint8_t* const* macros;
+  uint8_t macroCount;
+  const TapDance* dances;
+  uint8_t danceCount;
+  const Combo* combos;
+  uint8_t comboCount;
+};
+
+// --- Format (portable, no Arduino dependency) ---
+uint32_t config_crc32(const uint8_t* data, uint32_t len, uint32_t crc = 0);
+
+// Serialize src into out. Returns the blob length, or 0 when it does not
+// fit in cap or src is out of range. The blob gets sequence 0; the store
+// assigns the real one when it is written.
+uint32_t config_build(const ConfigSource* src, uint8_t* out, uint32_t cap);
+
+// Check magic, version, CRC, dimensions, combo keys, that the debounce time
+// fits the scan rate (see Debounce.h) and that every section and macro lies
+// inside the blob. Returns the header, or null if anything is off.
+const ConfigHeader* config_validate(const uint8_t* blob, uint32_t cap);
+
+// Fill view from a blob that passed config_validate()
+void config_view(const ConfigHeader* header, ConfigView* view);
+
+// Fill view from compiled-in data (header is null), so defaults and stored
+// configs are applied the same way
+void config_view_source(const ConfigSource* src, ConfigView* view);
+
+// --- A/B Store ---
+// Flash access for the store. Slots read through slot() (memory-mapped on
+// the ESP32); erase() clears the first len bytes of a slot, rounded up to
+// whole sectors, to 0xFF and write() can only clear bits.
+struct ConfigFlashIo {
+  const uint8_t* (*slot)(uint8_t slot);
+  bool (*erase)(uint8_t slot, uint32_t len);
+  bool (*write)(uint8_t slot, uint32_t offset, const void* data, uint32_t len);
+};
+
+void config_store_init(const ConfigFlashIo* io);
+
+// The valid blob with the highest sequence, or null when neither slot holds one
+const ConfigHeader* config_store_active();
+int8_t config_store_active_slot();
+
+// Write blob into the slot that is not active, with the next sequence
+// number. The magic word goes in last, so a write cut short by a power loss
+// leaves a slot that fails validation and the previous config stays active.
+// Returns false (and keeps the current config) on any error.
+bool config_store_write(const uint8_t* blob, uint32_t len);
+
+// Map the "config" partition and load the active blob (ESP32; the host
+// build uses a RAM flash). Returns false when no valid config is stored.
+bool config_begin(ConfigView* view);
+
+#endif // CONFIG_H
@@ -0,0 +1,192 @@
+#include "Config_Transfer.h"
+#include "Config.h"
+#include "Log.h"
+#include <atomic>
+#include <stdlib.h>
+#include <string.h>
+
+// The BLE task owns the buffer until it sets COMMITTED; the loop task owns it
+// from then until it goes back to IDLE. The one exception is an abort from
+// the loop task (config_transfer_expire()), so the pointer is atomic: whoever
+// takes it out of `buffer` holds it, and a task that finds it gone knows the
+// transfer was dropped under it.
+static std::atomic<uint8_t> state(CONFIG_XFER_IDLE);
+static uint8_t lastError;
+static std::atomic<uint8_t*> buffer(nullptr);
+static uint32_t expected;
+static uint32_t bytes;
+static uint32_t crc;
+static const uint8_t* readBlob;
+
+// Bumped by every command, chunk and read, so the loop task can tell an
+// idle transfer from a slow one
+static std::atomic<uint32_t> activity(0);
+static uint32_t activitySeen;
+static uint32_t activitySinceMs;
+
+static uint32_t readU32(const uint8_t* p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void release() {
+  free(buffer.exchange(nullptr));
+}
+
+// Hand back a buffer taken out to write into; freed instead if the transfer
+// was aborted meanwhile
+static void putBack(uint8_t* taken) {
+  buffer.store(taken);
+  if (state.load() != CONFIG_XFER_RECEIVING) release();
+}
+
+static void fail(ConfigTransferError error) {
+  lastError = error;
+  if (state.load() != CONFIG_XFER_COMMITTED) {
+    release();
+    state.store(CONFIG_XFER_IDLE);
+  }
+  LOG(LOG_EVT_CONFIG_XFER_FAILED, error, bytes);
+}
+
+static void beginWrite(uint32_t length) {
+  release();
+  if (length < sizeof(ConfigHeader) || length > CONFIG_SLOT_SIZE) return fail(CONFIG_XFER_TOO_LARGE);
+  uint8_t* allocated = (uint8_t*)malloc(length);
+  if (!allocated) return fail(CONFIG_XFER_TOO_LARGE);
+  buffer.store(allocated);
+  expected = length;
+  bytes = 0;
+  crc = 0;
+  lastError = CONFIG_XFER_OK;
+  state.store(CONFIG_XFER_RECEIVING);
+}
+
+static void commit(uint32_t peerCrc) {
+  if (state.load() != CONFIG_XFER_RECEIVING) return fail(CONFIG_XFER_BAD_COMMAND);
+  if (bytes != expected) return fail(CONFIG_XFER_LENGTH);
+  if (crc != peerCrc) return fail(CONFIG_XFER_CRC);
+  uint8_t* taken = buffer.exchange(nullptr);
+  if (!taken) return fail(CONFIG_XFER_ABANDONED);
+  bool valid = config_validate(taken, expected);
+  buffer.store(taken);
+  if (!valid) return fail(CONFIG_XFER_INVALID);
+  uint8_t receiving = CONFIG_XFER_RECEIVING;
+  if (!state.compare_exchange_strong(receiving, CONFIG_XFER_COMMITTED)) {
+    release();
+    return fail(CONFIG_XFER_ABANDONED);
+  }
+  lastError = CONFIG_XFER_OK;
+}
+
+static void beginRead() {
+  release();
+  readBlob = (const uint8_t*)config_store_active();
+  if (!readBlob) return fail(CONFIG_XFER_NO_CONFIG);
+  expected = ((const ConfigHeader*)readBlob)->length;
+  bytes = 0;
+  crc = 0;
+  lastError = CONFIG_XFER_OK;
+  state.store(CONFIG_XFER_READING);
+}
+
+void config_transfer_command(const uint8_t* data, uint32_t len) {
+  activity.fetch_add(1);
+  if (len == 0) return fail(CONFIG_XFER_BAD_COMMAND);
+  if (state.load() == CONFIG_XFER_COMMITTED) return fail(CONFIG_XFER_BUSY);
+
+  switch (data[0]) {
+    case CONFIG_CMD_BEGIN_WRITE:
+      if (len < 5) return fail(CONFIG_XFER_BAD_COMMAND);
+      return beginWrite(readU32(data + 1));
+    case CONFIG_CMD_COMMIT:
+      if (len < 5) return fail(CONFIG_XFER_BAD_COMMAND);
+      return commit(readU32(data + 1));
+    case CONFIG_CMD_ABORT:
+      release();
+      lastError = CONFIG_XFER_OK;
+      state.store(CONFIG_XFER_IDLE);
+      return;
+    case CONFIG_CMD_BEGIN_READ:
+      return beginRead();
+    default:
+      return fail(CONFIG_XFER_BAD_COMMAND);
+  }
+}
+
+void config_transfer_data(const uint8_t* data, uint32_t len) {
+  activity.fetch_add(1);
+  if (state.load() != CONFIG_XFER_RECEIVING) return;
+  uint8_t* taken = buffer.exchange(nullptr);
+  if (!taken) return;  // Aborted from the loop task
+  if (len > expected - bytes) {
+    putBack(taken);
+    return fail(CONFIG_XFER_OVERFLOW);
+  }
+  memcpy(taken + bytes, data, len);
+  crc = config_crc32(data, len, crc);
+  bytes += len;
+  putBack(taken);
+}
+
+uint32_t config_transfer_read(uint8_t* out, uint32_t maxLen) {
+  activity.fetch_add(1);
+  if (state.load() != CONFIG_XFER_READING) return 0;
+  uint32_t len = expected - bytes < maxLen ? expected - bytes : maxLen;
+  memcpy(out, readBlob + bytes, len);
+  crc = config_crc32(out, len, crc);
+  bytes += len;
+  if (bytes == expected) state.store(CONFIG_XFER_IDLE);
+  return len;
+}
+
+void config_transfer_status(ConfigTransferStatus* status) {
+  const ConfigHeader* active = config_store_active();
+  status->state = state.load();
+  status->error = lastError;
+  status->sequence = active ? active->sequence : 0;
+  status->bytes = bytes;
+  status->crc = crc;
+}
+
+bool config_transfer_active() {
+  return state.load() != CONFIG_XFER_IDLE;
+}
+
+void config_transfer_abort() {
+  uint8_t current = state.load();
+  while ((current == CONFIG_XFER_RECEIVING || current == CONFIG_XFER_READING) &&
+         !state.compare_exchange_weak(current, CONFIG_XFER_IDLE)) {}
+  if (current != CONFIG_XFER_RECEIVING && current != CONFIG_XFER_READING) return;
+
+  // A chunk being copied on the BLE task holds the buffer; putBack() frees it
+  release();
+  lastError = CONFIG_XFER_ABANDONED;
+  LOG(LOG_EVT_CONFIG_XFER_FAILED, CONFIG_XFER_ABANDONED, bytes);
+}
+
+bool config_transfer_expire(uint32_t nowMs) {
+  uint32_t seen = activity.load();
+  if (!config_transfer_active() || seen != activitySeen) {
+    activitySeen = seen;
+    activitySinceMs = nowMs;
+    return false;
+  }
+  if (nowMs - activitySinceMs < CONFIG_XFER_IDLE_MS || state.load() == CONFIG_XFER_COMMITTED) return false;
+  config_transfer_abort();
+  return true;
+}
+
+bool config_transfer_poll() {
+  if (state.load() != CONFIG_XFER_COMMITTED) return false;
+
+  bool stored = config_store_write(buffer.load(), expected);
+  lastError = stored ? CONFIG_XFER_OK : CONFIG_XFER_FLASH;
+  release();
+  state.store(CONFIG_XFER_IDLE);
+  if (stored) {
+    LOG(LOG_EVT_CONFIG_STORED, config_store_active_slot(), config_store_active()->sequence, expected);
+  } else {
+    LOG(LOG_EVT_CONFIG_XFER_FAILED, CONFIG_XFER_FLASH, expected);
+  }
+  return stored;
+}
@@ -0,0 +1,86 @@
+#ifndef CONFIG_TRANSFER_H
+#define CONFIG_TRANSFER_H
+
+#include <stdint.h>
+
+#define CONFIG_XFER_IDLE_MS 5000
+
+// --- Config Transfer ---
+// Moves whole config blobs (see Config.h) over a byte pipe such as the BLE
+// config service. Commands and data arrive on the BLE task; the flash write
+// happens in config_transfer_poll() on the loop task, so keys keep flowing
+// while a transfer is in progress.
+//
+// Writing: BEGIN_WRITE(length), then the blob as data chunks in order, then
+// COMMIT(crc). Every chunk is folded into a running CRC-32, so a lost or
+// damaged chunk is caught at COMMIT before anything touches flash.
+//
+// Reading: BEGIN_READ, then each config_transfer_read() returns the next
+// chunk of the active blob until it returns 0.
+//
+// A transfer that sees no command, chunk or read for CONFIG_XFER_IDLE_MS,
+// or whose peer disconnects, is aborted and its buffer freed, so an
+// abandoned upload never keeps the pad awake or holds the memory.
+//
+// Commands are one opcode byte followed by little-endian operands.
+enum ConfigTransferCommand : uint8_t {
+  CONFIG_CMD_BEGIN_WRITE = 0x01,  // u32 length
+  CONFIG_CMD_COMMIT      = 0x02,  // u32 CRC-32 of the whole blob
+  CONFIG_CMD_ABORT       = 0x03,
+  CONFIG_CMD_BEGIN_READ  = 0x04,
+};
+
+enum ConfigTransferState : uint8_t {
+  CONFIG_XFER_IDLE,
+  CONFIG_XFER_RECEIVING,
+  CONFIG_XFER_COMMITTED,  // Checked; waiting for the loop task to store it
+  CONFIG_XFER_READING,
+};
+
+enum ConfigTransferError : uint8_t {
+  CONFIG_XFER_OK,
+  CONFIG_XFER_BAD_COMMAND,
+  CONFIG_XFER_BUSY,        // A committed blob has not been stored yet
+  CONFIG_XFER_TOO_LARGE,   // Longer than a slot, or out of memory
+  CONFIG_XFER_OVERFLOW,    // More data than BEGIN_WRITE announced
+  CONFIG_XFER_LENGTH,      // COMMIT before all data arrived
+  CONFIG_XFER_CRC,         // Running CRC does not match COMMIT
+  CONFIG_XFER_INVALID,     // Blob fails config_validate()
+  CONFIG_XFER_FLASH,       // Store write failed; the old config is kept
+  CONFIG_XFER_NO_CONFIG,   // BEGIN_READ with nothing stored
+  CONFIG_XFER_ABANDONED,   // Peer went quiet or disconnected mid-transfer
+};
+
+// Status as sent to the peer: 12 bytes, little-endian
+struct ConfigTransferStatus {
+  uint8_t state;
+  uint8_t error;      // Result of the last command or commit
+  uint16_t sequence;  // Low bits of the active config's sequence
+  uint32_t bytes;     // Received so far (writing) or sent so far (reading)
+  uint32_t crc;       // Running CRC-32 of those bytes
+};
+
+static_assert(sizeof(ConfigTransferStatus) == 12, "ConfigTransferStatus is sent as is");
+
+void config_transfer_command(const uint8_t* data, uint32_t len);
+void config_transfer_data(const uint8_t* data, uint32_t len);
+
+// Copy up to maxLen bytes of the blob being read into out
+uint32_t config_transfer_read(uint8_t* out, uint32_t maxLen);
+
+void config_transfer_status(ConfigTransferStatus* status);
+bool config_transfer_active();  // A transfer is under way in either direction
+
+// Drop a transfer in either direction, as CONFIG_XFER_ABANDONED. A
+// committed blob is left for config_transfer_poll(). Safe from any task.
+void config_transfer_abort();
+
+// Loop task: abort a transfer idle for CONFIG_XFER_IDLE_MS. Returns true
+// when it did.
+bool config_transfer_expire(uint32_t nowMs);
+
+// Loop task: store a committed blob. Returns true when a new config became
+// active and should be applied.
+bool config_transfer_poll();
+
+#endif // CONFIG_TRANSFER_H
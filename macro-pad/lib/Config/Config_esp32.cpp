@@ -0,0 +1,64 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <esp_partition.h>
+#include "Config.h"
+
+// Data partition "config" (see partitions.csv): slot A in the first
+// CONFIG_SLOT_SIZE bytes, slot B in the next. Both stay memory-mapped so
+// the active blob is read in place through the flash cache.
+#define CONFIG_PARTITION_LABEL   "config"
+#define CONFIG_PARTITION_SUBTYPE ((esp_partition_subtype_t)0x40)
+
+static const esp_partition_t* partition;
+static const uint8_t* mapped[2];
+static spi_flash_mmap_handle_t mapHandle[2];
+
+static bool mapSlot(uint8_t slot) {
+  if (mapped[slot]) spi_flash_munmap(mapHandle[slot]);
+  mapped[slot] = nullptr;
+  const void* ptr;
+  if (esp_partition_mmap(partition, slot * CONFIG_SLOT_SIZE, CONFIG_SLOT_SIZE,
+                         SPI_FLASH_MMAP_DATA, &ptr, &mapHandle[slot]) != ESP_OK) {
+    return false;
+  }
+  mapped[slot] = (const uint8_t*)ptr;
+  return true;
+}
+
+static const uint8_t* flashSlot(uint8_t slot) {
+  return mapped[slot];
+}
+
+// Remapping after a change makes sure no stale cache lines are read back
+static bool flashErase(uint8_t slot, uint32_t len) {
+  len = (len + CONFIG_SECTOR_SIZE - 1) & ~(CONFIG_SECTOR_SIZE - 1);
+  if (esp_partition_erase_range(partition, slot * CONFIG_SLOT_SIZE, len) != ESP_OK) return false;
+  return mapSlot(slot);
+}
+
+static bool flashWrite(uint8_t slot, uint32_t offset, const void* data, uint32_t len) {
+  if (esp_partition_write(partition, slot * CONFIG_SLOT_SIZE + offset, data, len) != ESP_OK) return false;
+  return mapSlot(slot);
+}
+
+static const ConfigFlashIo esp32Flash = {
+  flashSlot,
+  flashErase,
+  flashWrite,
+};
+
+bool config_begin(ConfigView* view) {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, CONFIG_PARTITION_SUBTYPE,
+                                       CONFIG_PARTITION_LABEL);
+  if (!partition || partition->size < 2 * CONFIG_SLOT_SIZE) return false;
+  if (!mapSlot(0) || !mapSlot(1)) return false;
+
+  config_store_init(&esp32Flash);
+  const ConfigHeader* active = config_store_active();
+  if (!active) return false;
+  config_view(active, view);
+  return true;
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,121 @@
+#include "Debounce.h"
+#include <string.h>
+
+// Each row keeps its debounced state plus DEBOUNCE_COUNTER_BITS bit planes.
+// Bit c of plane p is bit p of key c's counter, so a whole row of counters
+// is incremented, reset or compared with a handful of word operations.
+struct RowState {
+  uint16_t stable;
+  uint16_t plane[DEBOUNCE_COUNTER_BITS];
+};
+
+static RowState rowState[DEBOUNCE_MAX_ROWS];
+static uint8_t numRows;
+static uint8_t threshold;
+
+// Mask of keys whose counter equals value
+static inline uint16_t counterEquals(const RowState& s, uint8_t value) {
+  uint16_t eq = 0xFFFF;
+  for (uint8_t p = 0; p < DEBOUNCE_COUNTER_BITS; p++) {
+    eq &= ((value >> p) & 1) ? s.plane[p] : (uint16_t)~s.plane[p];
+  }
+  return eq;
+}
+
+static inline void counterIncrement(RowState& s, uint16_t mask) {
+  uint16_t carry = mask;
+  for (uint8_t p = 0; p < DEBOUNCE_COUNTER_BITS && carry; p++) {
+    uint16_t next = s.plane[p] & carry;
+    s.plane[p] ^= carry;
+    carry = next;
+  }
+}
+
+static inline void counterDecrement(RowState& s, uint16_t mask) {
+  uint16_t borrow = mask;
+  for (uint8_t p = 0; p < DEBOUNCE_COUNTER_BITS && borrow; p++) {
+    uint16_t next = (uint16_t)~s.plane[p] & borrow;
+    s.plane[p] ^= borrow;
+    borrow = next;
+  }
+}
+
+static inline void counterClear(RowState& s, uint16_t mask) {
+  for (uint8_t p = 0; p < DEBOUNCE_COUNTER_BITS; p++) {
+    s.plane[p] &= ~mask;
+  }
+}
+
+void debounce_init(uint8_t rows, uint8_t thresholdScans) {
+  numRows = rows > DEBOUNCE_MAX_ROWS ? DEBOUNCE_MAX_ROWS : rows;
+  if (thresholdScans < 1) thresholdScans = 1;
+  if (thresholdScans > DEBOUNCE_MAX_SCANS) thresholdScans = DEBOUNCE_MAX_SCANS;
+  threshold = thresholdScans;
+  memset(rowState, 0, sizeof(rowState));
+}
+
+uint8_t debounce_scans_for(uint16_t debounceMs, uint16_t scanHz) {
+  uint32_t scans = (uint32_t)debounceMs * scanHz / 1000;
+  if (scans < 1) return 1;
+  if (scans > DEBOUNCE_MAX_SCANS) return DEBOUNCE_MAX_SCANS;
+  return scans;
+}
+
+bool debounce_time_fits(uint16_t debounceMs, uint16_t scanHz) {
+  return (uint32_t)debounceMs * scanHz / 1000 <= DEBOUNCE_MAX_SCANS;
+}
+
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_INTEGRATOR
+
+uint16_t debounce_update(uint8_t row, uint16_t sample) {
+  RowState& s = rowState[row];
+
+  // Closed samples count up towards the threshold, open samples down to 0
+  uint16_t up = sample & ~counterEquals(s, threshold);
+  uint16_t down = ~sample & ~counterEquals(s, 0);
+  counterIncrement(s, up);
+  counterDecrement(s, down);
+
+  uint16_t next = (s.stable | counterEquals(s, threshold)) & ~counterEquals(s, 0);
+  uint16_t changed = next ^ s.stable;
+  s.stable = next;
+  return changed;
+}
+
+#else // DEBOUNCE_EAGER / DEBOUNCE_SYMMETRIC
+
+uint16_t debounce_update(uint8_t row, uint16_t sample) {
+  RowState& s = rowState[row];
+
+  // Count consecutive samples that disagree with the debounced state;
+  // any sample that agrees again restarts the count.
+  uint16_t diff = sample ^ s.stable;
+  counterClear(s, ~diff);
+  if (diff == 0) return 0;
+  counterIncrement(s, diff);
+
+  uint16_t changed = diff & counterEquals(s, threshold);
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER
+  changed |= diff & sample;  // Presses are accepted on the first closed sample
+#endif
+
+  s.stable ^= changed;
+  counterClear(s, changed);
+  return changed;
+}
+
+#endif
+
+uint16_t debounce_state(uint8_t row) {
+  return row < numRows ? rowState[row].stable : 0;
+}
+
+const char* debounce_algorithm_name() {
+#if DEBOUNCE_ALGORITHM == DEBOUNCE_EAGER
+  return "eager";
+#elif DEBOUNCE_ALGORITHM == DEBOUNCE_INTEGRATOR
+  return "integrator";
+#else
+  return "symmetric";
+#endif
+}
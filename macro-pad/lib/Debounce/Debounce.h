@@ -0,0 +1,40 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include <stdint.h>
+
+// --- Debounce Algorithms ---
+// Select one per build, e.g. build_flags = -DDEBOUNCE_ALGORITHM=DEBOUNCE_INTEGRATOR
+#define DEBOUNCE_EAGER       1  // Press reported on first closed sample, release after N stable samples
+#define DEBOUNCE_INTEGRATOR  2  // Per-key up/down counter, edge when it saturates at 0 or N
+#define DEBOUNCE_SYMMETRIC   3  // Press and release both reported after N stable samples
+
+#ifndef DEBOUNCE_ALGORITHM
+#define DEBOUNCE_ALGORITHM DEBOUNCE_EAGER
+#endif
+
+#define DEBOUNCE_MAX_ROWS     8
+#define DEBOUNCE_COUNTER_BITS 6   // Counters are stored as bit planes, one bit per key
+                                  // (63 scans: 15 ms at the fastest scan rate)
+#define DEBOUNCE_MAX_SCANS    ((1 << DEBOUNCE_COUNTER_BITS) - 1)
+
+// Reset all keys to released. thresholdScans is clamped to 1..DEBOUNCE_MAX_SCANS.
+void debounce_init(uint8_t rows, uint8_t thresholdScans);
+
+// Convert a debounce time to a scan count for the given scan rate, clamped
+// to 1..DEBOUNCE_MAX_SCANS
+uint8_t debounce_scans_for(uint16_t debounceMs, uint16_t scanHz);
+
+// False when the debounce time needs more scans than a counter holds
+bool debounce_time_fits(uint16_t debounceMs, uint16_t scanHz);
+
+// Feed one raw row sample (bit set = switch closed). Returns the mask of
+// keys in that row whose debounced state changed.
+uint16_t debounce_update(uint8_t row, uint16_t sample);
+
+// Current debounced state of a row
+uint16_t debounce_state(uint8_t row);
+
+const char* debounce_algorithm_name();
+
+#endif // DEBOUNCE_H
@@ -0,0 +1,87 @@
+#include "Input_Bus.h"
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+static const char* const sourceNames[INPUT_SOURCE_COUNT] = {
+  "keypad",
+  "encoder",
+};
+
+// The producer writes head and the stats, the consumer writes tail
+struct InputRing {
+  InputEvent events[INPUT_RING_LEN];
+  std::atomic<uint8_t> head;
+  std::atomic<uint8_t> tail;
+  InputBusStats stats;
+};
+
+static InputRing rings[INPUT_SOURCE_COUNT];
+
+void input_init() {
+  for (InputRing& ring : rings) {
+    ring.head.store(0);
+    ring.tail.store(0);
+    memset(&ring.stats, 0, sizeof(ring.stats));
+  }
+}
+
+bool input_push(const InputEvent* event, bool again) {
+  if (event->source >= INPUT_SOURCE_COUNT) return false;
+  InputRing& ring = rings[event->source];
+  uint8_t head = ring.head.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) & (INPUT_RING_LEN - 1);
+  uint8_t tail = ring.tail.load(std::memory_order_acquire);
+  if (next == tail) {
+    if (!again) ring.stats.refused++;
+    return false;
+  }
+  ring.events[head] = *event;
+  ring.head.store(next, std::memory_order_release);
+
+  uint8_t depth = (next - tail) & (INPUT_RING_LEN - 1);
+  if (depth > ring.stats.highWater) ring.stats.highWater = depth;
+  ring.stats.pushed++;
+  return true;
+}
+
+// Sources are merged by timestamp, so a key and a detent reach the
+// processing stage in the order they happened
+bool input_read(InputEvent* event) {
+  InputRing* oldest = nullptr;
+  uint8_t oldestTail = 0;
+  for (InputRing& ring : rings) {
+    uint8_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail == ring.head.load(std::memory_order_acquire)) continue;
+    if (!oldest || (int32_t)(ring.events[tail].timestamp - oldest->events[oldestTail].timestamp) < 0) {
+      oldest = &ring;
+      oldestTail = tail;
+    }
+  }
+  if (!oldest) return false;
+
+  *event = oldest->events[oldestTail];
+  oldest->tail.store((oldestTail + 1) & (INPUT_RING_LEN - 1), std::memory_order_release);
+  return true;
+}
+
+void input_get_stats(InputSource source, InputBusStats* stats) {
+  if (source < INPUT_SOURCE_COUNT) *stats = rings[source].stats;
+}
+
+const char* input_source_name(InputSource source) {
+  return source < INPUT_SOURCE_COUNT ? sourceNames[source] : "?";
+}
+
+size_t input_format(char* buffer, size_t size) {
+  size_t len = 0;
+  for (uint8_t i = 0; i < INPUT_SOURCE_COUNT && len + 1 < size; i++) {
+    const InputBusStats& s = rings[i].stats;
+    int n = snprintf(buffer + len, size - len, "Input %s: %u events, %u held back, high water %u/%u\n",
+                     sourceNames[i], (unsigned)s.pushed, (unsigned)s.refused, s.highWater,
+                     INPUT_RING_LEN - 1);
+    if (n < 0) break;
+    len += (size_t)n < size - len ? n : size - len - 1;
+  }
+  return len;
+}
@@ -0,0 +1,63 @@
+#ifndef INPUT_BUS_H
+#define INPUT_BUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Input Bus Configuration ---
+#define INPUT_RING_LEN 32  // Events per source, must be a power of two
+
+// Every producer owns one ring, so each ring has a single producer (an ISR
+// or the scan task) and the loop task as its single consumer. Adding a
+// source is one more entry here.
+enum InputSource : uint8_t {
+  INPUT_SOURCE_KEYPAD,
+  INPUT_SOURCE_ENCODER,
+  INPUT_SOURCE_COUNT
+};
+
+enum InputType : uint8_t {
+  INPUT_KEY,       // row, col; value 1 = pressed, 0 = released
+  INPUT_ROTATION,  // value = signed detents, negative is counter-clockwise
+};
+
+// Fixed size, copied by value through the rings
+struct InputEvent {
+  uint8_t type;    // InputType
+  uint8_t source;  // InputSource, also selects the ring
+  uint8_t row;
+  uint8_t col;
+  int32_t value;
+  uint32_t timestamp;     // micros() when the producer accepted the input
+  uint32_t detectCycles;  // Latency trace (see Latency.h); 0 when untraced
+  uint32_t acceptCycles;
+};
+
+static_assert(sizeof(InputEvent) == 20, "InputEvent is copied through the rings");
+
+struct InputBusStats {
+  uint32_t pushed;
+  uint32_t refused;    // Events turned away by a full ring, once each; producers push them again
+  uint8_t highWater;   // Deepest the ring has been
+};
+
+// Portable core (no Arduino dependency). Rings are static; nothing allocates.
+// Clear every ring; call before any producer starts
+void input_init();
+
+// Producer side, safe from an ISR: lock free, no waiting. Only the owner of
+// event->source may push to it. Returns false when the ring is full; the
+// producer keeps the event and pushes it again with `again` set, so it is
+// counted as refused only the first time.
+bool input_push(const InputEvent* event, bool again = false);
+
+// Consumer side (loop task): the oldest event across all sources
+bool input_read(InputEvent* event);
+
+void input_get_stats(InputSource source, InputBusStats* stats);
+const char* input_source_name(InputSource source);
+
+// Text dump for the serial command
+size_t input_format(char* buffer, size_t size);
+
+#endif // INPUT_BUS_H
@@ -0,0 +1,395 @@
+#include "Key_Resolve.h"
+#include "BLE_HID.h"
+#include "Log.h"
+#include <string.h>
+
+#define RESOLVE_KEYS 128  // resolve_key() space: 8 rows of 16 columns
+
+// A matrix edge waiting behind an open decision
+struct Edge {
+  uint32_t us;
+  uint8_t key;
+  bool pressed;
+  bool noCombo;  // Already found not to start a combo
+};
+
+// What the release of a held key has to undo
+enum HeldKind : uint8_t {
+  HELD_NONE,    // Not held, or the rest of a combo that already ended
+  HELD_KEYMAP,  // Plain key; the keymap remembers the layer it resolved on
+  HELD_ACTION,  // The dance action in held[]
+  HELD_HOLD,    // Tap-hold key held: modifiers and layer of held[]
+  HELD_COMBO,   // Member of combo held[].code
+};
+
+// Logged with LOG_EVT_KEY_RESOLVED
+enum ResolveOutcome : uint8_t {
+  RESOLVED_TAP,
+  RESOLVED_HOLD,
+  RESOLVED_DANCE,
+  RESOLVED_COMBO,
+};
+
+enum ComboResult : uint8_t {
+  COMBO_WAIT,
+  COMBO_FIRED,
+  COMBO_NONE,
+};
+
+static ResolveIo io;
+static const TapDance* danceTable;
+static uint8_t danceCount;
+static const Combo* comboTable;
+static uint8_t comboCount;
+static uint32_t tapTermUs;
+static uint32_t comboTermUs;
+
+// Oldest first; only the head is ever decided
+static Edge queue[RESOLVE_QUEUE_LEN];
+static uint8_t queued;
+
+static uint8_t heldKind[RESOLVE_KEYS];
+static KeyAction held[RESOLVE_KEYS];
+static uint8_t comboKeys[RESOLVE_KEYS / 8];  // Bit set for keys in any combo
+
+static ResolveStats stats;
+
+static inline uint8_t keyRow(uint8_t key) { return key >> 4; }
+static inline uint8_t keyCol(uint8_t key) { return key & 0x0F; }
+
+static inline bool inCombo(uint8_t key) {
+  return (comboKeys[key >> 3] >> (key & 7)) & 1;
+}
+
+// Timestamps wrap with micros(); compare by difference
+static inline bool elapsed(uint32_t from, uint32_t to, uint32_t term) {
+  return (int32_t)(to - from) >= (int32_t)term;
+}
+
+static void removeEdge(uint8_t i) {
+  memmove(&queue[i], &queue[i + 1], (queued - i - 1) * sizeof(Edge));
+  queued--;
+}
+
+// sinceUs is the edge the decision waited on: the press that opened it,
+// or the last tap of a dance
+static void resolved(uint8_t key, ResolveOutcome outcome, uint32_t sinceUs, uint32_t now) {
+  uint32_t delay = now - sinceUs;
+  if (delay > stats.maxDelayUs) stats.maxDelayUs = delay;
+  LOG(LOG_EVT_KEY_RESOLVED, key, outcome, delay);
+}
+
+// Edges run from the queue can come several to a pass, so each gets its own
+// report
+static void run(const KeyAction* action, bool pressed) {
+  io.run(action, pressed);
+  io.flush();
+}
+
+static void runHold(const KeyAction* action, bool pressed) {
+  KeyAction mods = {ACTION_KEYBOARD, action->mods, 0};
+  KeyAction layer = action_layer(LAYER_MOMENTARY, action->code >> 8);
+  bool hasLayer = (action->code >> 8) != 0xFF;
+  if (pressed) {
+    if (action->mods) io.run(&mods, true);
+    if (hasLayer) io.run(&layer, true);
+  } else {
+    if (hasLayer) io.run(&layer, false);
+    if (action->mods) io.run(&mods, false);
+  }
+  io.flush();
+}
+
+static void release(uint8_t key) {
+  switch (heldKind[key]) {
+    case HELD_KEYMAP:
+      io.key(keyRow(key), keyCol(key), false);
+      io.flush();
+      break;
+    case HELD_ACTION:
+      run(&held[key], false);
+      break;
+    case HELD_HOLD:
+      runHold(&held[key], false);
+      break;
+    case HELD_COMBO: {
+      // The first member up ends the combo; the others' releases are dropped
+      const Combo* combo = &comboTable[held[key].code];
+      for (uint8_t k : combo->keys) {
+        if (k != RESOLVE_NO_KEY && heldKind[k] == HELD_COMBO && held[k].code == held[key].code) {
+          heldKind[k] = HELD_NONE;
+        }
+      }
+      run(&combo->action, false);
+      break;
+    }
+  }
+  heldKind[key] = HELD_NONE;
+}
+
+// --- Combos ---
+
+// Presses of distinct combo keys at the head of the queue, inside the combo
+// term of the first. The longest run that is exactly a combo fires, unless
+// the run could still grow into a larger one.
+static uint8_t decideCombo(uint32_t now) {
+  const Edge& head = queue[0];
+  uint8_t keys[RESOLVE_COMBO_KEYS];
+  uint8_t n = 0;
+  bool closed = queued == RESOLVE_QUEUE_LEN || elapsed(head.us, now, comboTermUs);
+  for (uint8_t i = 0; i < queued; i++) {
+    const Edge& e = queue[i];
+    bool repeat = memchr(keys, e.key, n) != nullptr;
+    if (!e.pressed || !inCombo(e.key) || repeat || n == RESOLVE_COMBO_KEYS ||
+        elapsed(head.us, e.us, comboTermUs)) {
+      closed = true;
+      break;
+    }
+    keys[n++] = e.key;
+  }
+
+  int16_t best = -1;
+  uint8_t bestLen = 0;
+  bool wider = false;
+  for (uint8_t c = 0; c < comboCount; c++) {
+    const Combo* combo = &comboTable[c];
+    uint8_t size = 0;
+    for (uint8_t k : combo->keys) size += k != RESOLVE_NO_KEY;
+    if (size < 2) continue;
+
+    // How many of the run's keys, from the first, the combo takes in
+    uint8_t matched = 0;
+    while (matched < n && memchr(combo->keys, keys[matched], RESOLVE_COMBO_KEYS)) matched++;
+    if (matched == size && size > bestLen) {
+      best = c;
+      bestLen = size;
+    }
+    if (matched == n && size > n) wider = true;
+  }
+
+  if (wider && !closed) return COMBO_WAIT;
+  if (best < 0) return COMBO_NONE;
+
+  resolved(head.key, RESOLVED_COMBO, head.us, now);
+  for (uint8_t i = 0; i < bestLen; i++) {
+    heldKind[keys[i]] = HELD_COMBO;
+    held[keys[i]].code = best;
+  }
+  for (uint8_t i = 0; i < bestLen; i++) removeEdge(0);
+  stats.combos++;
+  run(&comboTable[best].action, true);
+  return COMBO_FIRED;
+}
+
+// --- Tap-Hold ---
+
+static bool decideTapHold(const KeyAction* action, uint32_t now) {
+  const Edge head = queue[0];
+  uint8_t down[RESOLVE_QUEUE_LEN];  // Other keys pressed since
+  uint8_t downCount = 0;
+  int8_t releasedAt = -1;
+  bool hold = false;
+
+  for (uint8_t i = 1; i < queued && releasedAt < 0 && !hold; i++) {
+    const Edge& e = queue[i];
+    if (elapsed(head.us, e.us, tapTermUs)) {
+      hold = true;
+    } else if (e.key == head.key) {
+      if (!e.pressed) releasedAt = i;
+    } else if (e.pressed) {
+      down[downCount++] = e.key;
+    } else if (memchr(down, e.key, downCount)) {
+      hold = true;  // Permissive hold: a whole key press inside this one
+    }
+  }
+  if (releasedAt < 0 && !hold) {
+    if (!elapsed(head.us, now, tapTermUs) && queued < RESOLVE_QUEUE_LEN) return false;
+    hold = true;
+  }
+
+  if (hold) {
+    resolved(head.key, RESOLVED_HOLD, head.us, now);
+    removeEdge(0);
+    stats.holds++;
+    heldKind[head.key] = HELD_HOLD;
+    held[head.key] = *action;
+    runHold(action, true);
+  } else {
+    resolved(head.key, RESOLVED_TAP, head.us, now);
+    removeEdge(releasedAt);
+    removeEdge(0);
+    stats.taps++;
+    KeyAction tap = action_key(action->code & 0xFF);
+    run(&tap, true);
+    run(&tap, false);
+  }
+  return true;
+}
+
+// --- Tap-Dance ---
+
+static bool decideDance(const KeyAction* action, uint32_t now) {
+  const Edge head = queue[0];
+  if (action->code >= danceCount) {
+    removeEdge(0);  // No such dance; the key does nothing
+    return true;
+  }
+  const TapDance* dance = &danceTable[action->code];
+  uint8_t steps = RESOLVE_DANCE_TAPS;
+  while (steps > 1 && dance->taps[steps - 1].type == ACTION_NONE) steps--;
+
+  // Follow the key's own edges until another key, a gap of a whole tap
+  // term or the last step ends the dance
+  uint8_t taps = 1;
+  bool down = true;
+  uint32_t lastUs = head.us;
+  uint8_t used = 1;
+  bool done = taps == steps;
+  for (uint8_t i = 1; i < queued && !done; i++) {
+    const Edge& e = queue[i];
+    if (e.key != head.key || elapsed(lastUs, e.us, tapTermUs)) {
+      done = true;
+      break;
+    }
+    if (e.pressed) taps++;
+    down = e.pressed;
+    lastUs = e.us;
+    used = i + 1;
+    if (taps == steps) done = true;
+  }
+  // The last step decides at its press, and its release stays queued
+  if (!done && !elapsed(lastUs, now, tapTermUs) && queued < RESOLVE_QUEUE_LEN) return false;
+
+  resolved(head.key, RESOLVED_DANCE, lastUs, now);
+  for (uint8_t i = 0; i < used; i++) removeEdge(0);
+  stats.dances++;
+  const KeyAction* step = &dance->taps[taps - 1];
+  if (down) {
+    heldKind[head.key] = HELD_ACTION;
+    held[head.key] = *step;
+    run(step, true);
+  } else {
+    run(step, true);
+    run(step, false);
+  }
+  return true;
+}
+
+// --- Queue ---
+
+// Decide the oldest edge if it can be; false while it has to wait
+static bool decideHead(uint32_t now) {
+  Edge& e = queue[0];
+  if (!e.pressed) {
+    uint8_t key = e.key;
+    removeEdge(0);
+    release(key);
+    return true;
+  }
+
+  if (!e.noCombo && inCombo(e.key)) {
+    uint8_t result = decideCombo(now);
+    if (result == COMBO_WAIT) return false;
+    if (result == COMBO_FIRED) return true;
+    e.noCombo = true;
+  }
+
+  const KeyAction* action = io.lookup(keyRow(e.key), keyCol(e.key));
+  if (action->type == ACTION_TAP_HOLD) return decideTapHold(action, now);
+  if (action->type == ACTION_TAP_DANCE) return decideDance(action, now);
+
+  uint32_t delay = now - e.us;
+  if (delay > stats.maxDelayUs) stats.maxDelayUs = delay;
+  uint8_t key = e.key;
+  removeEdge(0);
+  heldKind[key] = HELD_KEYMAP;
+  io.key(keyRow(key), keyCol(key), true);
+  io.flush();
+  return true;
+}
+
+static void process(uint32_t now) {
+  while (queued && decideHead(now)) {}
+}
+
+void resolve_init(const TapDance* dances, uint8_t dCount,
+                  const Combo* combos, uint8_t cCount,
+                  uint16_t tapTermMs, uint8_t comboTermMs, const ResolveIo* output) {
+  io = *output;
+  danceTable = dances;
+  danceCount = dances ? dCount : 0;
+  comboTable = combos;
+  comboCount = combos ? cCount : 0;
+  tapTermUs = (tapTermMs ? tapTermMs : RESOLVE_TAP_TERM_MS) * 1000UL;
+  comboTermUs = (comboTermMs ? comboTermMs : RESOLVE_COMBO_TERM_MS) * 1000UL;
+
+  queued = 0;
+  memset(heldKind, 0, sizeof(heldKind));
+  memset(comboKeys, 0, sizeof(comboKeys));
+  for (uint8_t c = 0; c < comboCount; c++) {
+    for (uint8_t k : comboTable[c].keys) {
+      if (k < RESOLVE_KEYS) comboKeys[k >> 3] |= 1 << (k & 7);
+    }
+  }
+  memset(&stats, 0, sizeof(stats));
+}
+
+void resolve_key_event(uint8_t row, uint8_t col, bool pressed, uint32_t timestampUs) {
+  if (row >= RESOLVE_KEYS / 16 || col >= 16) return;
+  uint8_t key = resolve_key(row, col);
+
+  // Nothing waiting and nothing to decide: straight through, and the
+  // caller's report covers it
+  if (!queued) {
+    if (!pressed && heldKind[key] == HELD_KEYMAP) {
+      heldKind[key] = HELD_NONE;
+      io.key(row, col, false);
+      return;
+    }
+    if (pressed && !inCombo(key)) {
+      uint8_t type = io.lookup(row, col)->type;
+      if (type != ACTION_TAP_HOLD && type != ACTION_TAP_DANCE) {
+        heldKind[key] = HELD_KEYMAP;
+        io.key(row, col, true);
+        return;
+      }
+    }
+  }
+
+  // A full queue decides its head, so this always makes room
+  while (queued == RESOLVE_QUEUE_LEN) process(timestampUs);
+  if (pressed) stats.deferred++;
+  queue[queued++] = Edge{timestampUs, key, pressed, false};
+  process(timestampUs);
+}
+
+void resolve_poll(uint32_t nowUs) {
+  process(nowUs);
+}
+
+bool resolve_busy() {
+  return queued != 0;
+}
+
+void resolve_get_stats(ResolveStats* out) {
+  *out = stats;
+}
+
+// --- Keymap Binding ---
+
+static void hidKey(uint8_t row, uint8_t col, bool pressed) {
+  const KeyAction* action = keymap_key_event(row, col, pressed);
+  if (pressed) {
+    LOG(LOG_EVT_KEY_PRESSED, row, col, action->code);
+  } else {
+    LOG(LOG_EVT_KEY_RELEASED, row, col, action->code);
+  }
+}
+
+static const ResolveIo hidIo = {hidKey, keymap_lookup, keymap_run, ble_hid_flush};
+
+void resolve_begin(const TapDance* dances, uint8_t dCount,
+                   const Combo* combos, uint8_t cCount,
+                   uint16_t tapTermMs, uint8_t comboTermMs) {
+  resolve_init(dances, dCount, combos, cCount, tapTermMs, comboTermMs, &hidIo);
+}
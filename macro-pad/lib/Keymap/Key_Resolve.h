@@ -0,0 +1,108 @@
+#ifndef KEY_RESOLVE_H
+#define KEY_RESOLVE_H
+
+#include <stdint.h>
+#include "Keymap.h"
+
+// --- Key Resolution Configuration ---
+#define RESOLVE_QUEUE_LEN      16   // Edges held back while a decision is open
+#define RESOLVE_TAP_TERM_MS    200  // Default tap-hold and tap-dance decision time
+#define RESOLVE_COMBO_TERM_MS  40   // Default window for all keys of a combo
+#define RESOLVE_DANCE_TAPS     4
+#define RESOLVE_COMBO_KEYS     4
+#define RESOLVE_MAX_DANCES     16
+#define RESOLVE_MAX_COMBOS     16
+#define RESOLVE_NO_KEY         0xFF
+
+// --- Key Resolution ---
+// Sits between the input bus and the keymap, and turns matrix edges into
+// actions where one edge is not enough to know which action is meant:
+//
+//   Tap-hold (ACTION_TAP_HOLD): released within the tap term, the key taps
+//   its usage; held past it, it holds modifiers and/or a layer. Permissive
+//   hold: another key pressed and released while it is down decides hold
+//   at once, so a quick chord never has to wait out the term.
+//
+//   Tap-dance (ACTION_TAP_DANCE): the number of taps, each within the tap
+//   term of the last, picks one of up to RESOLVE_DANCE_TAPS actions. The
+//   last tap may be held, and then holds its action.
+//
+//   Combos: two to RESOLVE_COMBO_KEYS keys pressed within the combo term of
+//   the first run their own action instead of their own keys. The action is
+//   released with the first of them.
+//
+// Edges that arrive while a decision is open wait behind it in order, so
+// a decision can never reorder typing. Every decision is made no later than
+// one term after the edge that opened it (the last tap for a dance), as
+// long as resolve_poll() runs; a full queue decides at once. A key that is
+// neither of the above nor part of a combo goes straight to the keymap
+// when nothing is waiting, with no added latency.
+
+// Tap-dance definition, 16 bytes: taps[n] runs for n + 1 taps. The dance
+// ends early at the last action that is not ACTION_NONE.
+struct TapDance {
+  KeyAction taps[RESOLVE_DANCE_TAPS];
+};
+
+// Combo definition, 8 bytes: keys are resolve_key() positions, unused
+// entries RESOLVE_NO_KEY
+struct Combo {
+  uint8_t keys[RESOLVE_COMBO_KEYS];
+  KeyAction action;
+};
+
+// Matrix position as used in Combo.keys
+constexpr uint8_t resolve_key(uint8_t row, uint8_t col) {
+  return (uint8_t)(row << 4 | col);
+}
+
+constexpr Combo combo2(uint8_t a, uint8_t b, KeyAction action) {
+  return Combo{{a, b, RESOLVE_NO_KEY, RESOLVE_NO_KEY}, action};
+}
+
+constexpr Combo combo3(uint8_t a, uint8_t b, uint8_t c, KeyAction action) {
+  return Combo{{a, b, c, RESOLVE_NO_KEY}, action};
+}
+
+// What the engine drives. key() runs a plain matrix edge through the
+// keymap (layers resolved on press), lookup() is the action a press would
+// resolve to now, run() runs a single action, and flush() sends a report,
+// so a tap made of two edges in one pass is still seen by the host.
+struct ResolveIo {
+  void (*key)(uint8_t row, uint8_t col, bool pressed);
+  const KeyAction* (*lookup)(uint8_t row, uint8_t col);
+  void (*run)(const KeyAction* action, bool pressed);
+  void (*flush)();
+};
+
+struct ResolveStats {
+  uint32_t taps;        // Tap-hold keys decided as a tap
+  uint32_t holds;       // ... and as a hold
+  uint32_t dances;
+  uint32_t combos;
+  uint32_t deferred;    // Presses that waited behind a decision
+  uint32_t maxDelayUs;  // Longest wait for a decision, from the press that
+                        // opened it (the last tap of a dance)
+};
+
+// Portable core (no Arduino dependency). Terms of 0 use the defaults.
+// Dances and combos are read in place and must outlive the engine.
+void resolve_init(const TapDance* dances, uint8_t danceCount,
+                  const Combo* combos, uint8_t comboCount,
+                  uint16_t tapTermMs, uint8_t comboTermMs, const ResolveIo* io);
+
+// A debounced matrix edge, timestamped in micros() (see Input_Bus.h)
+void resolve_key_event(uint8_t row, uint8_t col, bool pressed, uint32_t timestampUs);
+
+// Decide anything whose term has run out. Call every loop pass.
+void resolve_poll(uint32_t nowUs);
+
+bool resolve_busy();  // A decision is open
+void resolve_get_stats(ResolveStats* stats);
+
+// Bind to the keymap and the HID reports (ble_hid_flush)
+void resolve_begin(const TapDance* dances, uint8_t danceCount,
+                   const Combo* combos, uint8_t comboCount,
+                   uint16_t tapTermMs, uint8_t comboTermMs);
+
+#endif // KEY_RESOLVE_H
@@ -0,0 +1,132 @@
+#include "Keymap.h"
+#include "BLE_HID.h"
+#include <string.h>
+
+static const KeyAction* keys;  // [layers][rows][cols]
+static const EncoderBinding* encoderBindings;  // [layers]
+static uint8_t rowCount;
+static uint8_t colCount;
+
+// Bit n is set when layer n has a non-transparent action at that position
+static uint16_t definedLayers[KEYMAP_MAX_KEYS];
+static uint16_t encoderLayers;
+static uint8_t boundEncoderLayer;
+
+// Layer each held key was resolved on, so its release runs the same action
+static uint8_t heldLayer[KEYMAP_MAX_KEYS];
+
+// Several held actions can share a modifier (two shifted characters, say);
+// the modifier goes up only when the last of them is released.
+static uint8_t modifierRefs[8];
+
+static void applyModifiers(uint8_t mods, bool pressed) {
+  while (mods) {
+    uint8_t bit = __builtin_ctz(mods);
+    mods &= mods - 1;
+    if (pressed) {
+      if (modifierRefs[bit]++ == 0) ble_send_key(HID_KEY_LEFT_CTRL + bit, true);
+    } else if (modifierRefs[bit] && --modifierRefs[bit] == 0) {
+      ble_send_key(HID_KEY_LEFT_CTRL + bit, false);
+    }
+  }
+}
+
+static void handleNone(const KeyAction* action, bool pressed) {}
+
+static void handleKeyboard(const KeyAction* action, bool pressed) {
+  // Modifiers go down before the key and come up after it
+  if (pressed) applyModifiers(action->mods, true);
+  if (action->code) ble_send_key(action->code, pressed);
+  if (!pressed) applyModifiers(action->mods, false);
+}
+
+static void handleConsumer(const KeyAction* action, bool pressed) {
+  // Consumer keys are sent as a tap on press; the release is scheduled
+  if (pressed) ble_send_media_key(action->code);
+}
+
+static void bindEncoder() {
+  uint8_t layer = layers_resolve(encoderLayers);
+  if (layer == boundEncoderLayer) return;
+  boundEncoderLayer = layer;
+  const EncoderBinding* b = &encoderBindings[layer];
+  encoder_set_mode(b->mode, b->usageCw, b->usageCcw);
+}
+
+static void handleLayer(const KeyAction* action, bool pressed) {
+  if (layers_apply((LayerOp)(action->code >> 8), action->code & 0xFF, pressed)) bindEncoder();
+}
+
+static KeyActionHandler handlers[ACTION_TYPE_COUNT] = {
+  handleNone,      // ACTION_NONE
+  handleKeyboard,  // ACTION_KEYBOARD
+  handleConsumer,  // ACTION_CONSUMER
+  handleNone,      // ACTION_MACRO, until a macro engine registers
+  handleLayer,     // ACTION_LAYER
+  handleNone,      // ACTION_TRANSPARENT, only reached on the base layer
+  handleNone,      // ACTION_HOST, until the reconnect manager registers
+  handleNone,      // ACTION_TAP_HOLD, decided by Key_Resolve
+  handleNone,      // ACTION_TAP_DANCE, decided by Key_Resolve
+  handleNone,      // ACTION_RECORDER, until the macro recorder registers
+};
+
+void keymap_dispatch(const KeyAction* action, bool pressed) {
+  uint8_t type = action->type < ACTION_TYPE_COUNT ? action->type : ACTION_NONE;
+  handlers[type](action, pressed);
+}
+
+void keymap_set_handler(KeyActionType type, KeyActionHandler handler) {
+  if (type < ACTION_TYPE_COUNT) handlers[type] = handler ? handler : handleNone;
+}
+
+void keymap_init(const KeyAction* keymapKeys, const EncoderBinding* encoder,
+                 uint8_t layers, uint8_t rows, uint8_t cols) {
+  keys = keymapKeys;
+  encoderBindings = encoder;
+  rowCount = rows;
+  colCount = cols;
+  layers_reset();
+
+  // A new keymap starts with nothing held; the caller releases the host side
+  memset(heldLayer, 0, sizeof(heldLayer));
+  memset(modifierRefs, 0, sizeof(modifierRefs));
+
+  // Walk the whole keymap once here, so resolving a key never has to
+  uint16_t positions = rows * cols;
+  encoderLayers = 1;
+  for (uint16_t pos = 0; pos < positions; pos++) definedLayers[pos] = 1;
+  for (uint8_t layer = 1; layer < layers; layer++) {
+    for (uint16_t pos = 0; pos < positions; pos++) {
+      if (keys[layer * positions + pos].type != ACTION_TRANSPARENT) definedLayers[pos] |= 1 << layer;
+    }
+    if (encoder[layer].mode != ENCODER_MODE_TRANSPARENT) encoderLayers |= 1 << layer;
+  }
+
+  boundEncoderLayer = 0xFF;
+  bindEncoder();
+}
+
+void keymap_run(const KeyAction* action, bool pressed) {
+  keymap_dispatch(action, pressed);
+
+  // A one-shot layer covers exactly one key press that is not itself a layer key
+  if (pressed && action->type != ACTION_LAYER && layers_consume_oneshot()) bindEncoder();
+}
+
+const KeyAction* keymap_lookup(uint8_t row, uint8_t col) {
+  if (row >= rowCount || col >= colCount) return &ACTION_NO_KEY;
+  uint16_t pos = row * colCount + col;
+  return &keys[layers_resolve(definedLayers[pos]) * rowCount * colCount + pos];
+}
+
+const KeyAction* keymap_key_event(uint8_t row, uint8_t col, bool pressed) {
+  if (row >= rowCount || col >= colCount) return &ACTION_NO_KEY;
+  uint16_t pos = row * colCount + col;
+
+  if (pressed) {
+    heldLayer[pos] = layers_resolve(definedLayers[pos]);
+  }
+  const KeyAction* action = &keys[heldLayer[pos] * rowCount * colCount + pos];
+  keymap_run(action, pressed);
+  return action;
+}
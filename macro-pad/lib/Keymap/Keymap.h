@@ -0,0 +1,136 @@
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+#include <stdint.h>
+#include "HID_Usages.h"
+#include "Layers.h"
+#include "Rotary_Encoder.h"
+
+#define KEYMAP_MAX_KEYS 128  // rows * cols, matches the scanner's 8x16 limit
+
+// --- Key Actions ---
+// Every matrix position holds a tagged action. Actions are built at compile
+// time, so the keymap is constant data and a press is one table lookup plus
+// one indexed handler call.
+enum KeyActionType : uint8_t {
+  ACTION_NONE,
+  ACTION_KEYBOARD,  // code = keyboard usage, mods = modifier bits held with it
+  ACTION_CONSUMER,  // code = consumer usage
+  ACTION_MACRO,     // code = macro id
+  ACTION_LAYER,     // code = LayerOp (high byte) and layer (low byte)
+  ACTION_TRANSPARENT,  // use the next active layer below
+  ACTION_HOST,      // code = bonded host slot, or 0xFF for the next one
+  ACTION_TAP_HOLD,  // code = hold layer (high byte, 0xFF for none) and tap usage, mods = held modifiers
+  ACTION_TAP_DANCE, // code = tap-dance id
+  ACTION_RECORDER,  // code = RecorderOp (high byte) and slot (low byte)
+  ACTION_TYPE_COUNT
+};
+
+struct KeyAction {
+  uint8_t type;   // KeyActionType
+  uint8_t mods;   // HID_MOD_* bits
+  uint16_t code;
+};
+
+typedef void (*KeyActionHandler)(const KeyAction* action, bool pressed);
+
+constexpr KeyAction ACTION_NO_KEY = {ACTION_NONE, 0, 0};
+constexpr KeyAction ACTION_TRANS = {ACTION_TRANSPARENT, 0, 0};
+
+// A keyboard usage, optionally with modifiers. Modifier usages (0xE0-0xE7)
+// are folded into mods so they share the modifier bookkeeping.
+constexpr KeyAction action_key(uint8_t usage, uint8_t mods = 0) {
+  return usage >= HID_KEY_LEFT_CTRL && usage <= HID_KEY_RIGHT_GUI
+      ? KeyAction{ACTION_KEYBOARD, (uint8_t)(mods | (1 << (usage - HID_KEY_LEFT_CTRL))), 0}
+      : KeyAction{ACTION_KEYBOARD, mods, usage};
+}
+
+// A printable character on a US layout, with Shift added where needed
+constexpr KeyAction action_char(char c) {
+  return hid_ascii_usage(c)
+      ? action_key(hid_ascii_usage(c), hid_ascii_shift(c) ? HID_MOD_LEFT_SHIFT : 0)
+      : ACTION_NO_KEY;
+}
+
+constexpr KeyAction action_consumer(uint16_t usage) {
+  return KeyAction{ACTION_CONSUMER, 0, usage};
+}
+
+constexpr KeyAction action_macro(uint16_t id) {
+  return KeyAction{ACTION_MACRO, 0, id};
+}
+
+constexpr KeyAction action_layer(LayerOp op, uint8_t layer) {
+  return KeyAction{ACTION_LAYER, 0, (uint16_t)(op << 8 | layer)};
+}
+
+// Switch to a bonded host (see Reconnect.h); 0xFF cycles through them
+constexpr KeyAction action_host(uint8_t slot) {
+  return KeyAction{ACTION_HOST, 0, slot};
+}
+
+// Dual-role keys (see Key_Resolve.h): tap for a keyboard usage, hold for
+// a momentary layer, modifiers, or both
+constexpr KeyAction action_tap_hold(uint8_t tapUsage, uint8_t holdMods, uint8_t holdLayer = 0xFF) {
+  return KeyAction{ACTION_TAP_HOLD, holdMods, (uint16_t)(holdLayer << 8 | tapUsage)};
+}
+
+constexpr KeyAction action_layer_tap(uint8_t layer, uint8_t tapUsage) {
+  return action_tap_hold(tapUsage, 0, layer);
+}
+
+constexpr KeyAction action_mod_tap(uint8_t mods, uint8_t tapUsage) {
+  return action_tap_hold(tapUsage, mods);
+}
+
+constexpr KeyAction action_tap_dance(uint16_t id) {
+  return KeyAction{ACTION_TAP_DANCE, 0, id};
+}
+
+constexpr EncoderBinding ENCODER_TRANS = {ENCODER_MODE_TRANSPARENT, 0, 0};
+
+// --- Keymap ---
+// Dimensions are part of the type, so a keymap that does not match the
+// matrix fails to compile instead of reading past a row. Layers above 0
+// usually hold ACTION_TRANS wherever they do not override the base layer.
+template <uint8_t Layers, uint8_t Rows, uint8_t Cols>
+struct Keymap {
+  static_assert(Layers >= 1 && Layers <= KEYMAP_MAX_LAYERS, "Too many layers");
+  static_assert(Rows * Cols <= KEYMAP_MAX_KEYS, "Matrix too large for the keymap");
+
+  KeyAction keys[Layers][Rows][Cols];
+  EncoderBinding encoder[Layers];
+};
+
+// Precompute the per-position layer masks and bind the base layer's encoder
+void keymap_init(const KeyAction* keys, const EncoderBinding* encoder,
+                 uint8_t layers, uint8_t rows, uint8_t cols);
+
+template <uint8_t Layers, uint8_t Rows, uint8_t Cols>
+void keymap_begin(const Keymap<Layers, Rows, Cols>& keymap) {
+  keymap_init(&keymap.keys[0][0][0], keymap.encoder, Layers, Rows, Cols);
+}
+
+// Resolve and run the action for a matrix edge. A press resolves against
+// the active layers and is remembered, so the release runs the same action
+// even if the layers changed while the key was held. Returns the action.
+const KeyAction* keymap_key_event(uint8_t row, uint8_t col, bool pressed);
+
+// The action a press at this position would resolve to now, without
+// running or remembering it
+const KeyAction* keymap_lookup(uint8_t row, uint8_t col);
+
+// Run an action's handler for a press or release
+void keymap_dispatch(const KeyAction* action, bool pressed);
+
+// Run an action the way a key press or release does: as keymap_dispatch(),
+// and a press also uses up an armed one-shot layer
+void keymap_run(const KeyAction* action, bool pressed);
+
+// Replace the handler for one action type (the macro engine and the
+// reconnect manager register here). Keyboard, consumer and layer actions
+// have built-in handlers; tap-hold and tap-dance keys are decided before
+// they reach the keymap (see Key_Resolve.h).
+void keymap_set_handler(KeyActionType type, KeyActionHandler handler);
+
+#endif // KEYMAP_H
@@ -0,0 +1,55 @@
+#include "Layers.h"
+#include <string.h>
+
+static uint8_t momentaryRefs[KEYMAP_MAX_LAYERS];  // held momentary keys per layer
+static uint16_t momentaryMask;
+static uint16_t toggledMask;
+static uint16_t oneshotMask;
+static uint16_t activeMask = 1;
+
+static bool updateActive() {
+  uint16_t mask = 1 | momentaryMask | toggledMask | oneshotMask;
+  bool changed = mask != activeMask;
+  activeMask = mask;
+  return changed;
+}
+
+void layers_reset() {
+  memset(momentaryRefs, 0, sizeof(momentaryRefs));
+  momentaryMask = toggledMask = oneshotMask = 0;
+  activeMask = 1;
+}
+
+bool layers_apply(LayerOp op, uint8_t layer, bool pressed) {
+  if (layer == 0 || layer >= KEYMAP_MAX_LAYERS) return false;
+  uint16_t bit = 1 << layer;
+
+  switch (op) {
+    case LAYER_MOMENTARY:
+      // Two keys can hold the same layer; it drops when both are up
+      if (pressed) {
+        momentaryRefs[layer]++;
+      } else if (momentaryRefs[layer]) {
+        momentaryRefs[layer]--;
+      }
+      momentaryMask = momentaryRefs[layer] ? momentaryMask | bit : momentaryMask & ~bit;
+      break;
+    case LAYER_TOGGLE:
+      if (pressed) toggledMask ^= bit;
+      break;
+    case LAYER_ONESHOT:
+      if (pressed) oneshotMask = oneshotMask == bit ? 0 : bit;
+      break;
+  }
+  return updateActive();
+}
+
+bool layers_consume_oneshot() {
+  if (!oneshotMask) return false;
+  oneshotMask = 0;
+  return updateActive();
+}
+
+uint16_t layers_active() {
+  return activeMask;
+}
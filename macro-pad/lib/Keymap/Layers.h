@@ -0,0 +1,37 @@
+#ifndef LAYERS_H
+#define LAYERS_H
+
+#include <stdint.h>
+
+// --- Layer Configuration ---
+#define KEYMAP_MAX_LAYERS 16  // One bit per layer in a uint16_t mask
+
+// Operations carried by ACTION_LAYER keys (see action_layer() in Keymap.h)
+enum LayerOp : uint8_t {
+  LAYER_MOMENTARY,  // Active while the key is held
+  LAYER_TOGGLE,     // Each press switches the layer on or off
+  LAYER_ONESHOT,    // Active for the next key press only; pressing again cancels
+};
+
+// Portable layer state (no Arduino dependency). Layer 0 is the base layer
+// and is always active. The active mask is recomputed only when the state
+// changes, so resolving a key is a mask and a count-leading-zeros.
+void layers_reset();
+
+// Apply a layer key press or release. Returns true when the active mask changed.
+bool layers_apply(LayerOp op, uint8_t layer, bool pressed);
+
+// Drop an armed one-shot layer after the key it applied to was resolved.
+// Returns true when the active mask changed.
+bool layers_consume_oneshot();
+
+uint16_t layers_active();
+
+// Highest active layer among `defined` (bit n set when layer n has an
+// action at this position). Layer 0 is the fallback.
+static inline uint8_t layers_resolve(uint16_t defined) {
+  uint32_t mask = (layers_active() & defined) | 1;
+  return 31 - __builtin_clz(mask);
+}
+
+#endif // LAYERS_H
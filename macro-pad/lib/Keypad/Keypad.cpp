@@ -0,0 +1,232 @@
+#include "Keypad.h"
+#include "Debounce.h"
+#include "Input_Bus.h"
+#include "Latency.h"
+#include "Log.h"
+#include <string.h>
+
+// Scanner state. Samples are taken as one column bitmask per row and
+// handed to the Debounce module, which keeps the per-key state.
+static const uint8_t* rowPins;
+static const uint8_t* colPins;
+static uint8_t numRows;
+static uint8_t numCols;
+static const KeypadIo* io;
+
+// Column pins gathered out of an inverted input register one byte at a
+// time: colLut[b][v] holds the column bits for byte b of the register
+// having value v. Built once at init, so a row costs four lookups however
+// the columns are wired.
+static uint16_t colLut[KEYPAD_MAX_PIN / 8][256];
+
+// Keys whose sample disagrees with the debounced state, and when each
+// first started to, for the debounce latency histogram
+static uint16_t pendingMask[KEYPAD_MAX_ROWS];
+static uint32_t detectCycles[KEYPAD_MAX_ROWS][KEYPAD_MAX_COLS];
+
+// Debounced edges not yet on the input ring, and those of them the ring has
+// already refused once. Until all are out, the debounced state is held so
+// no newer edge can overtake them.
+static uint16_t unsentMask[KEYPAD_MAX_ROWS];
+static uint16_t refusedMask[KEYPAD_MAX_ROWS];
+static bool backlog;
+
+static KeypadStats stats;
+static uint32_t lastScanStart;
+static bool intervalValid;  // false for the first scan after init or a suspend
+
+// The scanner is the only producer on the keypad ring. Returns false when
+// the ring is full.
+static bool pushEvent(uint8_t r, uint8_t c, bool pressed, uint32_t now, uint32_t cycles) {
+  uint16_t bit = 1 << c;
+  InputEvent event;
+  event.type = INPUT_KEY;
+  event.source = INPUT_SOURCE_KEYPAD;
+  event.row = r;
+  event.col = c;
+  event.value = pressed;
+  event.timestamp = now;
+  event.detectCycles = detectCycles[r][c];
+  event.acceptCycles = cycles;
+  if (!input_push(&event, refusedMask[r] & bit)) {
+    refusedMask[r] |= bit;
+    return false;
+  }
+  refusedMask[r] &= ~bit;
+  latency_record(LATENCY_DEBOUNCE, detectCycles[r][c], cycles);
+  return true;
+}
+
+static void buildColumnLut() {
+  memset(colLut, 0, sizeof(colLut));
+  for (uint8_t c = 0; c < numCols; c++) {
+    uint8_t pin = colPins[c];
+    if (pin >= KEYPAD_MAX_PIN) continue;  // Not in the register; never reads closed
+    uint8_t bit = 1 << (pin & 7);
+    for (uint16_t v = 0; v < 256; v++) {
+      if (v & bit) colLut[pin >> 3][v] |= (uint16_t)1 << c;
+    }
+  }
+}
+
+static inline uint16_t gatherColumns(uint32_t closed) {
+  return colLut[0][closed & 0xFF] | colLut[1][(closed >> 8) & 0xFF] |
+         colLut[2][(closed >> 16) & 0xFF] | colLut[3][closed >> 24];
+}
+
+#if KEYPAD_GHOST_MASKING
+// Two rows sharing two or more closed columns form a rectangle, and any
+// corner of it may be a ghost. Those keys keep their debounced state until
+// the rectangle breaks up. Returns true when something was masked.
+static bool maskGhosts(uint16_t* samples) {
+  uint16_t mask[KEYPAD_MAX_ROWS] = {};
+  bool found = false;
+  for (uint8_t r1 = 0; r1 < numRows; r1++) {
+    uint16_t s = samples[r1];
+    if (!(s & (s - 1))) continue;  // Fewer than two keys in this row
+    for (uint8_t r2 = r1 + 1; r2 < numRows; r2++) {
+      uint16_t common = s & samples[r2];
+      if (common & (common - 1)) {
+        mask[r1] |= common;
+        mask[r2] |= common;
+        found = true;
+      }
+    }
+  }
+  if (!found) return false;
+  for (uint8_t r = 0; r < numRows; r++) {
+    samples[r] = (samples[r] & ~mask[r]) | (debounce_state(r) & mask[r]);
+  }
+  return true;
+}
+#endif
+
+void keypad_init(const uint8_t* rows, uint8_t nRows,
+                 const uint8_t* cols, uint8_t nCols,
+                 const KeypadIo* gpio, uint16_t scanHz, uint8_t debounceMs) {
+  rowPins = rows;
+  colPins = cols;
+  numRows = nRows > KEYPAD_MAX_ROWS ? KEYPAD_MAX_ROWS : nRows;
+  numCols = nCols > KEYPAD_MAX_COLS ? KEYPAD_MAX_COLS : nCols;
+  io = gpio;
+
+  if (scanHz < KEYPAD_SCAN_HZ_MIN) scanHz = KEYPAD_SCAN_HZ_MIN;
+  if (scanHz > KEYPAD_SCAN_HZ_MAX) scanHz = KEYPAD_SCAN_HZ_MAX;
+  if (!debounce_time_fits(debounceMs, scanHz)) {
+    LOG(LOG_EVT_DEBOUNCE_CLAMPED, debounceMs, scanHz, DEBOUNCE_MAX_SCANS);
+  }
+  debounce_init(numRows, debounce_scans_for(debounceMs, scanHz));
+
+  memset(pendingMask, 0, sizeof(pendingMask));
+  memset(unsentMask, 0, sizeof(unsentMask));
+  memset(refusedMask, 0, sizeof(refusedMask));
+  backlog = false;
+  buildColumnLut();
+
+  for (uint8_t r = 0; r < numRows; r++) {
+    io->writeRow(rowPins[r], false);  // Start with rows inactive
+  }
+  keypad_reset_stats();
+}
+
+void keypad_scan() {
+  uint32_t start = io->micros();
+  uint32_t cycles = latency_now();
+
+  if (intervalValid) {
+    uint32_t interval = start - lastScanStart;
+    if (interval < stats.minIntervalUs) stats.minIntervalUs = interval;
+    if (interval > stats.maxIntervalUs) stats.maxIntervalUs = interval;
+  }
+  lastScanStart = start;
+  intervalValid = true;
+
+  // Sample the whole matrix first, so ghosts can be judged across rows
+  uint16_t samples[KEYPAD_MAX_ROWS];
+  for (uint8_t r = 0; r < numRows; r++) {
+    io->writeRow(rowPins[r], true);  // Activate the current row
+    io->settle(KEYPAD_SETTLE_US);
+    samples[r] = gatherColumns(~io->readInputs());  // Columns are active low
+    io->writeRow(rowPins[r], false);  // Deactivate the row
+  }
+
+#if KEYPAD_GHOST_MASKING
+  if (maskGhosts(samples)) stats.ghostScans++;
+#endif
+
+  // Edges left over from a full ring go first, all of them in the order they
+  // were found. The debounced state has not moved since, so it still is the
+  // edge to send.
+  if (backlog) {
+    backlog = false;
+    for (uint8_t r = 0; r < numRows && !backlog; r++) {
+      while (unsentMask[r]) {
+        uint8_t c = __builtin_ctz(unsentMask[r]);
+        if (!pushEvent(r, c, (debounce_state(r) >> c) & 1, start, cycles)) {
+          backlog = true;
+          break;
+        }
+        unsentMask[r] &= unsentMask[r] - 1;
+      }
+    }
+  }
+
+  for (uint8_t r = 0; r < numRows; r++) {
+    uint16_t sample = samples[r];
+    uint16_t pending = sample ^ debounce_state(r);
+    uint16_t fresh = pending & ~pendingMask[r] & ~unsentMask[r];  // Keep the waiting edge's time
+    while (fresh) {
+      uint8_t c = __builtin_ctz(fresh);
+      fresh &= fresh - 1;
+      detectCycles[r][c] = cycles;
+    }
+    pendingMask[r] = pending & ~unsentMask[r];
+    if (backlog) continue;  // Debouncing waits until the older edges are out
+
+    uint16_t changed = debounce_update(r, sample);
+    pendingMask[r] &= ~changed;
+    while (changed) {
+      uint8_t c = __builtin_ctz(changed);
+      changed &= changed - 1;
+      if (!pushEvent(r, c, (debounce_state(r) >> c) & 1, start, cycles)) {
+        // This edge and the rest of the scan's wait, in order
+        unsentMask[r] |= (1 << c) | changed;
+        backlog = true;
+        break;
+      }
+    }
+  }
+
+  uint32_t duration = io->micros() - start;
+  if (duration > stats.maxScanUs) stats.maxScanUs = duration;
+  stats.scans++;
+}
+
+bool keypad_is_pressed(uint8_t row, uint8_t col) {
+  if (row >= numRows || col >= numCols) return false;
+  return (debounce_state(row) >> col) & 1;
+}
+
+bool keypad_any_pressed() {
+  for (uint8_t r = 0; r < numRows; r++) {
+    if (debounce_state(r)) return true;
+  }
+  return false;
+}
+
+void keypad_hold_rows(bool active) {
+  for (uint8_t r = 0; r < numRows; r++) {
+    io->writeRow(rowPins[r], active);
+  }
+  intervalValid = false;
+}
+
+void keypad_get_stats(KeypadStats* out) {
+  *out = stats;
+}
+
+void keypad_reset_stats() {
+  memset(&stats, 0, sizeof(stats));
+  stats.minIntervalUs = UINT32_MAX;
+  intervalValid = false;
+}
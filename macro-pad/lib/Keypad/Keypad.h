@@ -0,0 +1,72 @@
+#ifndef KEYPAD_H
+#define KEYPAD_H
+
+#include <stdint.h>
+
+// --- Matrix Scanner Configuration ---
+#define KEYPAD_MAX_ROWS        8
+#define KEYPAD_MAX_COLS        16
+#define KEYPAD_SCAN_HZ_MIN     1000
+#define KEYPAD_SCAN_HZ_MAX     4000
+#define KEYPAD_SETTLE_US       3     // Row drive to column sample settle time
+#define KEYPAD_DEBOUNCE_MS     5     // Default stable time the Debounce module waits for (see Debounce.h)
+#define KEYPAD_MAX_PIN         32    // Columns are read from one 32-bit GPIO input register
+
+// Without a diode per switch, three closed keys on the corners of a
+// rectangle make the fourth read as closed too. Masking holds every key of
+// such a rectangle at its last state until it breaks up. Build with 0 for a
+// matrix with diodes, where every combination is real.
+#ifndef KEYPAD_GHOST_MASKING
+#define KEYPAD_GHOST_MASKING   1
+#endif
+
+// GPIO access used by the scanner. The ESP32 build writes and reads the GPIO
+// registers directly; host builds pass a mock. Each row costs one register
+// read, whatever the number of columns.
+struct KeypadIo {
+  void (*writeRow)(uint8_t pin, bool active);
+  uint32_t (*readInputs)();  // Every GPIO input level at once, bit n = GPIO n
+  uint32_t (*micros)();
+  void (*settle)(uint32_t us);
+};
+
+// Scan timing counters, used to check scan rate and jitter
+struct KeypadStats {
+  uint32_t scans;
+  uint32_t minIntervalUs;   // shortest gap between two scan starts
+  uint32_t maxIntervalUs;   // longest gap between two scan starts
+  uint32_t maxScanUs;       // longest single scan pass
+  uint32_t ghostScans;      // scans that masked a ghost rectangle
+};
+
+// Portable scanner core (no Arduino dependency). Debounced edges go to the
+// input bus as INPUT_KEY events from INPUT_SOURCE_KEYPAD (see Input_Bus.h),
+// timestamped with the scan that accepted them; detectCycles is when the
+// sample first differed, acceptCycles when debounce accepted it. Column
+// pins must be below KEYPAD_MAX_PIN.
+void keypad_init(const uint8_t* rowPins, uint8_t rows,
+                 const uint8_t* colPins, uint8_t cols,
+                 const KeypadIo* io, uint16_t scanHz,
+                 uint8_t debounceMs = KEYPAD_DEBOUNCE_MS);
+void keypad_scan();
+bool keypad_is_pressed(uint8_t row, uint8_t col);
+bool keypad_any_pressed();
+
+// Drive every row active so any key pulls its column low, for wake on a
+// column pin, or release them before scanning starts again
+void keypad_hold_rows(bool active);
+void keypad_get_stats(KeypadStats* stats);
+void keypad_reset_stats();
+
+// Hardware timer driven scanning (ESP32 only)
+void keypad_begin(const uint8_t* rowPins, uint8_t rows,
+                  const uint8_t* colPins, uint8_t cols,
+                  uint16_t scanHz = KEYPAD_SCAN_HZ_MIN,
+                  uint8_t debounceMs = KEYPAD_DEBOUNCE_MS);
+
+// Stop the scan timer with all rows held active, and start it again. The
+// debounced state is kept, so a key that wakes the pad is seen as a press.
+void keypad_suspend();
+void keypad_resume();
+
+#endif // KEYPAD_H
@@ -0,0 +1,94 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+#include "Keypad.h"
+
+// The hardware timer only wakes the scan task; the scan itself runs at a
+// high task priority so it is never held up by BLE or encoder work in loop().
+#define KEYPAD_TIMER_NUM       0
+#define KEYPAD_TASK_PRIORITY   (configMAX_PRIORITIES - 2)
+#define KEYPAD_TASK_STACK      2048
+
+static hw_timer_t* scanTimer = NULL;
+static TaskHandle_t scanTask = NULL;
+
+// Straight to the GPIO registers: digitalWrite/digitalRead cost a function
+// call and a pin lookup each, and a row would need one read per column.
+// Every C3 GPIO is in the first bank.
+static void arduinoWriteRow(uint8_t pin, bool active) {
+  // Rows are active low
+  REG_WRITE(active ? GPIO_OUT_W1TC_REG : GPIO_OUT_W1TS_REG, 1UL << pin);
+}
+
+static uint32_t arduinoReadInputs() {
+  return REG_READ(GPIO_IN_REG);
+}
+
+static uint32_t arduinoMicros() {
+  return micros();
+}
+
+static void arduinoSettle(uint32_t us) {
+  delayMicroseconds(us);
+}
+
+static const KeypadIo arduinoIo = {
+  arduinoWriteRow,
+  arduinoReadInputs,
+  arduinoMicros,
+  arduinoSettle,
+};
+
+static void IRAM_ATTR onScanTimer() {
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(scanTask, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+static void scanTaskMain(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    keypad_scan();
+  }
+}
+
+void keypad_begin(const uint8_t* rowPins, uint8_t rows,
+                  const uint8_t* colPins, uint8_t cols,
+                  uint16_t scanHz, uint8_t debounceMs) {
+  for (uint8_t r = 0; r < rows; r++) {
+    pinMode(rowPins[r], OUTPUT);
+  }
+  for (uint8_t c = 0; c < cols; c++) {
+    pinMode(colPins[c], INPUT_PULLUP);  // Use internal pull-up resistors
+  }
+
+  keypad_init(rowPins, rows, colPins, cols, &arduinoIo, scanHz, debounceMs);
+  if (scanHz < KEYPAD_SCAN_HZ_MIN) scanHz = KEYPAD_SCAN_HZ_MIN;
+  if (scanHz > KEYPAD_SCAN_HZ_MAX) scanHz = KEYPAD_SCAN_HZ_MAX;
+
+  xTaskCreate(scanTaskMain, "keypad", KEYPAD_TASK_STACK, NULL,
+              KEYPAD_TASK_PRIORITY, &scanTask);
+
+  // 80 MHz APB clock / 80 = 1 MHz timer tick
+  scanTimer = timerBegin(KEYPAD_TIMER_NUM, 80, true);
+  timerAttachInterrupt(scanTimer, &onScanTimer, true);
+  timerAlarmWrite(scanTimer, 1000000UL / scanHz, true);
+  timerAlarmEnable(scanTimer);
+}
+
+// Called from the loop task; on the single-core C3 the higher-priority scan
+// task is never part way through a scan when this runs
+void keypad_suspend() {
+  timerAlarmDisable(scanTimer);
+  keypad_hold_rows(true);
+}
+
+void keypad_resume() {
+  keypad_hold_rows(false);
+  timerWrite(scanTimer, 0);
+  timerAlarmEnable(scanTimer);
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,142 @@
+#include "Latency.h"
+#include <atomic>
+#include <stdio.h>
+
+static uint32_t (*cycleSource)();
+static uint32_t cyclesPerMicro = 1;
+
+// Stages are recorded from the scan timer, the loop task and the transport
+// task, and read or cleared from the loop task and the BLE task, so every
+// field is updated atomically. A snapshot taken while samples land may be
+// off by those samples, never torn.
+struct SharedHistogram {
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> minUs;
+  std::atomic<uint32_t> maxUs;
+  std::atomic<uint32_t> buckets[LATENCY_BUCKETS];
+};
+static SharedHistogram histograms[LATENCY_STAGE_COUNT];
+
+static bool inputPending;
+static uint32_t pendingDetect;
+static uint32_t pendingAccept;
+
+void latency_init(uint32_t (*cycleCounter)(), uint32_t cyclesPerUs) {
+  cycleSource = cycleCounter;
+  cyclesPerMicro = cyclesPerUs ? cyclesPerUs : 1;
+  inputPending = false;
+  latency_reset();
+}
+
+uint32_t latency_now() {
+  return cycleSource ? cycleSource() : 0;
+}
+
+static inline uint8_t bucketFor(uint32_t us) {
+  uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+void latency_record(LatencyStage stage, uint32_t startCycles, uint32_t endCycles) {
+  if (!cycleSource || stage >= LATENCY_STAGE_COUNT) return;
+
+  uint32_t us = (endCycles - startCycles) / cyclesPerMicro;
+  SharedHistogram& h = histograms[stage];
+  uint32_t seen = h.minUs.load(std::memory_order_relaxed);
+  while (us < seen && !h.minUs.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {}
+  seen = h.maxUs.load(std::memory_order_relaxed);
+  while (us > seen && !h.maxUs.compare_exchange_weak(seen, us, std::memory_order_relaxed)) {}
+  h.buckets[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+  h.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void latency_get(LatencyStage stage, LatencyHistogram* out) {
+  const SharedHistogram& h = histograms[stage];
+  out->count = h.count.load(std::memory_order_relaxed);
+  out->minUs = h.minUs.load(std::memory_order_relaxed);
+  out->maxUs = h.maxUs.load(std::memory_order_relaxed);
+  for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+    out->buckets[b] = h.buckets[b].load(std::memory_order_relaxed);
+  }
+}
+
+void latency_reset() {
+  for (SharedHistogram& h : histograms) {
+    h.count.store(0, std::memory_order_relaxed);
+    h.minUs.store(UINT32_MAX, std::memory_order_relaxed);
+    h.maxUs.store(0, std::memory_order_relaxed);
+    for (std::atomic<uint32_t>& bucket : h.buckets) bucket.store(0, std::memory_order_relaxed);
+  }
+}
+
+const char* latency_stage_name(LatencyStage stage) {
+  switch (stage) {
+    case LATENCY_DEBOUNCE: return "debounce";
+    case LATENCY_BUILD:    return "build";
+    case LATENCY_NOTIFY:   return "notify";
+    case LATENCY_TOTAL:    return "total";
+    default: return "?";
+  }
+}
+
+void latency_mark_input(uint32_t detectCycles, uint32_t acceptCycles) {
+  if (inputPending) return;  // Keep the oldest input of the batch
+  inputPending = true;
+  pendingDetect = detectCycles;
+  pendingAccept = acceptCycles;
+}
+
+bool latency_take_input(uint32_t* detectCycles, uint32_t* acceptCycles) {
+  if (!inputPending) return false;
+  inputPending = false;
+  *detectCycles = pendingDetect;
+  *acceptCycles = pendingAccept;
+  return true;
+}
+
+size_t latency_format(char* buffer, size_t size) {
+  size_t used = 0;
+  for (uint8_t s = 0; s < LATENCY_STAGE_COUNT && used < size; s++) {
+    LatencyHistogram h;
+    latency_get((LatencyStage)s, &h);
+    int n = snprintf(buffer + used, size - used, "%-8s n=%lu min=%lu max=%lu us |",
+                     latency_stage_name((LatencyStage)s), (unsigned long)h.count,
+                     (unsigned long)(h.count ? h.minUs : 0), (unsigned long)h.maxUs);
+    if (n < 0) break;
+    used += n;
+    for (uint8_t b = 0; b < LATENCY_BUCKETS && used < size; b++) {
+      n = snprintf(buffer + used, size - used, " %lu", (unsigned long)h.buckets[b]);
+      if (n < 0) break;
+      used += n;
+    }
+    if (used < size) {
+      n = snprintf(buffer + used, size - used, "\n");
+      if (n > 0) used += n;
+    }
+  }
+  return used < size ? used : size - 1;
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t v) {
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+  return p + 4;
+}
+
+size_t latency_serialize(uint8_t* buffer, size_t size) {
+  if (size < LATENCY_SERIALIZED_LEN) return 0;
+  uint8_t* p = buffer;
+  for (uint8_t s = 0; s < LATENCY_STAGE_COUNT; s++) {
+    LatencyHistogram h;
+    latency_get((LatencyStage)s, &h);
+    p = putU32(p, h.count);
+    p = putU32(p, h.count ? h.minUs : 0);
+    p = putU32(p, h.maxUs);
+    for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+      p = putU32(p, h.buckets[b]);
+    }
+  }
+  return p - buffer;
+}
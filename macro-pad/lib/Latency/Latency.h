@@ -0,0 +1,55 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// --- Input Latency Histograms ---
+// Stages are measured from CPU cycle counter stamps taken along the pipeline:
+// scan detection -> debounce accept -> report build -> notify.
+enum LatencyStage : uint8_t {
+  LATENCY_DEBOUNCE,  // first differing sample to debounce accept
+  LATENCY_BUILD,     // debounce accept to report enqueued
+  LATENCY_NOTIFY,    // report enqueued to notify() returned
+  LATENCY_TOTAL,     // first differing sample to notify() returned
+  LATENCY_STAGE_COUNT
+};
+
+// Bucket b counts samples of [2^(b-1), 2^b) microseconds; bucket 0 is < 1 us
+// and the last bucket also takes everything above its range.
+#define LATENCY_BUCKETS 20
+
+struct LatencyHistogram {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t buckets[LATENCY_BUCKETS];
+};
+
+// Portable core (no Arduino dependency). Recording, reading and resetting
+// are safe from any task; each field is atomic.
+void latency_init(uint32_t (*cycleCounter)(), uint32_t cyclesPerUs);
+uint32_t latency_now();
+void latency_record(LatencyStage stage, uint32_t startCycles, uint32_t endCycles);
+void latency_get(LatencyStage stage, LatencyHistogram* histogram);
+void latency_reset();
+const char* latency_stage_name(LatencyStage stage);
+
+// A trace follows one input from the scanner to the report it ends up in.
+// latency_mark_input() is called as events are handled, the next report
+// enqueued claims the oldest pending trace with latency_take_input().
+void latency_mark_input(uint32_t detectCycles, uint32_t acceptCycles);
+bool latency_take_input(uint32_t* detectCycles, uint32_t* acceptCycles);
+
+// Text dump for the serial command, one line per stage
+size_t latency_format(char* buffer, size_t size);
+
+// Binary dump for the diagnostic characteristic: per stage, count, min and
+// max followed by the buckets, all little-endian uint32
+#define LATENCY_SERIALIZED_LEN (LATENCY_STAGE_COUNT * (3 + LATENCY_BUCKETS) * 4)
+size_t latency_serialize(uint8_t* buffer, size_t size);
+
+// Register the ESP32 cycle counter (ESP32 only)
+void latency_begin();
+
+#endif // LATENCY_H
@@ -0,0 +1,14 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include "Latency.h"
+
+static uint32_t cpuCycles() {
+  return ESP.getCycleCount();
+}
+
+void latency_begin() {
+  latency_init(cpuCycles, ESP.getCpuFreqMHz());
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,86 @@
+#include "Log.h"
+#include <atomic>
+
+// Bounded multi-producer ring: each cell carries a sequence number that
+// tells producers when it is free and the consumer when it is filled.
+struct LogCell {
+  std::atomic<uint32_t> sequence;
+  LogRecord record;
+};
+
+static LogCell ring[LOG_RING_LEN];
+static std::atomic<uint32_t> writePos(0);
+static uint32_t readPos;
+static std::atomic<uint32_t> dropped(0);
+static uint32_t (*clockSource)();
+
+#define LOG_EVENT_FORMAT(id, level, fmt) fmt,
+static const char* const eventFormats[] = { LOG_EVENTS(LOG_EVENT_FORMAT) };
+#undef LOG_EVENT_FORMAT
+
+void log_init(uint32_t (*clockUs)()) {
+  clockSource = clockUs;
+  for (uint32_t i = 0; i < LOG_RING_LEN; i++) {
+    ring[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  writePos.store(0);
+  readPos = 0;
+  dropped.store(0);
+}
+
+void log_write(uint16_t event, int32_t a0, int32_t a1, int32_t a2) {
+  if (!clockSource) return;
+
+  uint32_t pos = writePos.load(std::memory_order_relaxed);
+  LogCell* cell;
+  for (;;) {
+    cell = &ring[pos & (LOG_RING_LEN - 1)];
+    int32_t diff = (int32_t)(cell->sequence.load(std::memory_order_acquire) - pos);
+    if (diff == 0) {
+      if (writePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+    } else if (diff < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed);  // Ring full: never block the caller
+      return;
+    } else {
+      pos = writePos.load(std::memory_order_relaxed);
+    }
+  }
+
+  LogRecord& r = cell->record;
+  r.magic = LOG_MAGIC;
+  r.level = event < LOG_EVT_COUNT ? logEventLevel[event] : LOG_LEVEL_NONE;
+  r.event = event;
+  r.timestamp = clockSource();
+  r.args[0] = a0;
+  r.args[1] = a1;
+  r.args[2] = a2;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool log_read(LogRecord* record) {
+  LogCell* cell = &ring[readPos & (LOG_RING_LEN - 1)];
+  if (cell->sequence.load(std::memory_order_acquire) != readPos + 1) return false;
+
+  *record = cell->record;
+  cell->sequence.store(readPos + LOG_RING_LEN, std::memory_order_release);
+  readPos++;
+  return true;
+}
+
+uint32_t log_dropped() {
+  return dropped.exchange(0);
+}
+
+const char* log_event_format(uint16_t event) {
+  return event < LOG_EVT_COUNT ? eventFormats[event] : "Unknown event %d %d %d";
+}
+
+const char* log_level_name(uint8_t level) {
+  switch (level) {
+    case LOG_LEVEL_ERROR: return "E";
+    case LOG_LEVEL_WARN:  return "W";
+    case LOG_LEVEL_INFO:  return "I";
+    case LOG_LEVEL_DEBUG: return "D";
+    default: return "-";
+  }
+}
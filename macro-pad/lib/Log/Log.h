@@ -0,0 +1,64 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+
+// --- Log Levels ---
+// Set with build_flags = -DLOG_LEVEL=LOG_LEVEL_DEBUG. Calls for events above
+// the build level are constant-folded away, arguments included.
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_LEN   64    // Records, must be a power of two
+#define LOG_MAX_ARGS   3
+#define LOG_MAGIC      0xA5  // First byte of every binary record
+
+#include "Log_Events.h"
+
+#define LOG_EVENT_ID(id, level, fmt) id,
+enum LogEvent : uint16_t {
+  LOG_EVENTS(LOG_EVENT_ID)
+  LOG_EVT_COUNT
+};
+#undef LOG_EVENT_ID
+
+#define LOG_EVENT_LEVEL(id, level, fmt) level,
+static constexpr uint8_t logEventLevel[] = { LOG_EVENTS(LOG_EVENT_LEVEL) };
+#undef LOG_EVENT_LEVEL
+
+// Fixed-size binary record, written little endian by the binary drain
+struct LogRecord {
+  uint8_t magic;
+  uint8_t level;
+  uint16_t event;
+  uint32_t timestamp;  // microseconds
+  int32_t args[LOG_MAX_ARGS];
+};
+
+#define LOG(event, ...) \
+  do { \
+    if (logEventLevel[event] <= LOG_LEVEL) log_write(event, ##__VA_ARGS__); \
+  } while (0)
+
+// Portable ring buffer core (no Arduino dependency). log_write() is lock
+// free and safe from any task or ISR; log_read() has a single consumer.
+void log_init(uint32_t (*clockUs)());
+void log_write(uint16_t event, int32_t a0 = 0, int32_t a1 = 0, int32_t a2 = 0);
+bool log_read(LogRecord* record);
+uint32_t log_dropped();
+
+const char* log_event_format(uint16_t event);
+const char* log_level_name(uint8_t level);
+
+// Start the low-priority drain task that formats records to Serial (ESP32 only).
+// With -DLOG_BINARY_OUTPUT raw records are written instead, for tools/log_decode.py.
+void log_begin();
+
+#endif // LOG_H
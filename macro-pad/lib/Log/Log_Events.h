@@ -0,0 +1,39 @@
+// Log event table. Each entry is X(id, level, format); records store only the
+// id and up to LOG_MAX_ARGS integer arguments, the text is applied when the
+// drain task (or tools/log_decode.py) formats them. Append new events at the
+// end so ids in old dumps keep their meaning.
+#define LOG_EVENTS(X) \
+  X(LOG_EVT_LOG_DROPPED,     LOG_LEVEL_WARN,  "Log overflow: %u records dropped") \
+  X(LOG_EVT_KEY_PRESSED,     LOG_LEVEL_DEBUG, "Key pressed: row %d col %d key 0x%02x") \
+  X(LOG_EVT_KEY_RELEASED,    LOG_LEVEL_DEBUG, "Key released: row %d col %d key 0x%02x") \
+  X(LOG_EVT_MEDIA_KEY,       LOG_LEVEL_DEBUG, "Media key sent: 0x%x x%d") \
+  X(LOG_EVT_ENCODER_STEPS,   LOG_LEVEL_DEBUG, "Encoder: mode %d steps %d") \
+  X(LOG_EVT_NOT_CONNECTED,   LOG_LEVEL_WARN,  "Not connected to any device") \
+  X(LOG_EVT_CONNECTED,       LOG_LEVEL_INFO,  "Device connected") \
+  X(LOG_EVT_DISCONNECTED,    LOG_LEVEL_INFO,  "Device disconnected") \
+  X(LOG_EVT_ADV_RESTARTED,   LOG_LEVEL_INFO,  "Advertising restarted") \
+  X(LOG_EVT_MACRO_STARTED,   LOG_LEVEL_DEBUG, "Macro %d started") \
+  X(LOG_EVT_MACRO_DROPPED,   LOG_LEVEL_WARN,  "Macro %d dropped: %d already waiting") \
+  X(LOG_EVT_MACRO_BAD_OP,    LOG_LEVEL_ERROR, "Macro %d: bad opcode 0x%02x at offset %d") \
+  X(LOG_EVT_CONFIG_LOADED,   LOG_LEVEL_INFO,  "Config: slot %d sequence %u (-1: compiled-in defaults)") \
+  X(LOG_EVT_CONFIG_XFER_FAILED, LOG_LEVEL_WARN, "Config transfer failed: error %d after %u bytes") \
+  X(LOG_EVT_CONFIG_STORED,   LOG_LEVEL_INFO,  "Config stored: slot %d sequence %u, %u bytes") \
+  X(LOG_EVT_CONFIG_APPLIED,  LOG_LEVEL_INFO,  "Config applied in %u us") \
+  X(LOG_EVT_POWER_SLEEP,     LOG_LEVEL_INFO,  "Power: sleeping after %u s idle") \
+  X(LOG_EVT_POWER_WAKE,      LOG_LEVEL_INFO,  "Power: woken by input") \
+  X(LOG_EVT_POWER_NO_PM,     LOG_LEVEL_WARN,  "Power: automatic light sleep unavailable (error %d), idling only") \
+  X(LOG_EVT_CONN_PROFILE,    LOG_LEVEL_INFO,  "Connection profile %d requested: interval %u-%u us") \
+  X(LOG_EVT_CONN_UPDATED,    LOG_LEVEL_INFO,  "Connection parameters: interval %u us, latency %u, timeout %u ms") \
+  X(LOG_EVT_RECONNECT_ADV,   LOG_LEVEL_INFO,  "Advertising: mode %d for host slot %d") \
+  X(LOG_EVT_RECONNECTED,     LOG_LEVEL_INFO,  "Connected after %u ms (mode %d, host slot %d)") \
+  X(LOG_EVT_HOST_BONDED,     LOG_LEVEL_INFO,  "Host bonded into slot %d") \
+  X(LOG_EVT_HOST_SELECTED,   LOG_LEVEL_INFO,  "Host slot %d selected (bonded %d)") \
+  X(LOG_EVT_BOOT_PHASE,      LOG_LEVEL_INFO,  "Boot phase %d done at %u us") \
+  X(LOG_EVT_INPUT_REPLAYED,  LOG_LEVEL_INFO,  "Replayed %u buffered key edges, %u dropped") \
+  X(LOG_EVT_KEY_RESOLVED,    LOG_LEVEL_DEBUG, "Key 0x%02x resolved as %d (0 tap, 1 hold, 2 dance, 3 combo) after %u us") \
+  X(LOG_EVT_ENCODER_WHEEL,   LOG_LEVEL_DEBUG, "Encoder: mode %d wheel %d/16 detents (hi-res %d)") \
+  X(LOG_EVT_RECORDER_STARTED, LOG_LEVEL_INFO, "Recording into slot %d") \
+  X(LOG_EVT_RECORDER_SAVED,  LOG_LEVEL_INFO,  "Recording slot %d: %u events, %u bytes saved") \
+  X(LOG_EVT_RECORDER_FULL,   LOG_LEVEL_WARN,  "Recording slot %d full after %u events") \
+  X(LOG_EVT_RECORDER_PLAYING, LOG_LEVEL_DEBUG, "Playing slot %d: %u bytes, gaps up to %u ms") \
+  X(LOG_EVT_DEBOUNCE_CLAMPED, LOG_LEVEL_WARN, "Debounce %u ms at %u Hz cut to %u scans")
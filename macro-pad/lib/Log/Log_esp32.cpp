@@ -0,0 +1,39 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include "Log.h"
+
+// Formatting and Serial output happen only here, at the lowest priority
+#define LOG_TASK_PRIORITY   1
+#define LOG_TASK_STACK      3072
+#define LOG_DRAIN_PERIOD_MS 20
+
+static uint32_t logClock() {
+  return micros();
+}
+
+static void drainTaskMain(void*) {
+  LogRecord record;
+  for (;;) {
+    uint32_t lost = log_dropped();
+    if (lost) log_write(LOG_EVT_LOG_DROPPED, lost);
+
+    while (log_read(&record)) {
+#ifdef LOG_BINARY_OUTPUT
+      Serial.write((const uint8_t*)&record, sizeof(record));
+#else
+      Serial.printf("[%10lu] %s ", (unsigned long)record.timestamp, log_level_name(record.level));
+      Serial.printf(log_event_format(record.event), record.args[0], record.args[1], record.args[2]);
+      Serial.println();
+#endif
+    }
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+  }
+}
+
+void log_begin() {
+  log_init(logClock);
+  xTaskCreate(drainTaskMain, "log", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, NULL);
+}
+
+#endif // ARDUINO_ARCH_ESP32
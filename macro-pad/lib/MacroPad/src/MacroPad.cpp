@@ -0,0 +1,178 @@
+#include "MacroPad.h"
+#include "Log.h"
+#include <string.h>
+
+static const uint8_t* const* macroTable;
+static uint8_t macroCount;
+static MacroIo io;
+
+// Pending macro ids, started in order once the running one ends
+static uint16_t waiting[MACRO_QUEUE_LEN];
+static uint8_t waitHead;
+static uint8_t waitCount;
+
+// State of the running macro. A tap or typed character is split across two
+// steps (press, then release), so the release waits in pendingRelease.
+static uint16_t runningId;
+static const uint8_t* code;  // start of the running macro, null when idle
+static const uint8_t* pc;
+static const uint8_t* typeText;
+static uint8_t typeLeft;
+static KeyAction pendingRelease;
+static bool releasePending;
+static uint32_t wakeMs;
+static bool sleeping;
+
+// Usages held down by PRESS without a matching RELEASE yet; they are
+// released when the macro ends so a macro can never leave a key stuck
+static uint8_t heldByMacro[32];
+
+uint32_t macro_code_len(const uint8_t* bytes, uint32_t maxLen) {
+  uint32_t at = 0;
+  while (at < maxLen) {
+    uint32_t operands;
+    switch (bytes[at]) {
+      case MACRO_OP_END:
+        return at + 1;
+      case MACRO_OP_PRESS:
+      case MACRO_OP_RELEASE:
+      case MACRO_OP_TAP:
+        operands = 1;
+        break;
+      case MACRO_OP_TYPE:
+        operands = at + 1 < maxLen ? 1 + bytes[at + 1] : 1;
+        break;
+      case MACRO_OP_DELAY:
+      case MACRO_OP_CONSUMER:
+      case MACRO_OP_LAYER:
+        operands = 2;
+        break;
+      default:
+        return 0;
+    }
+    at += 1 + operands;
+  }
+  return 0;
+}
+
+void macro_init(const uint8_t* const* macros, uint8_t count, const MacroIo* output) {
+  macroTable = macros;
+  macroCount = count;
+  io = *output;
+  waitHead = waitCount = 0;
+  code = nullptr;
+  typeLeft = 0;
+  releasePending = false;
+  sleeping = false;
+  memset(heldByMacro, 0, sizeof(heldByMacro));
+}
+
+bool macro_start(uint16_t id) {
+  if (id >= macroCount) return false;
+  if (waitCount == MACRO_QUEUE_LEN) {
+    LOG(LOG_EVT_MACRO_DROPPED, id, waitCount);
+    return false;
+  }
+  waiting[(waitHead + waitCount) % MACRO_QUEUE_LEN] = id;
+  waitCount++;
+  return true;
+}
+
+bool macro_busy() {
+  return code != nullptr || waitCount > 0;
+}
+
+static void emit(const KeyAction& action, bool pressed) {
+  io.run(&action, pressed);
+  io.flush();
+}
+
+static void sleepFor(uint32_t nowMs, uint32_t ms) {
+  wakeMs = nowMs + ms;
+  sleeping = true;
+}
+
+static void finish() {
+  for (uint16_t usage = 0; usage < 256; usage++) {
+    if (heldByMacro[usage >> 3] & (1 << (usage & 7))) emit(action_key(usage), false);
+  }
+  memset(heldByMacro, 0, sizeof(heldByMacro));
+  code = nullptr;
+}
+
+// Execute one opcode. Returns false when the macro has ended.
+static bool decode(uint32_t nowMs) {
+  uint8_t op = *pc++;
+  switch (op) {
+    case MACRO_OP_END:
+      return false;
+    case MACRO_OP_PRESS:
+      heldByMacro[*pc >> 3] |= 1 << (*pc & 7);
+      emit(action_key(*pc++), true);
+      return true;
+    case MACRO_OP_RELEASE:
+      heldByMacro[*pc >> 3] &= ~(1 << (*pc & 7));
+      emit(action_key(*pc++), false);
+      return true;
+    case MACRO_OP_TAP:
+      pendingRelease = action_key(*pc++);
+      emit(pendingRelease, true);
+      releasePending = true;
+      return true;
+    case MACRO_OP_TYPE:
+      typeLeft = *pc++;
+      typeText = pc;
+      pc += typeLeft;
+      return true;
+    case MACRO_OP_DELAY:
+      sleepFor(nowMs, pc[0] | pc[1] << 8);
+      pc += 2;
+      return true;
+    case MACRO_OP_CONSUMER:
+      emit(action_consumer(pc[0] | pc[1] << 8), true);
+      pc += 2;
+      sleepFor(nowMs, MACRO_CONSUMER_GAP_MS);
+      return true;
+    case MACRO_OP_LAYER: {
+      KeyAction layer = action_layer((LayerOp)pc[0], pc[1]);
+      pc += 2;
+      io.run(&layer, true);
+      io.run(&layer, false);
+      return true;
+    }
+    default:
+      LOG(LOG_EVT_MACRO_BAD_OP, runningId, op, (int)(pc - 1 - code));
+      return false;
+  }
+}
+
+void macro_poll(uint32_t nowMs) {
+  if (sleeping) {
+    if ((int32_t)(nowMs - wakeMs) < 0) return;
+    sleeping = false;
+  }
+
+  for (uint8_t budget = MACRO_STEPS_PER_POLL; budget > 0 && !sleeping; budget--) {
+    if (!io.ready()) return;
+
+    if (releasePending) {
+      emit(pendingRelease, false);
+      releasePending = false;
+    } else if (typeLeft) {
+      typeLeft--;
+      pendingRelease = action_char(*typeText++);
+      emit(pendingRelease, true);
+      releasePending = true;
+    } else if (code) {
+      if (!decode(nowMs)) finish();
+    } else if (waitCount) {
+      runningId = waiting[waitHead];
+      waitHead = (waitHead + 1) % MACRO_QUEUE_LEN;
+      waitCount--;
+      code = pc = macroTable[runningId];
+      LOG(LOG_EVT_MACRO_STARTED, runningId);
+    } else {
+      return;
+    }
+  }
+}
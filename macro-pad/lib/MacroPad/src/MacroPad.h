@@ -0,0 +1,142 @@
+#ifndef MACROPAD_H
+#define MACROPAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Keymap.h"
+
+// --- Macro Engine Configuration ---
+#define MACRO_QUEUE_LEN       4    // Macros waiting behind the running one
+#define MACRO_STEPS_PER_POLL  4    // Steps (one report at most each) per macro_poll()
+#define MACRO_KEEP_CREDITS    2    // Transport credits always left for real key presses
+#define MACRO_CONSUMER_GAP_MS 25   // Pause after a consumer tap (> MEDIA_KEY_HOLD_MS)
+
+// --- Bytecode ---
+// A macro is a byte string in flash ending with MACRO_OP_END. Operands are
+// little-endian and follow their opcode directly.
+enum MacroOpcode : uint8_t {
+  MACRO_OP_END,       //
+  MACRO_OP_PRESS,     // usage            keyboard usage down (0xE0-0xE7 are modifiers)
+  MACRO_OP_RELEASE,   // usage            keyboard usage up
+  MACRO_OP_TAP,       // usage            down, then up in the next report
+  MACRO_OP_TYPE,      // len, chars[len]  US-layout ASCII, Shift added where needed
+  MACRO_OP_DELAY,     // ms (u16)         wait without blocking anything else
+  MACRO_OP_CONSUMER,  // usage (u16)      consumer tap, e.g. HID_CONSUMER_MUTE
+  MACRO_OP_LAYER,     // LayerOp, layer   as if a layer key were tapped
+};
+
+// One source-level step; macro_encode() turns a list of them into bytecode
+struct MacroStep {
+  uint8_t op;
+  uint16_t arg;
+  uint8_t arg2;
+  const char* text;
+};
+
+constexpr MacroStep m_press(uint8_t usage)    { return {MACRO_OP_PRESS, usage, 0, nullptr}; }
+constexpr MacroStep m_release(uint8_t usage)  { return {MACRO_OP_RELEASE, usage, 0, nullptr}; }
+constexpr MacroStep m_tap(uint8_t usage)      { return {MACRO_OP_TAP, usage, 0, nullptr}; }
+constexpr MacroStep m_type(const char* text)  { return {MACRO_OP_TYPE, 0, 0, text}; }
+constexpr MacroStep m_delay(uint16_t ms)      { return {MACRO_OP_DELAY, ms, 0, nullptr}; }
+constexpr MacroStep m_consumer(uint16_t usage) { return {MACRO_OP_CONSUMER, usage, 0, nullptr}; }
+constexpr MacroStep m_layer(LayerOp op, uint8_t layer) { return {MACRO_OP_LAYER, op, layer, nullptr}; }
+
+constexpr size_t macroTextLen(const char* text) {
+  size_t n = 0;
+  while (text[n]) n++;
+  return n;
+}
+
+constexpr size_t macroStepLen(const MacroStep& step) {
+  switch (step.op) {
+    case MACRO_OP_TYPE: {
+      // Long strings are split into several TYPE ops of up to 255 characters
+      size_t n = macroTextLen(step.text);
+      return n + 2 * ((n + 254) / 255);
+    }
+    case MACRO_OP_DELAY:
+    case MACRO_OP_CONSUMER:
+    case MACRO_OP_LAYER:
+      return 3;
+    default:
+      return 2;
+  }
+}
+
+template <size_t K>
+constexpr size_t macro_encoded_len(const MacroStep (&steps)[K]) {
+  size_t len = 1;  // MACRO_OP_END
+  for (size_t i = 0; i < K; i++) len += macroStepLen(steps[i]);
+  return len;
+}
+
+template <size_t N>
+struct MacroCode {
+  uint8_t code[N];
+};
+
+template <size_t N, size_t K>
+constexpr MacroCode<N> macro_encode(const MacroStep (&steps)[K]) {
+  MacroCode<N> out = {};
+  size_t at = 0;
+  for (size_t i = 0; i < K; i++) {
+    const MacroStep& s = steps[i];
+    if (s.op == MACRO_OP_TYPE) {
+      size_t n = macroTextLen(s.text);
+      for (size_t done = 0; done < n;) {
+        size_t chunk = n - done < 255 ? n - done : 255;
+        out.code[at++] = MACRO_OP_TYPE;
+        out.code[at++] = chunk;
+        for (size_t c = 0; c < chunk; c++) out.code[at++] = s.text[done++];
+      }
+      continue;
+    }
+    out.code[at++] = s.op;
+    out.code[at++] = s.arg & 0xFF;
+    if (s.op == MACRO_OP_LAYER) out.code[at++] = s.arg2;
+    else if (macroStepLen(s) == 3) out.code[at++] = s.arg >> 8;
+  }
+  out.code[at] = MACRO_OP_END;
+  return out;
+}
+
+// Define a constant macro: MACRO_DEFINE(copyAll, m_press(HID_KEY_LEFT_CTRL), ...);
+// The encoded bytes are name.code, sized exactly at compile time.
+#define MACRO_DEFINE(name, ...) \
+  constexpr MacroStep name##Steps[] = {__VA_ARGS__}; \
+  constexpr MacroCode<macro_encoded_len(name##Steps)> name = \
+      macro_encode<macro_encoded_len(name##Steps)>(name##Steps)
+
+// Bytes up to and including MACRO_OP_END, or 0 when the code is not a
+// complete macro within maxLen (unknown opcode or missing END). Used to
+// validate macros loaded from a stored config before they can run.
+uint32_t macro_code_len(const uint8_t* code, uint32_t maxLen);
+
+// --- Interpreter ---
+// Where the interpreter's output goes. The firmware wires this to the keymap
+// dispatcher and the HID transport; host benchmarks pass counters.
+struct MacroIo {
+  void (*run)(const KeyAction* action, bool pressed);
+  void (*flush)();   // End of one report's worth of changes
+  bool (*ready)();   // false while the output path has no room
+};
+
+// Portable interpreter (no Arduino dependency). macros[id] is the bytecode
+// ACTION_MACRO keys with code == id start.
+void macro_init(const uint8_t* const* macros, uint8_t count, const MacroIo* io);
+
+// Queue a macro; it starts once the running one (if any) has finished.
+// Returns false when the id is unknown or the queue is full.
+bool macro_start(uint16_t id);
+
+// Run the active macro for at most MACRO_STEPS_PER_POLL steps and return.
+// Call every loop() pass; delays and a busy transport just make it return.
+void macro_poll(uint32_t nowMs);
+
+bool macro_busy();
+
+// Wire the interpreter to the keymap and BLE HID, and register the
+// ACTION_MACRO handler
+void macro_begin(const uint8_t* const* macros, uint8_t count);
+
+#endif // MACROPAD_H
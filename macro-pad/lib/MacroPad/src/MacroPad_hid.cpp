@@ -0,0 +1,65 @@
+#include "MacroPad.h"
+#include "Macro_Recorder.h"
+#include "BLE_HID.h"
+#include "HID_Transport.h"
+#include "Key_Resolve.h"
+#include "Rotary_Encoder.h"
+
+// A macro waits until the host is listening, and only types as fast as the
+// link sends: its reports, queued or in flight, never take the last
+// MACRO_KEEP_CREDITS, so a real key press goes out at once
+static bool hidReady() {
+  uint8_t queued = HID_TRANSPORT_QUEUE_LEN - 1 - hid_transport_queue_free();
+  return ble_hid_ready() && hid_transport_in_flight() + queued + MACRO_KEEP_CREDITS <= HID_TX_CREDITS;
+}
+
+static const MacroIo hidIo = {keymap_dispatch, ble_hid_flush, hidReady};
+
+// Macro keys start their macro on press; the release does nothing
+static void handleMacroKey(const KeyAction* action, bool pressed) {
+  if (pressed) macro_start(action->code);
+}
+
+void macro_begin(const uint8_t* const* macros, uint8_t count) {
+  macro_init(macros, count, &hidIo);
+  keymap_set_handler(ACTION_MACRO, handleMacroKey);
+}
+
+// Recordings play back as raw matrix edges and detents, through key
+// resolution and the encoder, paced the same way as macros
+static void playKey(uint8_t row, uint8_t col, bool pressed) {
+  resolve_key_event(row, col, pressed, micros());
+}
+
+static void playRotation(int32_t detents) {
+  encoder_add_detents(detents, millis());
+}
+
+static const RecorderIo recorderIo = {
+  playKey, playRotation, ble_hid_flush, hidReady, keymap_lookup, recorder_store_save,
+};
+
+// Record keys toggle recording into their slot; play keys start playback
+static void handleRecorderKey(const KeyAction* action, bool pressed) {
+  if (!pressed) return;
+  uint8_t slot = action->code & 0xFF;
+  switch (action->code >> 8) {
+    case RECORDER_RECORD:
+      if (recorder_recording()) {
+        recorder_stop();
+      } else {
+        recorder_start(slot);
+      }
+      break;
+    case RECORDER_PLAY:
+    case RECORDER_PLAY_FAST:
+      recorder_play(slot, action->code >> 8 == RECORDER_PLAY_FAST, millis());
+      break;
+  }
+}
+
+void recorder_begin(uint16_t maxGapMs) {
+  recorder_init(&recorderIo, maxGapMs);
+  recorder_store_load();
+  keymap_set_handler(ACTION_RECORDER, handleRecorderKey);
+}
@@ -0,0 +1,298 @@
+#include "Macro_Recorder.h"
+#include "Log.h"
+#include <string.h>
+
+// Key edges pack row and column into one byte
+static_assert(KEYPAD_MAX_ROWS <= 8 && KEYPAD_MAX_COLS <= 16, "Key edges no longer fit the recording format");
+
+#define KIND_KEY       0
+#define KIND_ROTATION  1
+#define MAX_GAP_MS     0x00FFFFFF  // A longer pause is recorded as this (about 4.6 hours)
+
+static RecorderIo io;
+static uint16_t gapCapMs;
+static RecorderStats stats;
+
+// Recordings, loaded from storage at start and replaced when one is saved
+static uint8_t slotData[RECORDER_SLOTS][RECORDER_MAX_BYTES];
+static uint16_t slotLen[RECORDER_SLOTS];
+
+// Recording in progress. Keys already down when it started, and the
+// record/play keys themselves, are in skipped until they are released.
+static uint8_t capture[RECORDER_MAX_BYTES];
+static uint16_t captureLen;
+static uint32_t captureEvents;
+static uint8_t recordSlot;
+static bool recording;
+static bool firstEvent;
+static uint32_t lastEventUs;
+static uint16_t down[KEYPAD_MAX_ROWS];
+static uint16_t skipped[KEYPAD_MAX_ROWS];
+
+// Playback in progress, read in place from slotData. Keys it pressed are
+// released when it ends, so a recording cut off mid-chord leaves nothing down.
+static uint8_t playSlot;
+static bool playing;
+static uint16_t playAt;
+static uint16_t playCapMs;  // RECORDER_GAP_KEEP for the recorded timing
+static uint32_t dueMs;
+static uint16_t heldByPlayback[KEYPAD_MAX_ROWS];
+
+// --- Encoding ---
+
+static bool putVarint(uint32_t value) {
+  do {
+    if (captureLen == RECORDER_MAX_BYTES) return false;
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    capture[captureLen++] = byte | (value ? 0x80 : 0);
+  } while (value);
+  return true;
+}
+
+static bool getVarint(const uint8_t* data, uint16_t len, uint16_t* at, uint32_t* value) {
+  *value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    if (*at >= len) return false;
+    uint8_t byte = data[(*at)++];
+    *value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+  return false;
+}
+
+static uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+struct RecordedEvent {
+  uint32_t gapMs;
+  uint8_t kind;
+  uint8_t key;       // KIND_KEY: pressed << 7 | row << 4 | col
+  int32_t detents;   // KIND_ROTATION
+};
+
+// Returns false at a malformed or cut-off event
+static bool decodeEvent(const uint8_t* data, uint16_t len, uint16_t* at, RecordedEvent* event) {
+  uint32_t header;
+  if (!getVarint(data, len, at, &header)) return false;
+  event->gapMs = header >> 1;
+  event->kind = header & 1;
+  if (event->kind == KIND_KEY) {
+    if (*at >= len) return false;
+    event->key = data[(*at)++];
+    return true;
+  }
+  uint32_t detents;
+  if (!getVarint(data, len, at, &detents)) return false;
+  event->detents = unzigzag(detents);
+  return true;
+}
+
+uint16_t recorder_check(const uint8_t* data, uint16_t len) {
+  uint16_t at = 0;
+  RecordedEvent event;
+  while (at < len) {
+    if (!decodeEvent(data, len, &at, &event)) return 0;
+  }
+  return at;
+}
+
+// --- Recording ---
+
+void recorder_init(const RecorderIo* output, uint16_t maxGapMs) {
+  if (playing) recorder_cancel_play();
+  io = *output;
+  gapCapMs = maxGapMs ? maxGapMs : RECORDER_GAP_KEEP;
+  recording = false;
+  memset(slotLen, 0, sizeof(slotLen));
+}
+
+bool recorder_load(uint8_t slot, const uint8_t* data, uint16_t len) {
+  if (slot >= RECORDER_SLOTS || (playing && slot == playSlot)) return false;
+  slotLen[slot] = 0;
+  if (len > RECORDER_MAX_BYTES || recorder_check(data, len) != len) return false;
+  memcpy(slotData[slot], data, len);
+  slotLen[slot] = len;
+  return true;
+}
+
+static void autoStop() {
+  stats.truncated++;
+  LOG(LOG_EVT_RECORDER_FULL, recordSlot, captureEvents);
+  recorder_stop();
+}
+
+// Milliseconds since the last event. The remainder below a millisecond is
+// carried, so gaps do not drift over a long recording.
+static uint32_t takeGapMs(uint32_t timestampUs) {
+  if (firstEvent) {
+    firstEvent = false;
+    lastEventUs = timestampUs;
+    return 0;
+  }
+  uint32_t gapMs = (timestampUs - lastEventUs) / 1000;
+  lastEventUs += gapMs * 1000;
+  if (gapMs > stats.longestGapMs) stats.longestGapMs = gapMs > 0xFFFF ? 0xFFFF : gapMs;
+  return gapMs > MAX_GAP_MS ? MAX_GAP_MS : gapMs;
+}
+
+// An event goes in whole or not at all; a full buffer ends the recording
+static void append(uint32_t timestampUs, uint8_t kind, uint32_t payload) {
+  uint16_t start = captureLen;
+  bool fits = putVarint(takeGapMs(timestampUs) << 1 | kind);
+  if (fits && kind == KIND_KEY) {
+    fits = captureLen < RECORDER_MAX_BYTES;
+    if (fits) capture[captureLen++] = (uint8_t)payload;
+  } else if (fits) {
+    fits = putVarint(payload);
+  }
+  if (!fits) {
+    captureLen = start;
+    autoStop();
+    return;
+  }
+  captureEvents++;
+  stats.recorded++;
+}
+
+void recorder_capture_key(uint8_t row, uint8_t col, bool pressed, uint32_t timestampUs) {
+  if (row >= KEYPAD_MAX_ROWS || col >= KEYPAD_MAX_COLS) return;
+  uint16_t bit = 1 << col;
+  if (pressed) {
+    down[row] |= bit;
+    if (!recording) return;
+    const KeyAction* action = io.lookup(row, col);
+    if (action && action->type == ACTION_RECORDER) {
+      skipped[row] |= bit;
+      return;
+    }
+  } else {
+    down[row] &= ~bit;
+    if (skipped[row] & bit) {
+      skipped[row] &= ~bit;
+      return;
+    }
+    if (!recording) return;
+  }
+  append(timestampUs, KIND_KEY, (pressed ? 0x80 : 0) | row << 4 | col);
+}
+
+void recorder_capture_rotation(int32_t detents, uint32_t timestampUs) {
+  if (recording && detents) append(timestampUs, KIND_ROTATION, zigzag(detents));
+}
+
+bool recorder_start(uint8_t slot) {
+  if (slot >= RECORDER_SLOTS || recording || (playing && slot == playSlot)) return false;
+  recordSlot = slot;
+  recording = true;
+  firstEvent = true;
+  captureLen = 0;
+  captureEvents = 0;
+  memcpy(skipped, down, sizeof(skipped));
+  LOG(LOG_EVT_RECORDER_STARTED, slot);
+  return true;
+}
+
+bool recorder_stop() {
+  if (!recording) return false;
+  recording = false;
+  memcpy(slotData[recordSlot], capture, captureLen);
+  slotLen[recordSlot] = captureLen;
+  bool saved = io.save(recordSlot, capture, captureLen);
+  LOG(LOG_EVT_RECORDER_SAVED, recordSlot, captureEvents, saved ? captureLen : 0);
+  return saved;
+}
+
+// --- Playback ---
+
+bool recorder_play(uint8_t slot, bool fast, uint32_t nowMs) {
+  if (slot >= RECORDER_SLOTS || !slotLen[slot] || playing) return false;
+  if (recording && slot == recordSlot) return false;
+  playSlot = slot;
+  playing = true;
+  playAt = 0;
+  playCapMs = fast ? 0 : gapCapMs;
+  dueMs = nowMs;
+  memset(heldByPlayback, 0, sizeof(heldByPlayback));
+  LOG(LOG_EVT_RECORDER_PLAYING, slot, slotLen[slot], playCapMs);
+  return true;
+}
+
+void recorder_cancel_play() {
+  if (!playing) return;
+  playing = false;
+  for (uint8_t row = 0; row < KEYPAD_MAX_ROWS; row++) {
+    for (uint8_t col = 0; col < KEYPAD_MAX_COLS; col++) {
+      if (heldByPlayback[row] & (1 << col)) io.key(row, col, false);
+    }
+    heldByPlayback[row] = 0;
+  }
+  io.flush();
+}
+
+// Gap before the event at playAt, capped
+static uint32_t nextGapMs() {
+  uint16_t at = playAt;
+  uint32_t header;
+  if (!getVarint(slotData[playSlot], slotLen[playSlot], &at, &header)) return 0;
+  uint32_t gapMs = header >> 1;
+  return playCapMs != RECORDER_GAP_KEEP && gapMs > playCapMs ? playCapMs : gapMs;
+}
+
+void recorder_poll(uint32_t nowMs) {
+  for (uint8_t n = 0; n < RECORDER_EVENTS_PER_POLL && playing; n++) {
+    if ((int32_t)(nowMs - dueMs) < 0 || !io.ready()) return;
+
+    RecordedEvent event;
+    if (playAt >= slotLen[playSlot] ||
+        !decodeEvent(slotData[playSlot], slotLen[playSlot], &playAt, &event)) {
+      recorder_cancel_play();
+      return;
+    }
+
+    if (event.kind == KIND_KEY) {
+      uint8_t row = (event.key >> 4) & 0x07;
+      uint8_t col = event.key & 0x0F;
+      bool pressed = event.key & 0x80;
+      if (pressed) {
+        heldByPlayback[row] |= 1 << col;
+      } else {
+        heldByPlayback[row] &= ~(1 << col);
+      }
+      io.key(row, col, pressed);
+      io.flush();
+    } else {
+      io.rotate(event.detents);
+    }
+    stats.played++;
+
+    // Gaps run from when an event actually went out, so a link that held
+    // playback back never makes the following events bunch up
+    dueMs = nowMs + nextGapMs();
+  }
+}
+
+bool recorder_recording() {
+  return recording;
+}
+
+bool recorder_playing() {
+  return playing;
+}
+
+uint16_t recorder_slot_len(uint8_t slot) {
+  return slot < RECORDER_SLOTS ? slotLen[slot] : 0;
+}
+
+const uint8_t* recorder_slot_data(uint8_t slot) {
+  return slot < RECORDER_SLOTS ? slotData[slot] : nullptr;
+}
+
+void recorder_get_stats(RecorderStats* out) {
+  *out = stats;
+}
@@ -0,0 +1,106 @@
+#ifndef MACRO_RECORDER_H
+#define MACRO_RECORDER_H
+
+#include <stdint.h>
+#include "Keymap.h"
+#include "Keypad.h"
+
+// --- Macro Recorder Configuration ---
+#define RECORDER_SLOTS            4
+#define RECORDER_MAX_BYTES        1024    // Per recording; 340-510 key edges
+#define RECORDER_EVENTS_PER_POLL  4       // Events (one report at most each) per recorder_poll()
+#define RECORDER_GAP_KEEP         0xFFFF  // Play back with the recorded timing
+
+// --- Recording Format ---
+// The matrix edges and encoder detents seen while recording, in order. Each
+// event is a varint (7 bits per byte, low first) of the milliseconds since
+// the previous event shifted left by one, with the low bit telling the kind:
+//
+//   0: key edge, then one byte: pressed << 7 | row << 4 | col
+//   1: rotation, then the detents as a zigzag varint
+//
+// The first event has no gap. A key edge costs two bytes after a gap under
+// 64 ms and three under 8 s, so a slot holds 340-510 of them. Recordings
+// replay raw edges through key resolution and the keymap, the path live
+// keys take, so layer keys held while recording work the same way on
+// playback.
+
+// Record and play keys: code = RecorderOp (high byte) and slot (low byte)
+enum RecorderOp : uint8_t {
+  RECORDER_RECORD,     // Start recording into the slot; pressed again, stop and save
+  RECORDER_PLAY,       // Play with the configured gap cap (see recorder_init())
+  RECORDER_PLAY_FAST,  // Play with no gaps, as fast as the link takes it
+};
+
+constexpr KeyAction action_record(uint8_t slot) {
+  return KeyAction{ACTION_RECORDER, 0, (uint16_t)(RECORDER_RECORD << 8 | slot)};
+}
+
+constexpr KeyAction action_play(uint8_t slot, bool fast = false) {
+  return KeyAction{ACTION_RECORDER, 0, (uint16_t)((fast ? RECORDER_PLAY_FAST : RECORDER_PLAY) << 8 | slot)};
+}
+
+// Where playback goes and recordings are kept. key() and rotate() feed
+// events in the way the input stage does, flush() ends one report, ready()
+// is false while the output path has no room, lookup() is the action a
+// press would resolve to now, and save() stores a finished recording.
+struct RecorderIo {
+  void (*key)(uint8_t row, uint8_t col, bool pressed);
+  void (*rotate)(int32_t detents);
+  void (*flush)();
+  bool (*ready)();
+  const KeyAction* (*lookup)(uint8_t row, uint8_t col);
+  bool (*save)(uint8_t slot, const uint8_t* data, uint16_t len);
+};
+
+struct RecorderStats {
+  uint32_t recorded;   // Events captured
+  uint32_t played;     // Events played back
+  uint32_t truncated;  // Recordings cut short by a full buffer
+  uint16_t longestGapMs;  // Longest gap recorded
+};
+
+// Portable core (no Arduino dependency; all buffers are static, so nothing
+// is allocated while recording). maxGapMs caps every gap on RECORDER_PLAY,
+// 0 or RECORDER_GAP_KEEP keeps the recorded timing.
+void recorder_init(const RecorderIo* io, uint16_t maxGapMs);
+
+// Put a stored recording into a slot. Returns false, leaving the slot
+// empty, when it does not decode.
+bool recorder_load(uint8_t slot, const uint8_t* data, uint16_t len);
+
+// Bytes a recording decodes to, 0 when it is not complete within len
+uint16_t recorder_check(const uint8_t* data, uint16_t len);
+
+// Every debounced edge and encoder turn, before key resolution. Keys already
+// down when recording started, and record/play keys, are left out.
+void recorder_capture_key(uint8_t row, uint8_t col, bool pressed, uint32_t timestampUs);
+void recorder_capture_rotation(int32_t detents, uint32_t timestampUs);
+
+bool recorder_start(uint8_t slot);
+bool recorder_stop();  // Saves through io->save(); false when the save failed
+
+// Play a slot, with no gaps when fast. Returns false when the slot is
+// empty, being recorded, or something is playing already.
+bool recorder_play(uint8_t slot, bool fast, uint32_t nowMs);
+void recorder_cancel_play();  // Releases whatever the playback holds
+
+// Play due events, at most RECORDER_EVENTS_PER_POLL. Call every loop pass.
+void recorder_poll(uint32_t nowMs);
+
+bool recorder_recording();
+bool recorder_playing();
+uint16_t recorder_slot_len(uint8_t slot);
+const uint8_t* recorder_slot_data(uint8_t slot);
+void recorder_get_stats(RecorderStats* stats);
+
+// Wire the recorder to key resolution, the encoder and BLE HID, load the
+// stored recordings and register the ACTION_RECORDER handler
+void recorder_begin(uint16_t maxGapMs);
+
+// --- Storage ---
+// NVS on the ESP32, RAM that outlives a restart in the host build
+void recorder_store_load();  // Calls recorder_load() for each stored slot
+bool recorder_store_save(uint8_t slot, const uint8_t* data, uint16_t len);
+
+#endif // MACRO_RECORDER_H
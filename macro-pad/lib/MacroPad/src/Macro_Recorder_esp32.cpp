@@ -0,0 +1,43 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "Macro_Recorder.h"
+
+// One NVS blob per slot; an empty recording removes its key
+#define RECORDER_NVS_NAMESPACE "recorder"
+
+static Preferences prefs;
+static bool prefsOpen;
+
+static void slotKey(uint8_t slot, char* key) {
+  memcpy(key, "slot0", 6);
+  key[4] = '0' + slot;
+}
+
+static void openPrefs() {
+  if (!prefsOpen) prefsOpen = prefs.begin(RECORDER_NVS_NAMESPACE);
+}
+
+void recorder_store_load() {
+  // Staging for one slot at a time; recorder_load() copies it
+  static uint8_t stored[RECORDER_MAX_BYTES];
+  char key[6];
+  openPrefs();
+  for (uint8_t slot = 0; slot < RECORDER_SLOTS; slot++) {
+    slotKey(slot, key);
+    size_t len = prefs.getBytesLength(key);
+    if (!len || len > sizeof(stored)) continue;
+    if (prefs.getBytes(key, stored, len) == len) recorder_load(slot, stored, len);
+  }
+}
+
+bool recorder_store_save(uint8_t slot, const uint8_t* data, uint16_t len) {
+  char key[6];
+  openPrefs();
+  slotKey(slot, key);
+  if (!len) return !prefs.isKey(key) || prefs.remove(key);
+  return prefs.putBytes(key, data, len) == len;
+}
+
+#endif // ARDUINO_ARCH_ESP32
@@ -0,0 +1,97 @@
+#include "Power.h"
+#include "Log.h"
+#include <stdio.h>
+#include <string.h>
+
+static PowerIo io;
+static uint64_t idleLimitUs;
+static PowerState state;
+static PowerStats stats;
+
+// Time is kept as 64-bit sums of 32-bit micros() deltas, so idle periods and
+// state totals run past the 71 minute wrap of micros()
+static uint32_t lastUs;
+static uint64_t idleUs;
+
+static void account() {
+  uint32_t now = io.micros();
+  uint32_t elapsed = now - lastUs;
+  lastUs = now;
+  stats.stateUs[state] += elapsed;
+  idleUs += elapsed;
+}
+
+void power_init(const PowerIo* output, uint32_t idleMs) {
+  io = *output;
+  idleLimitUs = (uint64_t)idleMs * 1000;
+  state = POWER_ACTIVE;
+  lastUs = io.micros();
+  idleUs = 0;
+  memset(&stats, 0, sizeof(stats));
+}
+
+void power_activity() {
+  idleUs = 0;
+}
+
+static void enterSleep() {
+  LOG(LOG_EVT_POWER_SLEEP, (uint32_t)(idleUs / 1000000));
+  io.suspend();
+  state = POWER_SLEEP;
+  stats.sleeps++;
+}
+
+static void exitSleep() {
+  io.resume();
+  state = POWER_ACTIVE;
+  stats.inputWakes++;
+  idleUs = 0;
+  LOG(LOG_EVT_POWER_WAKE);
+}
+
+void power_poll(bool busy) {
+  account();
+
+  if (state == POWER_ACTIVE) {
+    if (busy) idleUs = 0;
+    if (idleUs >= idleLimitUs) enterSleep();
+    return;
+  }
+
+  // Asleep: block until input, or run one more loop() pass for background
+  // work (a config transfer, say) and decide again
+  bool input = io.wait(POWER_SLEEP_CHECK_MS);
+  account();
+  if (input || busy) {
+    exitSleep();
+  } else {
+    stats.checkWakes++;
+  }
+}
+
+PowerState power_state() {
+  return state;
+}
+
+void power_get_stats(PowerStats* out) {
+  account();
+  *out = stats;
+}
+
+void power_reset_stats() {
+  memset(&stats, 0, sizeof(stats));
+}
+
+size_t power_format(char* buffer, size_t size) {
+  PowerStats s;
+  power_get_stats(&s);
+  uint64_t total = s.stateUs[POWER_ACTIVE] + s.stateUs[POWER_SLEEP];
+  int len = snprintf(buffer, size,
+                     "Power: %s; active %llu ms, sleep %llu ms (%u%%); %u sleeps, %u input wakes, %u check wakes\n",
+                     state == POWER_ACTIVE ? "active" : "sleep",
+                     (unsigned long long)(s.stateUs[POWER_ACTIVE] / 1000),
+                     (unsigned long long)(s.stateUs[POWER_SLEEP] / 1000),
+                     total ? (unsigned)(s.stateUs[POWER_SLEEP] * 100 / total) : 0,
+                     s.sleeps, s.inputWakes, s.checkWakes);
+  return len < 0 ? 0 : ((size_t)len < size ? (size_t)len : size - 1);
+}
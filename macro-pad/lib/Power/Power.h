@@ -0,0 +1,60 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Keypad.h"
+
+// --- Power Manager Configuration ---
+#define POWER_IDLE_MS         (5 * 60 * 1000UL)  // Default idle time before sleeping
+#define POWER_SLEEP_CHECK_MS  1000  // Longest a sleeping loop() blocks, for background work
+#define POWER_MAX_WAKE_PINS   (KEYPAD_MAX_COLS + 2)  // Columns and the encoder
+
+// Active: the matrix is scanned at full rate. Sleep: scanning is stopped,
+// every row is held active and any column or encoder pin that changes level
+// wakes the chip; loop() blocks, so the chip can light sleep between BLE
+// connection events.
+enum PowerState : uint8_t {
+  POWER_ACTIVE,
+  POWER_SLEEP,
+  POWER_STATE_COUNT
+};
+
+struct PowerStats {
+  uint64_t stateUs[POWER_STATE_COUNT];  // Time spent in each state
+  uint32_t sleeps;       // Times the pad went to sleep
+  uint32_t inputWakes;   // Sleeps ended by a key or the encoder
+  uint32_t checkWakes;   // POWER_SLEEP_CHECK_MS wakeups that went back to sleep
+};
+
+// Platform hooks, filled in by power_begin()
+struct PowerIo {
+  uint32_t (*micros)();
+  void (*suspend)();          // Stop scanning and arm the wake pins
+  bool (*wait)(uint32_t ms);  // Block until a wake pin fires (true) or ms pass
+  void (*resume)();           // Disarm the wake pins and scan at full rate again
+};
+
+// Portable core (no Arduino dependency)
+void power_init(const PowerIo* io, uint32_t idleMs);
+
+// Input was seen: restart the idle timer
+void power_activity();
+
+// Called once per loop(). busy holds the pad awake (keys held, a macro
+// running, a transfer in progress). While asleep this blocks for up to
+// POWER_SLEEP_CHECK_MS and returns after a wake.
+void power_poll(bool busy);
+
+PowerState power_state();
+void power_get_stats(PowerStats* stats);
+void power_reset_stats();
+
+// Text dump for the serial command
+size_t power_format(char* buffer, size_t size);
+
+// Arm the given pins as wake sources and enable automatic light sleep
+// (ESP32 only)
+void power_begin(const uint8_t* wakePins, uint8_t count, uint32_t idleMs = POWER_IDLE_MS);
+
+#endif // POWER_H
@@ -0,0 +1,98 @@
+#ifdef ARDUINO_ARCH_ESP32
+
+#include <Arduino.h>
+#include <driver/gpio.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include "Power.h"
+#include "Keypad.h"
+#include "Rotary_Encoder.h"
+#include "Log.h"
+
+// While active the pad holds a lock that keeps light sleep off, since the
+// scan timer stops in light sleep. Asleep, the lock is released and loop()
+// blocks on a task notification, so FreeRTOS idle enters light sleep on its
+// own between BLE connection events and the link stays up. The wake pins
+// use level interrupts, the only GPIO trigger that wakes light sleep.
+static uint8_t wakePins[POWER_MAX_WAKE_PINS];
+static uint8_t wakePinCount;
+static TaskHandle_t sleeper;
+static esp_pm_lock_handle_t awakeLock;
+
+static void IRAM_ATTR onWakePin() {
+  // Level interrupts keep firing while the level holds; mask them until resume
+  for (uint8_t i = 0; i < wakePinCount; i++) gpio_intr_disable((gpio_num_t)wakePins[i]);
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(sleeper, &woken);
+  if (woken) portYIELD_FROM_ISR();
+}
+
+static uint32_t espMicros() {
+  return micros();
+}
+
+static void espSuspend() {
+  keypad_suspend();   // All rows active: a key press pulls its column low
+  encoder_suspend();
+  sleeper = xTaskGetCurrentTaskHandle();
+  ulTaskNotifyTake(pdTRUE, 0);
+
+  // Wake when a pin leaves the level it has now
+  for (uint8_t i = 0; i < wakePinCount; i++) {
+    bool high = digitalRead(wakePins[i]) == HIGH;
+    attachInterrupt(digitalPinToInterrupt(wakePins[i]), onWakePin, high ? ONLOW : ONHIGH);
+    gpio_wakeup_enable((gpio_num_t)wakePins[i], high ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  }
+  esp_sleep_enable_gpio_wakeup();
+  if (awakeLock) esp_pm_lock_release(awakeLock);
+}
+
+static bool espWait(uint32_t ms) {
+  return ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ms)) > 0;
+}
+
+static void espResume() {
+  if (awakeLock) esp_pm_lock_acquire(awakeLock);
+  for (uint8_t i = 0; i < wakePinCount; i++) {
+    gpio_wakeup_disable((gpio_num_t)wakePins[i]);
+    detachInterrupt(digitalPinToInterrupt(wakePins[i]));
+  }
+  encoder_resume();
+  keypad_resume();
+}
+
+static const PowerIo esp32Power = {
+  espMicros,
+  espSuspend,
+  espWait,
+  espResume,
+};
+
+void power_begin(const uint8_t* pins, uint8_t count, uint32_t idleMs) {
+  wakePinCount = count > POWER_MAX_WAKE_PINS ? POWER_MAX_WAKE_PINS : count;
+  memcpy(wakePins, pins, wakePinCount);
+
+  // Fixed CPU clock (the scan timer's prescaler assumes an 80 MHz APB),
+  // light sleep whenever nothing holds the lock
+  esp_pm_config_esp32c3_t pm = {};
+  pm.max_freq_mhz = getCpuFrequencyMhz();
+  pm.min_freq_mhz = getCpuFrequencyMhz();
+  pm.light_sleep_enable = true;
+  // The lock is taken before light sleep is enabled, so scanning never stops
+  esp_err_t err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "active", &awakeLock);
+  if (err == ESP_OK) {
+    esp_pm_lock_acquire(awakeLock);
+    err = esp_pm_configure(&pm);
+  } else {
+    awakeLock = nullptr;
+  }
+  if (err != ESP_OK) {
+    // Without power management support, blocking still lets the idle task
+    // clock-gate the CPU; there is just no light sleep
+    LOG(LOG_EVT_POWER_NO_PM, err);
+  }
+
+  power_init(&esp32Power, idleMs);
+}
+
+#endif // ARDUINO_ARCH_ESP32
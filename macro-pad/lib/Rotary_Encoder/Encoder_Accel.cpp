@@ -0,0 +1,75 @@
+#include "Encoder_Accel.h"
+
+static EncoderAccelConfig config;
+
+static uint32_t lastDetentMs;
+static uint16_t velocity;       // detents per second, exponential moving average
+static bool batchOpen;
+static uint32_t batchStartMs;
+static int32_t batchSteps;      // accelerated steps, in 1/ENCODER_ACCEL_FRACTION units
+
+void encoder_accel_init(const EncoderAccelConfig* cfg) {
+  config = *cfg;
+  if (config.maxMultiplier < 1) config.maxMultiplier = 1;
+  if (config.fastDetentsPerSec <= config.slowDetentsPerSec) {
+    config.fastDetentsPerSec = config.slowDetentsPerSec + 1;
+  }
+  velocity = 0;
+  batchOpen = false;
+  batchSteps = 0;
+}
+
+// Linear ramp from 1x at slowDetentsPerSec to maxMultiplier at fastDetentsPerSec
+static uint16_t multiplierFor(uint16_t speed) {
+  const uint16_t one = ENCODER_ACCEL_FRACTION;
+  const uint16_t top = config.maxMultiplier * ENCODER_ACCEL_FRACTION;
+  if (speed <= config.slowDetentsPerSec) return one;
+  if (speed >= config.fastDetentsPerSec) return top;
+  uint32_t span = config.fastDetentsPerSec - config.slowDetentsPerSec;
+  return one + (uint32_t)(top - one) * (speed - config.slowDetentsPerSec) / span;
+}
+
+void encoder_accel_add(int32_t detents, uint32_t nowMs) {
+  if (detents == 0) return;
+  uint32_t count = detents < 0 ? -detents : detents;
+
+  uint32_t dt = nowMs - lastDetentMs;
+  lastDetentMs = nowMs;
+  if (dt >= ENCODER_ACCEL_IDLE_MS) {
+    velocity = 0;
+  } else {
+    uint32_t instant = count * 1000 / (dt ? dt : 1);
+    if (instant > 0xFFFF) instant = 0xFFFF;
+    velocity = (velocity * 3 + instant) / 4;
+  }
+
+  if (!batchOpen) {
+    // Leftover fractions never carry into the opposite direction or past an idle gap
+    if (dt >= ENCODER_ACCEL_IDLE_MS || (batchSteps ^ detents) < 0) batchSteps = 0;
+    batchOpen = true;
+    batchStartMs = nowMs;
+  }
+  batchSteps += detents * (int32_t)multiplierFor(velocity);
+}
+
+int32_t encoder_accel_take(uint32_t nowMs) {
+  if (!batchOpen || nowMs - batchStartMs < config.windowMs) return 0;
+  batchOpen = false;
+
+  int32_t steps = batchSteps / ENCODER_ACCEL_FRACTION;
+  batchSteps -= steps * ENCODER_ACCEL_FRACTION;
+  return steps;
+}
+
+int32_t encoder_accel_take_fine(uint32_t nowMs) {
+  if (!batchOpen || nowMs - batchStartMs < config.windowMs) return 0;
+  batchOpen = false;
+
+  int32_t fine = batchSteps;
+  batchSteps = 0;
+  return fine;
+}
+
+uint16_t encoder_accel_velocity() {
+  return velocity;
+}
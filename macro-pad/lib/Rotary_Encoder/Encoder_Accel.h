@@ -0,0 +1,34 @@
+#ifndef ENCODER_ACCEL_H
+#define ENCODER_ACCEL_H
+
+#include <stdint.h>
+
+// --- Encoder Acceleration Configuration ---
+#define ENCODER_ACCEL_FRACTION  16    // Multipliers are fixed point, 1/16 steps
+#define ENCODER_ACCEL_IDLE_MS   250   // A gap this long resets the velocity estimate
+
+struct EncoderAccelConfig {
+  uint16_t windowMs;           // Detents within this window go out as one batch
+  uint16_t slowDetentsPerSec;  // At or below this speed every detent is one step
+  uint16_t fastDetentsPerSec;  // At or above this speed detents get maxMultiplier
+  uint8_t maxMultiplier;       // 1 disables acceleration
+};
+
+// Portable acceleration/aggregation stage (no Arduino dependency)
+void encoder_accel_init(const EncoderAccelConfig* config);
+
+// Feed detents read from the decoder
+void encoder_accel_add(int32_t detents, uint32_t nowMs);
+
+// Accelerated steps for the batch whose window has closed, or 0 while a
+// batch is still collecting. Fractional steps carry over to the next batch.
+int32_t encoder_accel_take(uint32_t nowMs);
+
+// The same batch in 1/ENCODER_ACCEL_FRACTION steps, for outputs that take
+// fractions (the hi-res wheel); nothing carries over
+int32_t encoder_accel_take_fine(uint32_t nowMs);
+
+// Smoothed rotation speed in detents per second
+uint16_t encoder_accel_velocity();
+
+#endif // ENCODER_ACCEL_H
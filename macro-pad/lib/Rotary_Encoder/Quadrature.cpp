@@ -0,0 +1,74 @@
+#include "Quadrature.h"
+#include <atomic>
+
+// Step for each (previous AB << 2 | current AB) transition. The four
+// entries where both pins changed are invalid and resolved separately.
+static const int8_t transitionTable[16] = {
+   0, +1, -1,  0,
+  -1,  0,  0, +1,
+  +1,  0,  0, -1,
+   0, -1, +1,  0,
+};
+static const uint16_t doubleStepMask = (1 << 0x3) | (1 << 0x6) | (1 << 0x9) | (1 << 0xC);
+
+// Written only by quadrature_update()
+static uint8_t lastState;
+static int8_t lastDirection;
+static std::atomic<int32_t> position(0);
+static QuadratureStats stats;
+
+// Written only by the reader
+static int32_t consumed;
+
+void quadrature_init(uint8_t ab) {
+  lastState = ab & 0x03;
+  lastDirection = 0;
+  position.store(0);
+  consumed = 0;
+  stats = QuadratureStats();
+}
+
+void quadrature_update(uint8_t ab) {
+  ab &= 0x03;
+  uint8_t index = (lastState << 2) | ab;
+  lastState = ab;
+
+  int8_t step = transitionTable[index];
+  if (step != 0) {
+    lastDirection = step;
+    stats.transitions++;
+  } else if ((doubleStepMask >> index) & 1) {
+    // An edge was missed while spinning fast: both pins moved, so the
+    // encoder went two steps, most likely in the direction it was going
+    step = 2 * lastDirection;
+    stats.recovered++;
+  } else {
+    stats.glitches++;
+    return;
+  }
+
+  position.store(position.load(std::memory_order_relaxed) + step, std::memory_order_release);
+}
+
+void quadrature_resync(uint8_t ab) {
+  if ((ab & 0x03) != lastState) quadrature_update(ab);
+}
+
+int32_t quadrature_position() {
+  return position.load(std::memory_order_acquire);
+}
+
+int32_t quadrature_take_detents() {
+  int32_t moved = quadrature_position() - consumed;
+  int32_t detents = moved / QUADRATURE_STEPS_PER_DETENT;
+  consumed += detents * QUADRATURE_STEPS_PER_DETENT;
+  return detents;
+}
+
+void quadrature_untake_detents(int32_t detents) {
+  consumed -= detents * QUADRATURE_STEPS_PER_DETENT;
+}
+
+void quadrature_get_stats(QuadratureStats* out) {
+  *out = stats;
+}
@@ -0,0 +1,38 @@
+#ifndef QUADRATURE_H
+#define QUADRATURE_H
+
+#include <stdint.h>
+
+// --- Quadrature Decoder Configuration ---
+#define QUADRATURE_STEPS_PER_DETENT 2   // PEC12R latches at AB = 00 and 11
+
+struct QuadratureStats {
+  uint32_t transitions;  // valid single-bit transitions
+  uint32_t recovered;    // double transitions recovered from the last direction
+  uint32_t glitches;     // interrupts where AB did not change
+};
+
+// Portable decoder core (no Arduino dependency). quadrature_update() and
+// the take/untake calls run in the pin-change ISR; the position and
+// stats can be read from any task. Counts are exchanged without locks.
+void quadrature_init(uint8_t ab);
+
+// Feed the current pin state: bit 1 = A, bit 0 = B
+void quadrature_update(uint8_t ab);
+
+// Catch up after interrupts were off: count the change from the last seen
+// state, if there was one
+void quadrature_resync(uint8_t ab);
+
+// Signed steps counted so far (raw transitions, not detents)
+int32_t quadrature_position();
+
+// Whole detents moved since the last call; partial detents are kept
+int32_t quadrature_take_detents();
+
+// Hand back detents taken but not delivered; the next take returns them
+void quadrature_untake_detents(int32_t detents);
+
+void quadrature_get_stats(QuadratureStats* stats);
+
+#endif // QUADRATURE_H
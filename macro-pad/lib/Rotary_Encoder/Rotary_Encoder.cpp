@@ -1,34 +1,158 @@
-#include <RotaryEncoder.h>
+#include <Arduino.h>
+#include "Rotary_Encoder.h"
+#include "Quadrature.h"
+#include "Encoder_Accel.h"
 #include "BLE_HID.h"
+#include "Input_Bus.h"
+#include "Log.h"
 
-#define ROT_A 9
-#define ROT_B 21
-#define RECENT_CLICKS_LEN 5
+// Speed curve for the accelerated modes
+static const EncoderAccelConfig accelCurve = {
+  ENCODER_BATCH_MS,  // windowMs
+  8,                 // slowDetentsPerSec
+  40,                // fastDetentsPerSec
+  4,                 // maxMultiplier
+};
 
-static RotaryEncoder encoder(ROT_A, ROT_B, RotaryEncoder::LatchMode::TWO03);
-static int oldPos = 0;
+// Accelerated steps are wheel units, so the wheel needs no scaling
+static_assert(HID_WHEEL_RESOLUTION == ENCODER_ACCEL_FRACTION, "Wheel units are accelerated 1/16 steps");
+
+static const EncoderAccelConfig noAccel = {ENCODER_BATCH_MS, 0, 1, 1};
+
+static EncoderMode mode = ENCODER_MODE_VOLUME;
+static uint16_t consumerCw = 0;
+static uint16_t consumerCcw = 0;
+// Steps beyond ENCODER_MAX_BURST or refused by the transport, sent with the
+// next burst (wheel units in the wheel modes)
+static int32_t backlog = 0;
+static uint8_t encoderPinA = ROT_A;
+static uint8_t encoderPinB = ROT_B;
+
+static inline uint8_t readEncoderPins() {
+  return (digitalRead(encoderPinA) << 1) | digitalRead(encoderPinB);
+}
+
+// Whole detents go to the input bus as they complete; this is the only
+// producer on the encoder ring. Detents a full ring turns away go back to
+// the decoder and out with the next edge.
+static void pushDetents() {
+  static bool refused;  // The detents being taken were turned away before
+  int32_t detents = quadrature_take_detents();
+  if (detents == 0) return;
+  InputEvent event = {};
+  event.type = INPUT_ROTATION;
+  event.source = INPUT_SOURCE_ENCODER;
+  event.value = detents;
+  event.timestamp = micros();
+  refused = !input_push(&event, refused);
+  if (refused) quadrature_untake_detents(detents);
+}
+
+// Both pins interrupt on every edge, so decoding never waits on loop().
+// Not IRAM_ATTR: digitalRead(), the decoder and the input bus all run from
+// flash, so the handler must not be registered as IRAM-safe. During a flash
+// write the interrupt waits, and a missed edge is recovered by the decoder.
+static void onEncoderEdge() {
+  quadrature_update(readEncoderPins());
+  pushDetents();
+}
+
+void encoder_setup(uint8_t pinA, uint8_t pinB) {
+  encoderPinA = pinA;
+  encoderPinB = pinB;
 
-void encoder_setup() {
   // Initialize encoder pins
-  pinMode(ROT_A, INPUT_PULLUP);
-  pinMode(ROT_B, INPUT_PULLUP);
-  encoder.setPosition(0);
-}
-
-void handleEncoder() {
-  encoder.tick();
-  // click_index = (click_index + 1) % RECENT_CLICKS_LEN;
-  int newPos = encoder.getPosition();
-  // recent_clicks[click_index] = newPos;
-
-  if (newPos != oldPos) {
-    if (oldPos > newPos) {
-      Serial.println("Encoder: Volume Up");
-      ble_send_media_key(0xE9); // Volume Up
-    } else {
-      Serial.println("Encoder: Volume Down");
-      ble_send_media_key(0xEA); // Volume Down
-    }
-    oldPos = newPos;
+  pinMode(encoderPinA, INPUT_PULLUP);
+  pinMode(encoderPinB, INPUT_PULLUP);
+  quadrature_init(readEncoderPins());
+  encoder_set_mode(mode, consumerCw, consumerCcw);
+
+  attachInterrupt(digitalPinToInterrupt(encoderPinA), onEncoderEdge, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(encoderPinB), onEncoderEdge, CHANGE);
+}
+
+void encoder_suspend() {
+  detachInterrupt(digitalPinToInterrupt(encoderPinA));
+  detachInterrupt(digitalPinToInterrupt(encoderPinB));
+}
+
+void encoder_resume() {
+  quadrature_resync(readEncoderPins());
+  pushDetents();  // Interrupts are still off, so nothing else is producing
+  attachInterrupt(digitalPinToInterrupt(encoderPinA), onEncoderEdge, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(encoderPinB), onEncoderEdge, CHANGE);
+}
+
+void encoder_set_mode(EncoderMode newMode, uint16_t usageCw, uint16_t usageCcw) {
+  if (newMode == ENCODER_MODE_TRANSPARENT) return;  // Only meaningful in a keymap
+  mode = newMode;
+  consumerCw = usageCw;
+  consumerCcw = usageCcw;
+  backlog = 0;
+  encoder_accel_init(mode == ENCODER_MODE_CONSUMER ? &noAccel : &accelCurve);
+}
+
+// Returns the steps the transport took
+static int32_t sendSteps(int32_t steps) {
+  // Negative steps are counter-clockwise (Volume Up with the current wiring)
+  bool ccw = steps < 0;
+  uint8_t count = ccw ? -steps : steps;
+  uint8_t sent = 0;
+
+  switch (mode) {
+    case ENCODER_MODE_VOLUME:
+      sent = ble_send_media_burst(ccw ? HID_CONSUMER_VOLUME_UP : HID_CONSUMER_VOLUME_DOWN, count);
+      break;
+    case ENCODER_MODE_CONSUMER:
+      sent = ble_send_media_burst(ccw ? consumerCcw : consumerCw, count);
+      break;
+    case ENCODER_MODE_SCROLL:
+    case ENCODER_MODE_PAN:
+    case ENCODER_MODE_TRANSPARENT:
+      break;
   }
+  int32_t taken = ccw ? -(int32_t)sent : sent;
+  if (taken) LOG(LOG_EVT_ENCODER_STEPS, mode, taken);
+  return taken;
+}
+
+void encoder_add_detents(int32_t detents, uint32_t nowMs) {
+  encoder_accel_add(detents, nowMs);
+}
+
+// The wheel takes the whole batch, fractions included, in one report.
+// Counter-clockwise scrolls up (as it turns the volume up) and left.
+static bool sendWheel(int32_t units) {
+  bool sent = mode == ENCODER_MODE_SCROLL ? ble_send_wheel(-units, 0) : ble_send_wheel(0, units);
+  if (sent) LOG(LOG_EVT_ENCODER_WHEEL, mode, units, ble_wheel_hires());
+  return sent;
+}
+
+// While the transport pushes back, a spin is cut short rather than played
+// out long after the knob stopped
+static inline int32_t clampBacklog(int32_t value, int32_t limit) {
+  if (value > limit) return limit;
+  if (value < -limit) return -limit;
+  return value;
+}
+
+bool encoder_poll(uint32_t nowMs) {
+  if (mode == ENCODER_MODE_SCROLL || mode == ENCODER_MODE_PAN) {
+    int32_t units = backlog + encoder_accel_take_fine(nowMs);
+    if (units == 0) return false;
+    bool sent = sendWheel(units);
+    backlog = sent ? 0 : clampBacklog(units, ENCODER_MAX_BACKLOG * ENCODER_ACCEL_FRACTION);
+    return sent;
+  }
+
+  backlog += encoder_accel_take(nowMs);
+  if (backlog == 0) return false;
+
+  int32_t steps = backlog;
+  if (steps > ENCODER_MAX_BURST) steps = ENCODER_MAX_BURST;
+  if (steps < -ENCODER_MAX_BURST) steps = -ENCODER_MAX_BURST;
+  int32_t sent = sendSteps(steps);
+  backlog -= sent;
+  if (sent != steps) backlog = clampBacklog(backlog, ENCODER_MAX_BACKLOG);
+  return sent != 0;
 }
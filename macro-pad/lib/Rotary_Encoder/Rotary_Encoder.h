@@ -4,7 +4,44 @@
 #include <Arduino.h>
 
 // --- Rotary Encoder Configuration ---
-void encoder_setup();
-void handleEncoder();
+#define ROT_A 9    // Default pins; a stored config can override them
+#define ROT_B 21
 
-#endif // ROTARY_ENCODER_H
\ No newline at end of file
+enum EncoderMode : uint8_t {
+  ENCODER_MODE_VOLUME,    // Volume Up/Down, accelerated
+  ENCODER_MODE_SCROLL,    // Hi-res vertical wheel, accelerated
+  ENCODER_MODE_CONSUMER,  // Custom consumer usages, one per detent
+  ENCODER_MODE_PAN,       // Hi-res horizontal wheel, accelerated
+  ENCODER_MODE_TRANSPARENT = 0xFF,  // Keymap layers only: use the binding below
+};
+
+// What the encoder does on one keymap layer
+struct EncoderBinding {
+  EncoderMode mode;
+  uint16_t usageCw;   // ENCODER_MODE_CONSUMER only
+  uint16_t usageCcw;
+};
+
+#define ENCODER_BATCH_MS   15   // Detents within this window are sent as one burst
+#define ENCODER_MAX_BURST  8    // Taps per burst; the rest waits for the next one
+                                // (the wheel modes send each batch as one report)
+#define ENCODER_MAX_BACKLOG 32  // Steps kept while the transport pushes back
+
+// Decoding runs in the pin interrupt, which pushes INPUT_ROTATION events
+// to the input bus (see Input_Bus.h). The processing stage hands their
+// detents back through encoder_add_detents(); encoder_poll() sends the
+// accelerated bursts once each batch window closes. The wheel modes send
+// the batch with its fractions, as one wheel report.
+void encoder_setup(uint8_t pinA = ROT_A, uint8_t pinB = ROT_B);
+void encoder_add_detents(int32_t detents, uint32_t nowMs);
+bool encoder_poll(uint32_t nowMs);  // Returns true when a burst was sent
+
+// Hand the pins to a wake source and take them back. The decoder keeps its
+// last state, so the edge that caused the wake is still counted on resume.
+void encoder_suspend();
+void encoder_resume();
+
+// Select the output stage. The usages are only used by ENCODER_MODE_CONSUMER.
+void encoder_set_mode(EncoderMode mode, uint16_t usageCw = 0, uint16_t usageCcw = 0);
+
+#endif // ROTARY_ENCODER_H
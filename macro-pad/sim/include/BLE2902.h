@@ -0,0 +1,7 @@
+#ifndef SIM_BLE2902_H
+#define SIM_BLE2902_H
+
+// Host shim: all BLE classes live in BLEDevice.h
+#include <BLEDevice.h>
+
+#endif // SIM_BLE2902_H
@@ -0,0 +1,209 @@
+#ifndef SIM_BLE_DEVICE_H
+#define SIM_BLE_DEVICE_H
+
+// Host shim for the ESP32 BLE Arduino classes used by lib/BLE_HID.
+// Characteristics record notifications instead of sending them.
+
+#include <Arduino.h>
+#include <string>
+
+#define ESP_LE_AUTH_BOND 0x01
+#define HID_KEYBOARD     0x03C1
+
+// The few ESP-IDF GAP/GATTS types the firmware touches
+typedef uint8_t esp_bd_addr_t[6];
+
+enum esp_bt_status_t { ESP_BT_STATUS_SUCCESS = 0, ESP_BT_STATUS_FAIL = 1 };
+
+enum esp_gap_ble_cb_event_t {
+  ESP_GAP_BLE_AUTH_CMPL_EVT = 8,
+  ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT = 20,
+};
+
+union esp_ble_gap_cb_param_t {
+  struct {
+    esp_bt_status_t status;
+    esp_bd_addr_t bda;
+    uint16_t min_int;
+    uint16_t max_int;
+    uint16_t latency;
+    uint16_t conn_int;
+    uint16_t timeout;
+  } update_conn_params;
+  struct {
+    struct {
+      esp_bd_addr_t bd_addr;
+      bool success;
+      uint8_t addr_type;
+    } auth_cmpl;
+  } ble_security;
+};
+
+enum esp_gatts_cb_event_t {
+  ESP_GATTS_CONF_EVT = 5,
+};
+
+typedef uint8_t esp_gatt_if_t;
+
+union esp_ble_gatts_cb_param_t {
+  struct {
+    uint16_t conn_id;
+    esp_bd_addr_t remote_bda;
+  } connect;
+  struct {
+    esp_bt_status_t status;
+    uint16_t conn_id;
+    uint16_t handle;
+  } conf;
+};
+
+typedef void (*gap_event_handler)(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param);
+typedef void (*gatts_event_handler)(esp_gatts_cb_event_t event, esp_gatt_if_t gattsIf,
+                                    esp_ble_gatts_cb_param_t* param);
+
+class BLEUUID {
+ public:
+  BLEUUID() {}
+  BLEUUID(const char* uuid) : value(uuid) {}
+  BLEUUID(uint16_t uuid) : value(std::to_string(uuid)) {}
+  std::string toString() const { return value; }
+ private:
+  std::string value;
+};
+
+class BLECharacteristic;
+
+class BLEDescriptor {
+ public:
+  virtual ~BLEDescriptor() {}
+};
+
+// Notifications are on once the simulated host has subscribed
+class BLE2902 : public BLEDescriptor {
+ public:
+  bool getNotifications();
+};
+
+class BLECharacteristicCallbacks {
+ public:
+  enum Status {
+    SUCCESS_INDICATE,
+    SUCCESS_NOTIFY,
+    ERROR_INDICATE_DISABLED,
+    ERROR_NOTIFY_DISABLED,
+    ERROR_GATT,
+    ERROR_NO_CLIENT,
+    ERROR_INDICATE_TIMEOUT,
+    ERROR_INDICATE_FAILURE,
+  };
+
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onRead(BLECharacteristic* characteristic) {}
+  virtual void onWrite(BLECharacteristic* characteristic) {}
+  virtual void onStatus(BLECharacteristic* characteristic, Status s, uint32_t code) {}
+};
+
+class BLECharacteristic {
+ public:
+  static const uint32_t PROPERTY_READ     = 1 << 0;
+  static const uint32_t PROPERTY_WRITE    = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY   = 1 << 2;
+  static const uint32_t PROPERTY_INDICATE = 1 << 3;
+  static const uint32_t PROPERTY_WRITE_NR = 1 << 4;
+
+  BLECharacteristic(BLEUUID uuid, uint32_t properties = 0);
+
+  void setValue(uint8_t* data, size_t len) { value.assign((const char*)data, len); }
+  void setValue(const std::string& v) { value = v; }
+  void setValue(const char* v) { value = v; }
+  std::string getValue() { return value; }
+  uint8_t* getData() { return (uint8_t*)value.data(); }
+  size_t getLength() { return value.size(); }
+  void notify(bool isNotification = true);
+  void setCallbacks(BLECharacteristicCallbacks* cb) { callbacks = cb; }
+  void addDescriptor(BLEDescriptor* descriptor) {}
+  BLEDescriptor* getDescriptorByUUID(BLEUUID uuid) { return &cccd; }
+  BLEUUID getUUID() { return uuid; }
+  uint16_t getHandle() { return handle; }
+
+  // Simulation side
+  BLECharacteristicCallbacks* callbacks = nullptr;
+  BLEUUID uuid;
+  uint16_t handle;
+  uint8_t reportId;  // nonzero for HID input and feature reports
+  bool feature = false;
+  std::string value;
+  BLE2902 cccd;
+};
+
+class BLEService {
+ public:
+  BLEService(BLEUUID uuid) : uuid(uuid) {}
+  BLECharacteristic* createCharacteristic(BLEUUID uuid, uint32_t properties);
+  BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties) {
+    return createCharacteristic(BLEUUID(uuid), properties);
+  }
+  void start() {}
+  BLEUUID getUUID() { return uuid; }
+ private:
+  BLEUUID uuid;
+};
+
+class BLEAdvertisementData {
+ public:
+  void setCompleteServices(BLEUUID uuid) {}
+  void setName(const std::string& name) {}
+  void setAppearance(uint16_t appearance) {}
+};
+
+class BLEAdvertising {
+ public:
+  void setAppearance(uint16_t appearance) {}
+  void addServiceUUID(BLEUUID uuid) {}
+  void setAdvertisementData(BLEAdvertisementData& data) {}
+  void start();
+  void stop();
+};
+
+class BLEServer;
+
+class BLEServerCallbacks {
+ public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer* server) {}
+  virtual void onConnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) {}
+  virtual void onDisconnect(BLEServer* server) {}
+};
+
+class BLEServer {
+ public:
+  void setCallbacks(BLEServerCallbacks* cb) { callbacks = cb; }
+  BLEAdvertising* getAdvertising();
+  BLEService* createService(BLEUUID uuid) { return new BLEService(uuid); }
+  BLEService* createService(const char* uuid) { return createService(BLEUUID(uuid)); }
+  uint16_t getConnId() { return 0; }
+  void disconnect(uint16_t connId);
+  void updateConnParams(esp_bd_addr_t remoteBda, uint16_t minInterval, uint16_t maxInterval,
+                        uint16_t latency, uint16_t timeout);
+  uint16_t getPeerMTU(uint16_t connId);
+
+  BLEServerCallbacks* callbacks = nullptr;
+};
+
+class BLEDevice {
+ public:
+  static void init(const std::string& name) {}
+  static void setMTU(uint16_t mtu) {}
+  static void setCustomGapHandler(gap_event_handler handler);
+  static void setCustomGattsHandler(gatts_event_handler handler);
+  static BLEServer* createServer();
+  static BLEAdvertising* getAdvertising();
+  static void startAdvertising();
+};
+
+class BLESecurity {
+ public:
+  void setAuthenticationMode(int mode) {}
+};
+
+#endif // SIM_BLE_DEVICE_H
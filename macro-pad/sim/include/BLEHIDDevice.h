@@ -0,0 +1,25 @@
+#ifndef SIM_BLE_HID_DEVICE_H
+#define SIM_BLE_HID_DEVICE_H
+
+#include <BLEDevice.h>
+
+// Host shim: input report characteristics carry their report ID so the
+// simulation can count notifications per report. Feature reports are
+// found by theirs when the host writes one.
+class BLEHIDDevice {
+ public:
+  BLEHIDDevice(BLEServer* server);
+  void reportMap(uint8_t* map, uint16_t size) {}
+  BLECharacteristic* manufacturer() { return &manufacturerChar; }
+  void pnp(uint8_t sig, uint16_t vid, uint16_t pid, uint16_t version) {}
+  BLECharacteristic* inputReport(uint8_t reportId);
+  BLECharacteristic* featureReport(uint8_t reportId);
+  void startServices() {}
+  BLEService* hidService() { return &service; }
+
+ private:
+  BLEService service;
+  BLECharacteristic manufacturerChar;
+};
+
+#endif // SIM_BLE_HID_DEVICE_H
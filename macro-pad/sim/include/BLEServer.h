@@ -0,0 +1,7 @@
+#ifndef SIM_BLESERVER_H
+#define SIM_BLESERVER_H
+
+// Host shim: all BLE classes live in BLEDevice.h
+#include <BLEDevice.h>
+
+#endif // SIM_BLESERVER_H
@@ -0,0 +1,7 @@
+#ifndef SIM_BLEUTILS_H
+#define SIM_BLEUTILS_H
+
+// Host shim: all BLE classes live in BLEDevice.h
+#include <BLEDevice.h>
+
+#endif // SIM_BLEUTILS_H
@@ -0,0 +1,109 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// --- Host Simulation Control ---
+// Used by the harness in sim/src to drive the firmware with scripted
+// waveforms on a virtual clock.
+
+typedef void (*SimTaskFn)();
+
+// Clear scheduled work, pins, interrupts and BLE state, and restart the clock
+void sim_reset();
+
+uint64_t sim_now_us();
+
+// Advance the virtual clock, running periodic tasks and scheduled pin
+// changes in time order. Calls made from inside a task do nothing.
+void sim_advance(uint64_t us);
+
+// Run fn every periodUs of virtual time (stands in for timers and tasks)
+void sim_every(uint32_t periodUs, SimTaskFn fn);
+
+// Wall-clock nanoseconds spent in periodic tasks and scheduled events
+uint64_t sim_background_ns();
+
+// Pin levels driven from outside (switches, encoder). Changing a level
+// fires an interrupt attached to that pin.
+void sim_set_pin(uint8_t pin, bool level);
+void sim_schedule_pin(uint64_t atUs, uint8_t pin, bool level);
+
+// Key matrix model: a column reads LOW while any row driven LOW has a
+// closed switch on it. Without diodes current also flows backwards through
+// closed switches, so a column reads LOW when any chain of them reaches a
+// row driven LOW, and three corners of a rectangle pull in the fourth.
+void sim_matrix_attach(const uint8_t* rowPins, uint8_t rows, const uint8_t* colPins, uint8_t cols);
+void sim_matrix_diodes(bool present);  // Default true; sim_reset() restores it
+void sim_set_key(uint8_t row, uint8_t col, bool closed);
+void sim_schedule_key(uint64_t atUs, uint8_t row, uint8_t col, bool closed);
+
+// GPIO input register: bit n is the level of pin n, for pins 0-31
+uint32_t sim_gpio_in();
+
+// Serial: echo firmware output to stdout, and queue input for Serial.read()
+void sim_serial_echo(bool enabled);
+void sim_serial_input(const char* text);
+
+// BLE: host connection and the notifications it has seen
+typedef void (*SimNotifyHook)(uint8_t reportId, const uint8_t* data, size_t len);
+void sim_ble_connect();
+void sim_ble_disconnect();
+void sim_ble_set_notify_hook(SimNotifyHook hook);
+
+// Time from connecting to enabling report notifications; 0 (the default)
+// subscribes at once, as a bonded host that remembers its subscriptions
+void sim_ble_set_subscribe_delay(uint32_t ms);
+uint32_t sim_ble_notify_count(uint8_t reportId);
+
+// Stack transmit buffers: up to `buffers` notifications wait for connection
+// events, which send `perEvent` each and confirm them (ESP_GATTS_CONF_EVT).
+// A notification with no free buffer is refused (ERROR_GATT) and counted.
+void sim_ble_set_tx_capacity(uint8_t buffers, uint8_t perEvent);
+uint32_t sim_ble_tx_refused();
+void sim_ble_lose_confirms(bool lose);  // Notifications still go out, unconfirmed
+
+// GATT peer: write to or read from a custom characteristic by UUID, running
+// its callbacks as the BLE task would. The MTU (default 23) sizes reads.
+void sim_ble_set_mtu(uint16_t mtu);
+
+// Connection parameters: the host takes the shortest interval (1.25 ms
+// units) it allows within a requested range, or refuses if it can't
+void sim_ble_set_host_min_interval(uint16_t interval);
+uint16_t sim_ble_conn_interval();
+uint32_t sim_ble_conn_updates();
+bool sim_ble_write(const char* uuid, const uint8_t* data, size_t len);
+size_t sim_ble_read(const char* uuid, uint8_t* out, size_t maxLen);
+
+// HID feature report written by the host, as when it sets up the wheel's
+// Resolution Multiplier
+bool sim_ble_write_feature(uint8_t reportId, const uint8_t* data, size_t len);
+
+// Hosts 0-3, each with its own address, answering the pad's advertising
+// (see Reconnect.h). A present host that is bonded connects to directed
+// advertising aimed at it after directedMs (0: never, as when it uses a
+// private address) and to whitelist or open advertising after undirectedMs.
+// A pairing host connects to open advertising and bonds. sim_ble_connect()
+// is an anonymous host that ignores all this. Bonds on both sides survive
+// sim_reset(), the way NVS survives a reboot.
+void sim_ble_host_add(uint8_t id, uint32_t directedMs, uint32_t undirectedMs);
+void sim_ble_host_pair(uint8_t id);
+void sim_ble_host_leave(uint8_t id);  // Out of range; drops its link
+void sim_ble_erase_bonds();
+int8_t sim_ble_connected_host();      // -1 for none or the anonymous host
+uint8_t sim_ble_adv_mode();           // AdvMode
+
+// Config flash: two RAM slots with NOR semantics (erase to 0xFF, writes
+// only clear bits). Unlike everything else it survives sim_reset(), the
+// way flash survives a reboot. After sim_config_fail_after(n) the next n
+// bytes are written and everything after is lost, as on a power cut;
+// pass -1 to write normally again.
+void sim_config_erase_all();
+uint8_t* sim_config_slot(uint8_t slot);
+void sim_config_fail_after(int32_t bytes);
+
+// Macro recorder slots in NVS; like the config flash they survive sim_reset()
+void sim_recorder_erase_all();
+
+#endif // SIM_H
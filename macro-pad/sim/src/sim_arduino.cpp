@@ -0,0 +1,315 @@
+#include <Arduino.h>
+#include "Sim.h"
+#include <chrono>
+#include <map>
+#include <stdarg.h>
+#include <vector>
+
+SimSerial Serial;
+
+// --- Virtual Clock and Scheduler ---
+
+struct PeriodicTask {
+  uint32_t periodUs;
+  uint64_t nextUs;
+  SimTaskFn fn;
+};
+
+enum PinEventKind { PIN_EVENT_LEVEL, PIN_EVENT_KEY };
+
+struct PinEvent {
+  PinEventKind kind;
+  uint8_t a;      // pin, or row
+  uint8_t b;      // column
+  bool level;     // pin level, or switch closed
+};
+
+static uint64_t nowUs;
+static bool inBackground;
+static uint64_t backgroundNs;
+static std::vector<PeriodicTask> tasks;
+static std::multimap<uint64_t, PinEvent> pinEvents;
+
+// --- Pins, Interrupts and the Key Matrix ---
+
+#define SIM_PINS 64
+
+static uint8_t driven[SIM_PINS];     // level written with digitalWrite
+static uint8_t external[SIM_PINS];   // level applied from outside
+static void (*isrs[SIM_PINS])();
+static int isrModes[SIM_PINS];
+
+static const uint8_t* matrixRows;
+static const uint8_t* matrixCols;
+static uint8_t matrixRowCount;
+static uint8_t matrixColCount;
+static bool keyClosed[16][16];
+static bool matrixDiodes;
+
+static bool serialEcho;
+static std::string serialInput;
+
+void sim_ble_reset();  // sim_ble.cpp
+
+static void applyPinEvent(const PinEvent& e) {
+  if (e.kind == PIN_EVENT_KEY) {
+    sim_set_key(e.a, e.b, e.level);
+  } else {
+    sim_set_pin(e.a, e.level);
+  }
+}
+
+void sim_reset() {
+  nowUs = 0;
+  inBackground = false;
+  backgroundNs = 0;
+  tasks.clear();
+  pinEvents.clear();
+  memset(driven, HIGH, sizeof(driven));
+  memset(external, HIGH, sizeof(external));
+  memset(isrs, 0, sizeof(isrs));
+  matrixRows = matrixCols = nullptr;
+  matrixRowCount = matrixColCount = 0;
+  memset(keyClosed, 0, sizeof(keyClosed));
+  matrixDiodes = true;
+  serialInput.clear();
+  sim_ble_reset();
+}
+
+uint64_t sim_now_us() {
+  return nowUs;
+}
+
+void sim_advance(uint64_t us) {
+  if (inBackground) return;
+  uint64_t target = nowUs + us;
+  inBackground = true;
+  auto start = std::chrono::steady_clock::now();
+
+  for (;;) {
+    // Earliest due periodic task or pin event, whichever comes first
+    PeriodicTask* task = nullptr;
+    for (PeriodicTask& t : tasks) {
+      if (!task || t.nextUs < task->nextUs) task = &t;
+    }
+    uint64_t taskDue = task ? task->nextUs : UINT64_MAX;
+    uint64_t eventDue = pinEvents.empty() ? UINT64_MAX : pinEvents.begin()->first;
+    uint64_t due = taskDue < eventDue ? taskDue : eventDue;
+    if (due > target) break;
+
+    if (due > nowUs) nowUs = due;
+    if (eventDue <= taskDue) {
+      PinEvent e = pinEvents.begin()->second;
+      pinEvents.erase(pinEvents.begin());
+      applyPinEvent(e);
+    } else {
+      task->nextUs += task->periodUs;
+      task->fn();
+    }
+  }
+
+  nowUs = target;
+  backgroundNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  inBackground = false;
+}
+
+void sim_every(uint32_t periodUs, SimTaskFn fn) {
+  tasks.push_back({periodUs, nowUs + periodUs, fn});
+}
+
+uint64_t sim_background_ns() {
+  return backgroundNs;
+}
+
+void sim_set_pin(uint8_t pin, bool level) {
+  if (pin >= SIM_PINS || external[pin] == level) return;
+  external[pin] = level;
+  if (!isrs[pin]) return;
+  if (isrModes[pin] == CHANGE ||
+      (isrModes[pin] == RISING && level) ||
+      (isrModes[pin] == FALLING && !level)) {
+    isrs[pin]();
+  }
+}
+
+void sim_schedule_pin(uint64_t atUs, uint8_t pin, bool level) {
+  pinEvents.insert(std::make_pair(atUs, PinEvent{PIN_EVENT_LEVEL, pin, 0, level}));
+}
+
+void sim_matrix_attach(const uint8_t* rowPins, uint8_t rows, const uint8_t* colPins, uint8_t cols) {
+  matrixRows = rowPins;
+  matrixRowCount = rows;
+  matrixCols = colPins;
+  matrixColCount = cols;
+}
+
+void sim_matrix_diodes(bool present) {
+  matrixDiodes = present;
+}
+
+// Walk closed switches from column c; with diodes only one step is allowed
+static bool columnPulledLow(uint8_t c) {
+  uint32_t rowsSeen = 0;
+  uint32_t colsSeen = 1u << c;
+  uint32_t frontier = colsSeen;
+  while (frontier) {
+    uint32_t rowsFound = 0;
+    for (uint8_t r = 0; r < matrixRowCount; r++) {
+      if (rowsSeen & (1u << r)) continue;
+      for (uint8_t k = 0; k < matrixColCount; k++) {
+        if ((frontier & (1u << k)) && keyClosed[r][k]) {
+          if (driven[matrixRows[r]] == LOW) return true;
+          rowsFound |= 1u << r;
+          break;
+        }
+      }
+    }
+    if (matrixDiodes) return false;
+    rowsSeen |= rowsFound;
+    frontier = 0;
+    for (uint8_t k = 0; k < matrixColCount; k++) {
+      if (colsSeen & (1u << k)) continue;
+      for (uint8_t r = 0; r < matrixRowCount; r++) {
+        if ((rowsFound & (1u << r)) && keyClosed[r][k]) {
+          frontier |= 1u << k;
+          break;
+        }
+      }
+    }
+    colsSeen |= frontier;
+  }
+  return false;
+}
+
+void sim_set_key(uint8_t row, uint8_t col, bool closed) {
+  if (row < 16 && col < 16) keyClosed[row][col] = closed;
+}
+
+void sim_schedule_key(uint64_t atUs, uint8_t row, uint8_t col, bool closed) {
+  pinEvents.insert(std::make_pair(atUs, PinEvent{PIN_EVENT_KEY, row, col, closed}));
+}
+
+void sim_serial_echo(bool enabled) {
+  serialEcho = enabled;
+}
+
+void sim_serial_input(const char* text) {
+  serialInput += text;
+}
+
+// --- Arduino API ---
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < SIM_PINS) driven[pin] = val;
+}
+
+int digitalRead(uint8_t pin) {
+  for (uint8_t c = 0; c < matrixColCount; c++) {
+    if (matrixCols[c] == pin) return columnPulledLow(c) ? LOW : HIGH;  // Else the pull-up
+  }
+  return pin < SIM_PINS ? external[pin] : HIGH;
+}
+
+uint32_t sim_gpio_in() {
+  uint32_t levels = 0;
+  for (uint8_t pin = 0; pin < 32; pin++) {
+    if (external[pin]) levels |= 1u << pin;
+  }
+  for (uint8_t c = 0; c < matrixColCount; c++) {
+    uint8_t pin = matrixCols[c];
+    if (pin >= 32) continue;
+    if (columnPulledLow(c)) {
+      levels &= ~(1u << pin);
+    } else {
+      levels |= 1u << pin;
+    }
+  }
+  return levels;
+}
+
+unsigned long millis() {
+  return nowUs / 1000;
+}
+
+unsigned long micros() {
+  return nowUs;
+}
+
+void delay(uint32_t ms) {
+  sim_advance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  sim_advance(us);
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) {
+  if (pin >= SIM_PINS) return;
+  isrs[pin] = isr;
+  isrModes[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  if (pin < SIM_PINS) isrs[pin] = nullptr;
+}
+
+// --- Serial ---
+
+int SimSerial::available() {
+  return serialInput.size();
+}
+
+int SimSerial::read() {
+  if (serialInput.empty()) return -1;
+  int c = (uint8_t)serialInput[0];
+  serialInput.erase(0, 1);
+  return c;
+}
+
+size_t SimSerial::write(uint8_t c) {
+  if (serialEcho) fputc(c, stdout);
+  return 1;
+}
+
+size_t SimSerial::write(const uint8_t* buffer, size_t size) {
+  if (serialEcho) fwrite(buffer, 1, size, stdout);
+  return size;
+}
+
+size_t SimSerial::print(const char* s) {
+  return write((const uint8_t*)s, strlen(s));
+}
+
+size_t SimSerial::print(char c) {
+  return write((uint8_t)c);
+}
+
+size_t SimSerial::print(long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%ld", n);
+  return print(buffer);
+}
+
+size_t SimSerial::print(unsigned long n, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", n);
+  return print(buffer);
+}
+
+size_t SimSerial::print(double n, int digits) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, n);
+  return print(buffer);
+}
+
+size_t SimSerial::printf(const char* format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  return n > 0 ? print(buffer) : 0;
+}
@@ -0,0 +1,443 @@
+#include <BLEDevice.h>
+#include <BLEHIDDevice.h>
+#include <vector>
+#include "Reconnect.h"
+#include "Sim.h"
+
+#define SIM_MAX_REPORT_ID 16
+#define SIM_DEFAULT_MTU   23
+#define SIM_DEFAULT_HOST_MIN_INTERVAL 6   // 7.5 ms, as Windows and Android allow
+#define SIM_DEFAULT_CONN_INTERVAL     24  // 30 ms, a common host default
+#define SIM_MAX_HOSTS                 RECONNECT_MAX_HOSTS
+#define SIM_HOST_TICK_US              1000
+#define SIM_DEFAULT_TX_BUFFERS        10  // Notifications the stack holds before refusing
+#define SIM_DEFAULT_TX_PER_EVENT      6   // ... and sends per connection event
+
+static BLEServer* server;
+static BLEAdvertising advertising;
+static bool connected;
+static bool advertisingActive;
+static SimNotifyHook notifyHook;
+static uint32_t notifyCount[SIM_MAX_REPORT_ID];
+static uint16_t peerMtu = SIM_DEFAULT_MTU;
+static gap_event_handler gapHandler;
+static uint16_t hostMinInterval = SIM_DEFAULT_HOST_MIN_INTERVAL;
+static uint16_t connInterval = SIM_DEFAULT_CONN_INTERVAL;
+static uint32_t connUpdates;
+static std::vector<BLECharacteristic*> characteristics;
+static gatts_event_handler gattsHandler;
+
+// Stack transmit buffers: notifications wait here, by handle, for the next
+// connection event, which sends up to txPerEvent and confirms each
+static std::vector<uint16_t> txPending;
+static uint8_t txBuffers = SIM_DEFAULT_TX_BUFFERS;
+static uint8_t txPerEvent = SIM_DEFAULT_TX_PER_EVENT;
+static uint32_t txRefused;
+static bool loseConfirms;
+static uint64_t nextConnEventUs;
+static bool subscribed;        // Host has enabled report notifications
+static uint32_t subscribeDelayMs;
+static uint64_t connectedUs;
+
+// Hosts in range. Bonds, and the pad's stored host table, survive
+// sim_reset() the way NVS survives a reboot.
+struct SimHost {
+  bool present;
+  bool bonded;         // The host's side of the bond
+  bool pairing;        // Will connect to open advertising and pair
+  uint32_t directedMs;
+  uint32_t undirectedMs;
+};
+static SimHost hosts[SIM_MAX_HOSTS];
+static BondedHostTable storedHosts;
+static bool storedHostsValid;
+static AdvMode advMode;
+static BondedHost advTarget;
+static uint64_t advStartUs;
+static int8_t connectedHost = -1;
+
+void sim_ble_reset() {
+  server = nullptr;
+  connected = false;
+  advertisingActive = false;
+  notifyHook = nullptr;
+  memset(notifyCount, 0, sizeof(notifyCount));
+  peerMtu = SIM_DEFAULT_MTU;
+  characteristics.clear();
+  gapHandler = nullptr;
+  gattsHandler = nullptr;
+  txPending.clear();
+  txBuffers = SIM_DEFAULT_TX_BUFFERS;
+  txPerEvent = SIM_DEFAULT_TX_PER_EVENT;
+  txRefused = 0;
+  loseConfirms = false;
+  hostMinInterval = SIM_DEFAULT_HOST_MIN_INTERVAL;
+  connInterval = SIM_DEFAULT_CONN_INTERVAL;
+  connUpdates = 0;
+  subscribed = false;
+  subscribeDelayMs = 0;
+  for (SimHost& host : hosts) host.present = host.pairing = false;
+  advMode = ADV_OFF;
+  connectedHost = -1;
+}
+
+void sim_ble_connect() {
+  if (connected || !server) return;
+  connected = true;
+  advertisingActive = false;
+  advMode = ADV_OFF;
+  connInterval = SIM_DEFAULT_CONN_INTERVAL;
+  connectedUs = sim_now_us();
+  nextConnEventUs = connectedUs;
+  subscribed = subscribeDelayMs == 0;
+  if (server->callbacks) {
+    esp_ble_gatts_cb_param_t param = {};
+    server->callbacks->onConnect(server);
+    server->callbacks->onConnect(server, &param);
+  }
+}
+
+void sim_ble_disconnect() {
+  if (!connected) return;
+  connected = false;
+  subscribed = false;
+  connectedHost = -1;
+  txPending.clear();
+  if (server->callbacks) server->callbacks->onDisconnect(server);
+}
+
+void sim_ble_set_subscribe_delay(uint32_t ms) {
+  subscribeDelayMs = ms;
+}
+
+bool BLE2902::getNotifications() {
+  return subscribed;
+}
+
+void sim_ble_set_notify_hook(SimNotifyHook hook) {
+  notifyHook = hook;
+}
+
+uint32_t sim_ble_notify_count(uint8_t reportId) {
+  return reportId < SIM_MAX_REPORT_ID ? notifyCount[reportId] : 0;
+}
+
+void sim_ble_set_mtu(uint16_t mtu) {
+  peerMtu = mtu;
+}
+
+static BLECharacteristic* findCharacteristic(const char* uuid) {
+  for (BLECharacteristic* c : characteristics) {
+    if (c->uuid.toString() == uuid) return c;
+  }
+  return nullptr;
+}
+
+bool sim_ble_write(const char* uuid, const uint8_t* data, size_t len) {
+  BLECharacteristic* c = findCharacteristic(uuid);
+  if (!connected || !c) return false;
+  c->value.assign((const char*)data, len);
+  if (c->callbacks) c->callbacks->onWrite(c);
+  return true;
+}
+
+void sim_ble_set_tx_capacity(uint8_t buffers, uint8_t perEvent) {
+  txBuffers = buffers;
+  txPerEvent = perEvent;
+}
+
+void sim_ble_lose_confirms(bool lose) {
+  loseConfirms = lose;
+}
+
+uint32_t sim_ble_tx_refused() {
+  return txRefused;
+}
+
+bool sim_ble_write_feature(uint8_t reportId, const uint8_t* data, size_t len) {
+  if (!connected) return false;
+  for (BLECharacteristic* c : characteristics) {
+    if (!c->feature || c->reportId != reportId) continue;
+    c->value.assign((const char*)data, len);
+    if (c->callbacks) c->callbacks->onWrite(c);
+    return true;
+  }
+  return false;
+}
+
+size_t sim_ble_read(const char* uuid, uint8_t* out, size_t maxLen) {
+  BLECharacteristic* c = findCharacteristic(uuid);
+  if (!connected || !c) return 0;
+  if (c->callbacks) c->callbacks->onRead(c);
+  size_t len = c->value.size() < maxLen ? c->value.size() : maxLen;
+  memcpy(out, c->value.data(), len);
+  return len;
+}
+
+void sim_ble_set_host_min_interval(uint16_t interval) {
+  hostMinInterval = interval;
+}
+
+uint16_t sim_ble_conn_interval() {
+  return connInterval;
+}
+
+uint32_t sim_ble_conn_updates() {
+  return connUpdates;
+}
+
+// --- Host Model ---
+
+static void hostAddress(uint8_t id, uint8_t* addr) {
+  const uint8_t base[6] = {0xC0, 0x11, 0x22, 0x33, 0x44, 0x00};
+  memcpy(addr, base, 6);
+  addr[5] = id + 1;
+}
+
+static bool padKnowsHost(const uint8_t* addr) {
+  if (!storedHostsValid) return false;
+  for (const BondedHost& host : storedHosts.hosts) {
+    if (host.valid && memcmp(host.addr, addr, 6) == 0) return true;
+  }
+  return false;
+}
+
+// Connect, then encrypt: a new bond when pairing, else the stored one if
+// the pad still has it
+static void hostConnect(uint8_t id) {
+  connected = true;
+  advMode = ADV_OFF;
+  connectedHost = id;
+  connInterval = SIM_DEFAULT_CONN_INTERVAL;
+  connectedUs = sim_now_us();
+  nextConnEventUs = connectedUs;
+  subscribed = subscribeDelayMs == 0;
+  esp_ble_gatts_cb_param_t param = {};
+  hostAddress(id, param.connect.remote_bda);
+  if (server->callbacks) {
+    server->callbacks->onConnect(server);
+    server->callbacks->onConnect(server, &param);
+  }
+
+  SimHost& host = hosts[id];
+  esp_ble_gap_cb_param_t auth = {};
+  memcpy(auth.ble_security.auth_cmpl.bd_addr, param.connect.remote_bda, 6);
+  auth.ble_security.auth_cmpl.success = host.pairing || padKnowsHost(param.connect.remote_bda);
+  host.bonded = auth.ble_security.auth_cmpl.success;
+  host.pairing = false;
+  if (gapHandler) gapHandler(ESP_GAP_BLE_AUTH_CMPL_EVT, &auth);
+}
+
+// One connection event: the oldest buffered notifications go out, and the
+// stack confirms each
+static void connectionEvent() {
+  size_t n = txPending.size() < txPerEvent ? txPending.size() : txPerEvent;
+  std::vector<uint16_t> sent(txPending.begin(), txPending.begin() + n);
+  txPending.erase(txPending.begin(), txPending.begin() + n);
+  for (uint16_t handle : sent) {
+    esp_ble_gatts_cb_param_t param = {};
+    param.conf.status = ESP_BT_STATUS_SUCCESS;
+    param.conf.handle = handle;
+    if (gattsHandler && !loseConfirms) gattsHandler(ESP_GATTS_CONF_EVT, 0, &param);
+  }
+}
+
+// A connected host subscribes after the delay. Directed advertising reaches
+// only its target, whitelist advertising only lets its target in, and open
+// advertising lets in any host that wants it.
+static void hostTick() {
+  if (connected && !subscribed && sim_now_us() - connectedUs >= subscribeDelayMs * 1000ULL) subscribed = true;
+  if (connected && sim_now_us() >= nextConnEventUs) {
+    nextConnEventUs = sim_now_us() + connInterval * 1250ULL;
+    connectionEvent();
+  }
+  if (connected || advMode == ADV_OFF) return;
+  uint64_t waitedUs = sim_now_us() - advStartUs;
+  for (uint8_t id = 0; id < SIM_MAX_HOSTS; id++) {
+    const SimHost& host = hosts[id];
+    if (!host.present) continue;
+    uint8_t addr[6];
+    hostAddress(id, addr);
+    bool targeted = memcmp(advTarget.addr, addr, 6) == 0;
+
+    uint32_t delayMs;
+    if (advMode == ADV_DIRECTED) {
+      if (!host.bonded || !targeted || !host.directedMs) continue;
+      delayMs = host.directedMs;
+    } else if (advMode == ADV_WHITELIST) {
+      if (!host.bonded || !targeted) continue;
+      delayMs = host.undirectedMs;
+    } else {
+      if (!host.bonded && !host.pairing) continue;
+      delayMs = host.undirectedMs;
+    }
+    if (waitedUs >= delayMs * 1000ULL) return hostConnect(id);
+  }
+}
+
+void sim_ble_host_add(uint8_t id, uint32_t directedMs, uint32_t undirectedMs) {
+  if (id >= SIM_MAX_HOSTS) return;
+  hosts[id].present = true;
+  hosts[id].directedMs = directedMs;
+  hosts[id].undirectedMs = undirectedMs;
+}
+
+void sim_ble_host_pair(uint8_t id) {
+  if (id < SIM_MAX_HOSTS) hosts[id].pairing = true;
+}
+
+void sim_ble_host_leave(uint8_t id) {
+  if (id >= SIM_MAX_HOSTS) return;
+  hosts[id].present = false;
+  if (connectedHost == id) sim_ble_disconnect();
+}
+
+void sim_ble_erase_bonds() {
+  memset(hosts, 0, sizeof(hosts));
+  storedHostsValid = false;
+}
+
+int8_t sim_ble_connected_host() {
+  return connectedHost;
+}
+
+uint8_t sim_ble_adv_mode() {
+  return advMode;
+}
+
+static void simAdvertise(AdvMode mode, const BondedHost* target) {
+  advMode = mode;
+  advStartUs = sim_now_us();
+  if (target) {
+    advTarget = *target;
+  } else {
+    memset(&advTarget, 0, sizeof(advTarget));
+  }
+}
+
+static void simSave(const BondedHostTable* table) {
+  storedHosts = *table;
+  storedHostsValid = true;
+}
+
+static const ReconnectIo simReconnect = {
+  simAdvertise,
+  sim_ble_disconnect,
+  simSave,
+};
+
+void reconnect_begin(BLEServer* bleServer, uint32_t nowMs) {
+  reconnect_init(&simReconnect, storedHostsValid ? &storedHosts : nullptr, nowMs);
+}
+
+void BLEServer::disconnect(uint16_t connId) {
+  sim_ble_disconnect();
+}
+
+void BLEDevice::setCustomGapHandler(gap_event_handler handler) {
+  gapHandler = handler;
+}
+
+void BLEDevice::setCustomGattsHandler(gatts_event_handler handler) {
+  gattsHandler = handler;
+}
+
+// The host takes the shortest interval it allows within the requested
+// range and answers at once; it refuses a range entirely below its minimum
+void BLEServer::updateConnParams(esp_bd_addr_t remoteBda, uint16_t minInterval, uint16_t maxInterval,
+                                 uint16_t latency, uint16_t timeout) {
+  if (!connected) return;
+  esp_ble_gap_cb_param_t param = {};
+  param.update_conn_params.min_int = minInterval;
+  param.update_conn_params.max_int = maxInterval;
+  uint16_t interval = minInterval > hostMinInterval ? minInterval : hostMinInterval;
+  if (interval > maxInterval) {
+    param.update_conn_params.status = ESP_BT_STATUS_FAIL;
+    param.update_conn_params.conn_int = connInterval;
+  } else {
+    param.update_conn_params.status = ESP_BT_STATUS_SUCCESS;
+    param.update_conn_params.conn_int = connInterval = interval;
+    param.update_conn_params.latency = latency;
+    param.update_conn_params.timeout = timeout;
+    connUpdates++;
+  }
+  if (gapHandler) gapHandler(ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT, &param);
+}
+
+uint16_t BLEServer::getPeerMTU(uint16_t connId) {
+  return peerMtu;
+}
+
+BLECharacteristic::BLECharacteristic(BLEUUID uuid, uint32_t properties) : uuid(uuid), reportId(0) {
+  static uint16_t nextHandle = 1;
+  handle = nextHandle++;
+}
+
+// The outcome goes to onStatus() before this returns, as on the ESP32. The
+// host hook sees a notification as soon as the stack has taken it.
+void BLECharacteristic::notify(bool isNotification) {
+  BLECharacteristicCallbacks::Status status = BLECharacteristicCallbacks::SUCCESS_NOTIFY;
+  if (!connected) {
+    status = BLECharacteristicCallbacks::ERROR_NO_CLIENT;
+  } else if (!subscribed) {
+    status = BLECharacteristicCallbacks::ERROR_NOTIFY_DISABLED;
+  } else if (txPending.size() >= txBuffers) {
+    status = BLECharacteristicCallbacks::ERROR_GATT;
+    txRefused++;
+  } else {
+    txPending.push_back(handle);
+    if (reportId < SIM_MAX_REPORT_ID) notifyCount[reportId]++;
+    if (notifyHook) notifyHook(reportId, (const uint8_t*)value.data(), value.size());
+  }
+  if (callbacks) callbacks->onStatus(this, status, 0);
+}
+
+BLECharacteristic* BLEService::createCharacteristic(BLEUUID uuid, uint32_t properties) {
+  BLECharacteristic* characteristic = new BLECharacteristic(uuid, properties);
+  characteristics.push_back(characteristic);
+  return characteristic;
+}
+
+void BLEAdvertising::start() {
+  advertisingActive = true;
+}
+
+void BLEAdvertising::stop() {
+  advertisingActive = false;
+}
+
+BLEAdvertising* BLEServer::getAdvertising() {
+  return &advertising;
+}
+
+BLEServer* BLEDevice::createServer() {
+  server = new BLEServer();
+  sim_every(SIM_HOST_TICK_US, hostTick);
+  return server;
+}
+
+BLEAdvertising* BLEDevice::getAdvertising() {
+  return &advertising;
+}
+
+void BLEDevice::startAdvertising() {
+  advertising.start();
+}
+
+BLEHIDDevice::BLEHIDDevice(BLEServer* server)
+    : service(BLEUUID((uint16_t)0x1812)), manufacturerChar(BLEUUID((uint16_t)0x2A29)) {}
+
+BLECharacteristic* BLEHIDDevice::inputReport(uint8_t reportId) {
+  BLECharacteristic* characteristic = new BLECharacteristic(BLEUUID((uint16_t)0x2A4D), BLECharacteristic::PROPERTY_NOTIFY);
+  characteristic->reportId = reportId;
+  return characteristic;
+}
+
+BLECharacteristic* BLEHIDDevice::featureReport(uint8_t reportId) {
+  BLECharacteristic* characteristic = new BLECharacteristic(BLEUUID((uint16_t)0x2A4D),
+      BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE);
+  characteristic->reportId = reportId;
+  characteristic->feature = true;
+  characteristics.push_back(characteristic);
+  return characteristic;
+}
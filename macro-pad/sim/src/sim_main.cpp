@@ -0,0 +1,1689 @@
+// Host simulation harness: boots the firmware from src/main.cpp on the
+// virtual clock, drives it with scripted switch and encoder waveforms and
+// reports throughput, per-loop cost and report counts.
+//
+//   pio run -e native && .pio/build/native/program [--trace bounce.txt] [--echo]
+//
+// A bounce trace is one "<time_us> <0|1>" transition per line ('#' starts a
+// comment), replayed on a single key. Exits non-zero when a check fails.
+
+#include <Arduino.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <stdlib.h>
+#include <vector>
+#include "Sim.h"
+#include "BLE_Config.h"
+#include "BLE_Diag.h"
+#include "BLE_HID.h"
+#include "Boot.h"
+#include "Config.h"
+#include "Config_Transfer.h"
+#include "Conn_Params.h"
+#include "Debounce.h"
+#include "HID_Report.h"
+#include "HID_Transport.h"
+#include "HID_Usages.h"
+#include "Input_Bus.h"
+#include "Key_Resolve.h"
+#include "Keypad.h"
+#include "Latency.h"
+#include "MacroPad.h"
+#include "Macro_Recorder.h"
+#include "Power.h"
+#include "Quadrature.h"
+#include "Reconnect.h"
+#include "Rotary_Encoder.h"
+
+// src/main.cpp
+void setup();
+void loop();
+
+static int failures;
+
+static void check(bool ok, const char* what) {
+  printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+  if (!ok) failures++;
+}
+
+// --- Deterministic waveforms ---
+
+static uint32_t rngState;
+
+static uint32_t rng() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static uint32_t rngRange(uint32_t lo, uint32_t hi) {
+  return lo + rng() % (hi - lo + 1);
+}
+
+// Schedule a switch edge at atUs followed by `bounces` chatter pulses.
+// The contact always ends in the requested state.
+static void scheduleBouncyEdge(uint64_t atUs, uint8_t row, uint8_t col, bool closed, uint8_t bounces) {
+  sim_schedule_key(atUs, row, col, closed);
+  uint64_t t = atUs;
+  for (uint8_t i = 0; i < bounces; i++) {
+    t += rngRange(30, 400);
+    sim_schedule_key(t, row, col, !closed);
+    t += rngRange(30, 400);
+    sim_schedule_key(t, row, col, closed);
+  }
+}
+
+// --- Host model: what a connected computer sees ---
+
+static uint32_t hostKeyPresses;
+static uint32_t hostMediaPresses;
+static uint16_t hostMediaHeld;   // usage of the last media report, 0 when released
+static int32_t hostWheel;        // wheel units received, up and right positive
+static int32_t hostPan;
+static uint32_t hostWheelReports;
+static bool hostWheelFraction;   // some report moved by part of a detent
+static uint8_t hostKeys[6];
+static std::string hostText;   // characters typed, decoded with the US layout
+static uint64_t hostFirstUs[256];  // first time each usage was seen pressed
+
+static char usageToChar(uint8_t usage, bool shift) {
+  for (int c = 0; c < 128; c++) {
+    if (hid_ascii_usage(c) == usage && hid_ascii_shift(c) == shift) return c;
+  }
+  return '?';
+}
+
+static void onNotify(uint8_t reportId, const uint8_t* data, size_t len) {
+  if (reportId == HID_REPORT_ID_KEYBOARD && len >= 8) {
+    for (uint8_t i = 2; i < 8; i++) {
+      if (data[i] == 0 || data[i] == 0x01) continue;
+      if (memchr(hostKeys, data[i], sizeof(hostKeys))) continue;
+      hostKeyPresses++;
+      hostText += usageToChar(data[i], data[0] & (HID_MOD_LEFT_SHIFT | HID_MOD_RIGHT_SHIFT));
+      if (!hostFirstUs[data[i]]) hostFirstUs[data[i]] = sim_now_us();
+    }
+    memcpy(hostKeys, &data[2], sizeof(hostKeys));
+  } else if (reportId == HID_REPORT_ID_MEDIA && len >= 2) {
+    uint16_t usage = data[0] | data[1] << 8;
+    if (usage && usage != hostMediaHeld) hostMediaPresses++;
+    hostMediaHeld = usage;
+  } else if (reportId == HID_REPORT_ID_MOUSE && len >= 7) {
+    int16_t wheel = (int16_t)(data[3] | data[4] << 8);
+    int16_t pan = (int16_t)(data[5] | data[6] << 8);
+    hostWheel += wheel;
+    hostPan += pan;
+    hostWheelReports++;
+    if (wheel % HID_WHEEL_RESOLUTION || pan % HID_WHEEL_RESOLUTION) hostWheelFraction = true;
+  }
+}
+
+static bool hostKeysReleased() {
+  for (uint8_t i = 0; i < sizeof(hostKeys); i++) {
+    if (hostKeys[i]) return false;
+  }
+  return true;
+}
+
+// --- Firmware under test ---
+
+struct LoopCost {
+  uint64_t loops;
+  uint64_t totalNs;
+  uint64_t maxNs;
+  uint64_t wallNs;  // loop() plus background work
+};
+
+static void bootFirmware() {
+  sim_reset();
+  setup();
+  sim_ble_connect();
+  sim_ble_set_notify_hook(onNotify);
+  hostKeyPresses = 0;
+  hostMediaPresses = 0;
+  hostMediaHeld = 0;
+  hostWheel = 0;
+  hostPan = 0;
+  hostWheelReports = 0;
+  hostWheelFraction = false;
+  memset(hostKeys, 0, sizeof(hostKeys));
+  hostText.clear();
+  memset(hostFirstUs, 0, sizeof(hostFirstUs));
+  latency_reset();
+}
+
+// Call loop() until durationUs of virtual time has passed. Time spent in
+// background work (scans, transport, log drain) is not charged to loop().
+static void runLoops(uint64_t durationUs, LoopCost* cost) {
+  uint64_t end = sim_now_us() + durationUs;
+  auto wallStart = std::chrono::steady_clock::now();
+  while (sim_now_us() < end) {
+    uint64_t background = sim_background_ns();
+    auto start = std::chrono::steady_clock::now();
+    loop();
+    uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    ns -= sim_background_ns() - background;
+    cost->loops++;
+    cost->totalNs += ns;
+    if (ns > cost->maxNs) cost->maxNs = ns;
+  }
+  cost->wallNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - wallStart).count();
+}
+
+static void printCost(const LoopCost& cost, uint32_t events) {
+  printf("  loops %llu, loop() mean %.0f ns, max %llu ns\n",
+         (unsigned long long)cost.loops, (double)cost.totalNs / cost.loops,
+         (unsigned long long)cost.maxNs);
+  printf("  %u input events in %.1f ms wall: %.0f events/s\n",
+         events, cost.wallNs / 1e6, events / (cost.wallNs / 1e9));
+}
+
+static void printReports() {
+  HidTransportStats tx;
+  hid_transport_get_stats(&tx);
+  printf("  notifies: keyboard %u, media %u; saved %u (suppressed %u); dropped %u\n",
+         sim_ble_notify_count(HID_REPORT_ID_KEYBOARD), sim_ble_notify_count(HID_REPORT_ID_MEDIA),
+         ble_notifies_saved(), tx.suppressed, tx.dropped);
+}
+
+static void printLatency() {
+  static char text[640];
+  latency_format(text, sizeof(text));
+  printf("%s", text);
+}
+
+// --- Scenarios ---
+
+// Base-layer character keys of the default keymap in src/main.cpp
+static const uint8_t typingKeys[][2] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
+static const uint8_t typingKeyCount = sizeof(typingKeys) / sizeof(typingKeys[0]);
+
+static void benchTyping() {
+  printf("\n== Typing: rolling presses with contact bounce ==\n");
+
+  // NKRO builds: usages past the bitmap go out in the boot report instead
+  uint8_t nkro[HID_NKRO_REPORT_LEN];
+  uint8_t rest[HID_BOOT_REPORT_LEN];
+  hid_report_reset();
+  hid_report_press(HID_KEY_A);
+  hid_report_press(HID_KEY_COPY);
+  hid_report_press(HID_KEY_LEFT_SHIFT);
+  hid_report_build_nkro(nkro);
+  hid_report_build_nkro_rest(rest);
+  check(nkro[0] == HID_MOD_LEFT_SHIFT && (nkro[1 + HID_KEY_A / 8] >> (HID_KEY_A & 7) & 1) &&
+        rest[0] == 0 && rest[2] == HID_KEY_COPY && rest[3] == 0, "NKRO: usages past the bitmap still sent");
+  hid_report_reset();
+
+  bootFirmware();
+  rngState = 0x1234567;
+
+  const uint32_t presses = 400;
+  uint64_t t = sim_now_us() + 10000;
+  for (uint32_t i = 0; i < presses; i++) {
+    const uint8_t* key = typingKeys[i % typingKeyCount];
+    scheduleBouncyEdge(t, key[0], key[1], true, rngRange(0, 6));
+    scheduleBouncyEdge(t + 40000, key[0], key[1], false, rngRange(0, 6));
+    t += 25000;  // Next key goes down while this one is still held
+  }
+
+  LoopCost cost = {};
+  runLoops(t + 100000 - sim_now_us(), &cost);
+
+  printCost(cost, presses * 2);
+  printReports();
+  printLatency();
+  check(hostKeyPresses == presses, "every press reached the host");
+  check(hostKeysReleased(), "no key left stuck on the host");
+}
+
+static bool hostHolds(uint8_t usage) {
+  return memchr(hostKeys, usage, sizeof(hostKeys)) != nullptr;
+}
+
+// The default keymap holds layer 1 on key (1,2); (1,0) is 'd' on layer 0
+// and 'f' on layer 1
+static void benchLayers() {
+  printf("\n== Layers: momentary hold and release order ==\n");
+  bootFirmware();
+  LoopCost cost = {};
+  uint64_t t = sim_now_us() + 10000;
+
+  sim_schedule_key(t, 1, 2, true);            // hold layer 1
+  sim_schedule_key(t + 20000, 1, 0, true);    // 'f'
+  sim_schedule_key(t + 40000, 1, 2, false);   // drop layer 1 while 'f' is held
+  runLoops(60000, &cost);
+  check(hostHolds(HID_KEY_F) && !hostHolds(HID_KEY_D), "layer 1 key resolves to its layer action");
+
+  sim_schedule_key(sim_now_us() + 1000, 1, 0, false);
+  runLoops(20000, &cost);
+  check(hostKeysReleased(), "release runs the action resolved at press");
+
+  sim_schedule_key(sim_now_us() + 1000, 1, 0, true);
+  runLoops(20000, &cost);
+  check(hostHolds(HID_KEY_D), "base layer is back after the hold");
+  sim_schedule_key(sim_now_us() + 1000, 1, 0, false);
+  runLoops(20000, &cost);
+}
+
+static void spinEncoder(uint64_t startUs, int32_t detents, uint32_t detentsPerSec) {
+  // Forward is B, A, B, A... toggles from the 11 rest position
+  bool levelA = HIGH;
+  bool levelB = HIGH;
+  uint32_t stepUs = 1000000 / (detentsPerSec * QUADRATURE_STEPS_PER_DETENT);
+  uint32_t steps = (detents < 0 ? -detents : detents) * QUADRATURE_STEPS_PER_DETENT;
+  bool toggleB = detents > 0;
+
+  uint64_t t = startUs;
+  for (uint32_t i = 0; i < steps; i++) {
+    t += stepUs * rngRange(80, 120) / 100;  // +-20% jitter
+    if (toggleB) {
+      levelB = !levelB;
+      sim_schedule_pin(t, ROT_B, levelB);
+    } else {
+      levelA = !levelA;
+      sim_schedule_pin(t, ROT_A, levelA);
+    }
+    toggleB = !toggleB;
+  }
+}
+
+static void benchEncoder() {
+  printf("\n== Encoder: quadrature spins ==\n");
+  static const uint32_t speeds[] = {50, 200, 1000};
+
+  for (uint32_t speed : speeds) {
+    bootFirmware();
+    rngState = 0xBEEF + speed;
+
+    const int32_t detents = 120;
+    uint64_t start = sim_now_us() + 1000;
+    int32_t before = quadrature_position();
+    spinEncoder(start, detents, speed);
+    uint64_t spinUs = (uint64_t)detents * 1200000 / speed;
+
+    LoopCost cost = {};
+    runLoops(spinUs + 200000, &cost);
+    int32_t decoded = (quadrature_position() - before) / QUADRATURE_STEPS_PER_DETENT;
+
+    printf(" %u detents/s:\n", speed);
+    printCost(cost, detents);
+    printf("  decoded %d of %d detents, host saw %u media taps\n", decoded, detents, hostMediaPresses);
+    printReports();
+    check(decoded == detents, "no encoder steps lost");
+  }
+
+  // A slow turn drained late, after a stalled loop, is still a slow turn
+  bootFirmware();
+  rngState = 0x510;
+  spinEncoder(sim_now_us() + 1000, 6, 10);
+  sim_advance(800000);  // Nothing consumes the bus meanwhile
+  LoopCost cost = {};
+  runLoops(500000, &cost);
+  printf("  6 slow detents drained in one pass: host saw %u media taps\n", hostMediaPresses);
+  check(hostMediaPresses == 6, "acceleration goes by detent time");
+}
+
+static void benchWheel() {
+  printf("\n== Encoder: hi-res wheel ==\n");
+  const int32_t detents = -60;  // Counter-clockwise scrolls up
+  const uint32_t speed = 25;  // On the acceleration ramp, so detents get fractions
+  const uint8_t hiresFeature = 0x05;  // Multiplier on for wheel and pan
+  int32_t totals[2] = {};
+
+  for (int hires = 0; hires < 2; hires++) {
+    bootFirmware();
+    rngState = 0x5C01;
+    if (hires) sim_ble_write_feature(HID_REPORT_ID_MOUSE, &hiresFeature, 1);
+    encoder_set_mode(ENCODER_MODE_SCROLL);
+    spinEncoder(sim_now_us() + 1000, detents, speed);
+    uint64_t spinUs = (uint64_t)-detents * 1200000 / speed;
+
+    LoopCost cost = {};
+    runLoops(spinUs + 200000, &cost);
+    uint32_t batches = spinUs / 1000 / ENCODER_BATCH_MS + 2;
+    totals[hires] = hostWheel;
+
+    printf(" %s, %u detents/s:\n", hires ? "multiplier on" : "multiplier off", speed);
+    printf("  %u wheel reports for %d detents, wheel %d units\n",
+           hostWheelReports, -detents, hostWheel);
+    check(hostKeyPresses == 0 && hostMediaPresses == 0, "no key taps for scrolling");
+    check(hostWheelReports > 0 && hostWheelReports <= batches, "one wheel report per batch at most");
+    check(hostPan == 0, "scroll mode leaves pan alone");
+    if (hires) {
+      check(hostWheelFraction, "hi-res reports carry fractions");
+      check(hostWheel > -detents * HID_WHEEL_RESOLUTION, "spin accelerates");
+    }
+  }
+  int32_t expected = totals[1] / HID_WHEEL_RESOLUTION;
+  check(totals[0] >= expected - 1 && totals[0] <= expected, "both resolutions scroll as far");
+
+  // A fast spin goes out as one report per batch window, not one per detent
+  bootFirmware();
+  sim_ble_write_feature(HID_REPORT_ID_MOUSE, &hiresFeature, 1);
+  encoder_set_mode(ENCODER_MODE_SCROLL);
+  spinEncoder(sim_now_us() + 1000, 120, 1000);
+  LoopCost cost = {};
+  runLoops(400000, &cost);
+  printf(" multiplier on, 1000 detents/s:\n");
+  printf("  %u wheel reports for 120 detents, wheel %d units\n", hostWheelReports, hostWheel);
+  check(hostWheelReports <= 144 / ENCODER_BATCH_MS + 2, "fast spin: one report per batch");
+  check(hostWheel <= -120 * 3 * HID_WHEEL_RESOLUTION, "fast spin: accelerated past 3x");
+
+  bootFirmware();
+  sim_ble_write_feature(HID_REPORT_ID_MOUSE, &hiresFeature, 1);
+  encoder_set_mode(ENCODER_MODE_PAN);
+  spinEncoder(sim_now_us() + 1000, 10, 5);
+  runLoops(2600000, &cost);
+  check(hostPan == 10 * HID_WHEEL_RESOLUTION && hostWheel == 0, "slow pan: one detent per detent");
+
+  sim_ble_disconnect();
+  sim_ble_connect();
+  check(!ble_wheel_hires(), "multiplier resets with the connection");
+}
+
+static InputEvent busEvent(InputSource source, uint32_t timestamp) {
+  InputEvent event = {};
+  event.type = source == INPUT_SOURCE_ENCODER ? INPUT_ROTATION : INPUT_KEY;
+  event.source = source;
+  event.value = 1;
+  event.timestamp = timestamp;
+  return event;
+}
+
+static void benchInputBus() {
+  printf("\n== Input bus: per-source rings merged in time order ==\n");
+
+  // Core: sources interleave by timestamp, across a micros() wrap too
+  input_init();
+  const uint32_t base = 0xFFFFFFF0;
+  const uint32_t keypadTimes[] = {0, 20, 40};
+  const uint32_t encoderTimes[] = {10, 30};
+  for (uint32_t t : keypadTimes) {
+    InputEvent event = busEvent(INPUT_SOURCE_KEYPAD, base + t);
+    input_push(&event);
+  }
+  for (uint32_t t : encoderTimes) {
+    InputEvent event = busEvent(INPUT_SOURCE_ENCODER, base + t);
+    input_push(&event);
+  }
+  InputEvent event;
+  bool ordered = true;
+  uint32_t expected = 0;
+  while (input_read(&event)) {
+    ordered &= event.timestamp == base + expected;
+    expected += 10;
+  }
+  check(ordered && expected == 50, "events come out oldest first");
+
+  input_init();
+  for (uint32_t i = 0; i < INPUT_RING_LEN + 8; i++) {
+    InputEvent key = busEvent(INPUT_SOURCE_KEYPAD, i);
+    input_push(&key);
+  }
+  InputBusStats stats;
+  input_get_stats(INPUT_SOURCE_KEYPAD, &stats);
+  check(stats.pushed == INPUT_RING_LEN - 1 && stats.refused == 9 && stats.highWater == INPUT_RING_LEN - 1,
+        "a full ring counts refusals and high water");
+
+  // Firmware with the consumer stalled: a full ring delays edges and
+  // detents but never leaves the consumer out of step
+  bootFirmware();
+  rngState = 0x0F11;
+  uint64_t stallUs = sim_now_us() + 5000;
+  for (uint32_t i = 0; i < INPUT_RING_LEN; i++) {
+    sim_schedule_key(stallUs + i * 30000, 0, 0, true);
+    sim_schedule_key(stallUs + i * 30000 + 15000, 0, 0, false);
+  }
+  spinEncoder(stallUs, INPUT_RING_LEN + 8, 40);
+  sim_advance(INPUT_RING_LEN * 30000 + 100000);
+  int32_t keyDown = 0, detents = 0;
+  bool inStep = true;
+  for (int pass = 0; pass < 2; pass++) {
+    while (input_read(&event)) {
+      if (event.type == INPUT_ROTATION) {
+        detents += event.value;
+      } else {
+        keyDown += event.value ? 1 : -1;
+        inStep &= keyDown == 0 || keyDown == 1;
+      }
+    }
+    if (pass == 0) {
+      spinEncoder(sim_now_us(), 1, 40);  // The next edge carries the detents held back
+      sim_advance(100000);
+    }
+  }
+  check(inStep && keyDown == 0 && detents == INPUT_RING_LEN + 9, "a full ring delays edges, never loses them");
+
+  // An edge held back goes out before any newer one, whatever its row
+  bootFirmware();
+  stallUs = sim_now_us() + 5000;
+  for (uint32_t i = 0; i < INPUT_RING_LEN / 2; i++) {
+    sim_schedule_key(stallUs + i * 30000, 1, 0, true);
+    sim_schedule_key(stallUs + i * 30000 + 15000, 1, 0, false);
+  }
+  sim_advance(INPUT_RING_LEN / 2 * 30000 + 20000);  // The last release is turned away
+  input_read(&event);
+  sim_schedule_key(sim_now_us() + 1000, 0, 0, true);
+  sim_schedule_key(sim_now_us() + 20000, 0, 0, false);
+  sim_advance(50000);
+  std::string order;
+  for (int pass = 0; pass < 2; pass++) {
+    while (input_read(&event)) {
+      if (event.type == INPUT_KEY) order += (char)('0' + event.row) + std::string(event.value ? "P" : "R");
+    }
+    sim_advance(50000);
+  }
+  check(order.size() >= 6 && order.substr(order.size() - 6) == "1R0P0R", "held edges keep their order across rows");
+
+  // Firmware: typing and a fast spin at once; each source keeps its own ring
+  bootFirmware();
+  rngState = 0x5150;
+  const uint32_t presses = 100;
+  uint64_t t = sim_now_us() + 10000;
+  for (uint32_t i = 0; i < presses; i++) {
+    const uint8_t* key = typingKeys[i % typingKeyCount];
+    scheduleBouncyEdge(t + i * 25000, key[0], key[1], true, rngRange(0, 6));
+    scheduleBouncyEdge(t + i * 25000 + 40000, key[0], key[1], false, rngRange(0, 6));
+  }
+  spinEncoder(t, 1000, 400);
+  LoopCost cost = {};
+  runLoops(presses * 25000 + 200000, &cost);
+
+  char text[160];
+  input_format(text, sizeof(text));
+  printf("%s", text);
+  InputBusStats keypad, encoder;
+  input_get_stats(INPUT_SOURCE_KEYPAD, &keypad);
+  input_get_stats(INPUT_SOURCE_ENCODER, &encoder);
+  check(keypad.pushed == presses * 2 && keypad.refused == 0 && encoder.refused == 0,
+        "keys and detents share the bus without loss");
+  check(hostKeyPresses == presses && hostKeysReleased(), "every key still reaches the host");
+}
+
+// --- Debounce trace replay ---
+
+struct Transition {
+  uint64_t us;
+  bool closed;
+};
+
+struct TraceStats {
+  uint32_t presses;        // physical presses in the trace
+  uint32_t accepted;       // press events the scanner reported
+  uint32_t measured;       // presses matched with their first event
+  uint64_t addedUsTotal;
+  uint64_t addedUsMax;
+};
+
+// Level of the traced contact at a given time (open before the first transition)
+static bool closedAt(const std::vector<Transition>& trace, uint64_t us) {
+  bool closed = false;
+  for (const Transition& tr : trace) {
+    if (tr.us > us) break;
+    closed = tr.closed;
+  }
+  return closed;
+}
+
+// Replay transitions on key (1,0) and match each physical press with the
+// press event it produced. A physical press is the first closing after a long
+// open period that is still closed once the debounce time has passed, so
+// noise spikes count as false triggers rather than presses.
+static void replayTrace(const std::vector<Transition>& trace, TraceStats* stats) {
+  bootFirmware();
+  const uint8_t row = 1, col = 0;
+  const uint64_t base = sim_now_us() + 1000;
+  std::vector<uint64_t> pressTimes;
+
+  bool closed = false;
+  bool seenOpen = false;
+  uint64_t lastOpenUs = 0;
+  for (const Transition& tr : trace) {
+    if (tr.closed && !closed && (!seenOpen || tr.us - lastOpenUs > 10000) &&
+        closedAt(trace, tr.us + KEYPAD_DEBOUNCE_MS * 1000)) {
+      pressTimes.push_back(base + tr.us);
+    }
+    if (!tr.closed) {
+      lastOpenUs = tr.us;
+      seenOpen = true;
+    }
+    closed = tr.closed;
+    sim_schedule_key(base + tr.us, row, col, tr.closed);
+  }
+
+  uint64_t end = base + (trace.empty() ? 0 : trace.back().us) + 50000;
+  size_t next = 0;
+  size_t matched = SIZE_MAX;
+  InputEvent event;
+  while (sim_now_us() < end) {
+    sim_advance(1000);  // Drain directly, loop() is not involved here
+    while (input_read(&event)) {
+      if (event.type != INPUT_KEY || !event.value || event.row != row || event.col != col) continue;
+      stats->accepted++;
+      // Attribute the event to the latest physical press before it
+      while (next + 1 < pressTimes.size() && pressTimes[next + 1] <= event.timestamp) next++;
+      // Only the first event after a press measures latency, later ones are false triggers
+      if (next < pressTimes.size() && pressTimes[next] <= event.timestamp && next != matched) {
+        matched = next;
+        stats->measured++;
+        uint64_t added = event.timestamp - pressTimes[next];
+        stats->addedUsTotal += added;
+        if (added > stats->addedUsMax) stats->addedUsMax = added;
+      }
+    }
+  }
+  stats->presses += pressTimes.size();
+}
+
+// Synthetic profiles: n presses with `bounces` chatter pulses per edge and,
+// with noise, one short spike while the key is released
+static std::vector<Transition> makeTrace(uint32_t presses, uint8_t bounces, bool noise) {
+  std::vector<Transition> trace;
+  uint64_t t = 0;
+  for (uint32_t i = 0; i < presses; i++) {
+    for (int edge = 0; edge < 2; edge++) {
+      bool closed = edge == 0;
+      trace.push_back({t, closed});
+      uint64_t b = t;
+      for (uint8_t j = 0; j < bounces; j++) {
+        b += rngRange(30, 400);
+        trace.push_back({b, !closed});
+        b += rngRange(30, 400);
+        trace.push_back({b, closed});
+      }
+      t += 60000;
+    }
+    if (noise) {
+      uint64_t spike = t - rngRange(10000, 40000);
+      trace.push_back({spike, true});
+      trace.push_back({spike + rngRange(50, 150), false});
+    }
+  }
+  return trace;
+}
+
+static bool loadTrace(const char* path, std::vector<Transition>* trace) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  char line[128];
+  while (fgets(line, sizeof(line), f)) {
+    unsigned long long us;
+    int level;
+    if (line[0] == '#' || sscanf(line, "%llu %d", &us, &level) != 2) continue;
+    trace->push_back({us, level != 0});
+  }
+  fclose(f);
+  return true;
+}
+
+static void printTrace(const char* name, const TraceStats& s) {
+  uint32_t falseTriggers = s.accepted > s.presses ? s.accepted - s.presses : 0;
+  printf("  %-10s presses %4u accepted %4u  added latency mean %6.0f us max %6llu us  false triggers %u (%.1f%%)\n",
+         name, s.presses, s.accepted, s.measured ? (double)s.addedUsTotal / s.measured : 0.0,
+         (unsigned long long)s.addedUsMax, falseTriggers,
+         s.presses ? 100.0 * falseTriggers / s.presses : 0.0);
+}
+
+static void benchDebounce(const char* tracePath) {
+  printf("\n== Debounce: %s, %u ms at %u Hz ==\n", debounce_algorithm_name(),
+         KEYPAD_DEBOUNCE_MS, KEYPAD_SCAN_HZ_MIN);
+  rngState = 0xD3B0;
+
+  struct Profile { const char* name; uint8_t bounces; bool noise; };
+  static const Profile profiles[] = {
+    {"clean", 0, false},
+    {"bouncy", 6, false},
+    {"noisy", 6, true},
+  };
+  for (const Profile& p : profiles) {
+    std::vector<Transition> trace = makeTrace(100, p.bounces, p.noise);
+    std::sort(trace.begin(), trace.end(), [](const Transition& a, const Transition& b) { return a.us < b.us; });
+    TraceStats stats = {};
+    replayTrace(trace, &stats);
+    printTrace(p.name, stats);
+  }
+
+  if (tracePath) {
+    std::vector<Transition> trace;
+    if (!loadTrace(tracePath, &trace)) {
+      printf("  cannot read trace %s\n", tracePath);
+      failures++;
+      return;
+    }
+    TraceStats stats = {};
+    replayTrace(trace, &stats);
+    printTrace("file", stats);
+  }
+}
+
+// --- Matrix scan ---
+
+// Scanner core alone: the GPIO register reads back a fixed level, so the
+// cost is what keypad_scan() itself adds per row and per column
+static void fixedWriteRow(uint8_t pin, bool active) {}
+static uint32_t fixedReadInputs() { return 0xFFFFFFFF; }
+static uint32_t fixedMicros() { return 0; }
+static void fixedSettle(uint32_t us) {}
+
+static const KeypadIo fixedIo = {fixedWriteRow, fixedReadInputs, fixedMicros, fixedSettle};
+
+// Best of a few runs, in ns per scan
+static double scanCostNs(const uint8_t* rows, uint8_t nRows, const uint8_t* cols, uint8_t nCols) {
+  const uint32_t scans = 100000;
+  double best = 1e9;
+  keypad_init(rows, nRows, cols, nCols, &fixedIo, KEYPAD_SCAN_HZ_MIN);
+  for (int run = 0; run < 5; run++) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < scans; i++) keypad_scan();
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    best = std::min(best, ns / scans);
+  }
+  return best;
+}
+
+static void benchScan() {
+  printf("\n== Matrix scan: one register read per row ==\n");
+
+  static const uint8_t smallRows[] = {4, 5};
+  static const uint8_t smallCols[] = {6, 7, 8};
+  static const uint8_t largeRows[] = {16, 17, 18, 19, 20, 21};
+  static const uint8_t largeCols[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+  sim_reset();
+  input_init();
+  double small = scanCostNs(smallRows, 2, smallCols, 3);
+  double large = scanCostNs(largeRows, 6, largeCols, 16);
+  printf("  2x3: %.0f ns/scan (%.0f ns/row), 6x16: %.0f ns/scan (%.0f ns/row)\n",
+         small, small / 2, large, large / 6);
+  check(large / 6 < small / 2 * 1.5, "row cost does not grow with columns");
+
+  // Ghosting on a matrix without diodes: hold two keys on row 0, then add
+  // one on row 1 below the first. (1,1) reads closed too; the rectangle is
+  // masked until it breaks up, then (1,0) registers on its own.
+  sim_reset();
+  sim_matrix_diodes(false);
+  keypad_begin(largeRows, 6, largeCols, 16);
+  sim_set_key(0, 0, true);
+  sim_set_key(0, 1, true);
+  sim_advance(20000);
+  sim_set_key(1, 0, true);
+  sim_advance(20000);
+  KeypadStats stats;
+  keypad_get_stats(&stats);
+  check(keypad_is_pressed(0, 0) && keypad_is_pressed(0, 1) && !keypad_is_pressed(1, 1),
+        "ghost key masked, held keys kept");
+  check(stats.ghostScans > 0, "ghost scans counted");
+  sim_set_key(0, 1, false);
+  sim_advance(20000);
+  check(keypad_is_pressed(1, 0) && !keypad_is_pressed(1, 1) && !keypad_is_pressed(0, 1),
+        "rectangle broken: real key registers");
+  sim_reset();
+}
+
+// --- Macros ---
+
+static constexpr char macroText[] =
+    "Hello, World! 0123456789 ~{}|:\"<>? The quick brown fox jumps over the lzy dog.\n";
+
+MACRO_DEFINE(simTyping, m_type(macroText), m_delay(30), m_type(macroText));
+
+static const uint8_t* const simMacros[] = {simTyping.code};
+
+static uint32_t ioRuns;
+static void countRun(const KeyAction* action, bool pressed) { ioRuns++; }
+static void countFlush() {}
+static bool alwaysReady() { return true; }
+
+static void benchMacro() {
+  printf("\n== Macros: bytecode interpreter ==\n");
+
+  // Interpreter alone, output counted only
+  static const MacroIo countingIo = {countRun, countFlush, alwaysReady};
+  macro_init(simMacros, 1, &countingIo);
+  ioRuns = 0;
+  uint32_t polls = 0;
+  uint32_t nowMs = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 1000; i++) {
+    macro_start(0);
+    while (macro_busy()) {
+      macro_poll(nowMs += 1);
+      polls++;
+    }
+  }
+  double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+  printf("  interpreter: %u actions in %u polls, %.0f ns/poll, %.1f M actions/s\n",
+         ioRuns, polls, ns / polls, ioRuns / ns * 1e3);
+
+  // Whole firmware: the macro types while a real key is pressed halfway through
+  bootFirmware();
+  macro_begin(simMacros, 1);
+  LoopCost cost = {};
+  runLoops(10000, &cost);
+  macro_start(0);
+  uint64_t keyUs = sim_now_us() + 20000;
+  sim_schedule_key(keyUs, 0, 0, true);  // 'a', which the macro never types
+  sim_schedule_key(keyUs + 30000, 0, 0, false);
+  runLoops(2000000, &cost);
+
+  std::string expected = std::string(macroText) + macroText;
+  std::string typed = hostText;
+  // The key shares modifiers with the macro, so it may arrive shifted
+  typed.erase(std::remove_if(typed.begin(), typed.end(), [](char c) { return c == 'a' || c == 'A'; }),
+              typed.end());
+  uint64_t keyLatencyUs = hostFirstUs[HID_KEY_A] ? hostFirstUs[HID_KEY_A] - keyUs : 0;
+  printf("  typed %zu characters, key during macro reached host after %llu us\n",
+         typed.size(), (unsigned long long)keyLatencyUs);
+  printReports();
+  check(typed == expected, "macro text arrives intact and in order");
+  check(hostFirstUs[HID_KEY_A] && keyLatencyUs <= (KEYPAD_DEBOUNCE_MS + 5) * 1000,
+        "a key pressed during a macro is not delayed");
+  check(!macro_busy() && hostKeysReleased(), "macro ends with nothing held");
+}
+
+static void printTransport() {
+  static char text[200];
+  hid_transport_format(text, sizeof(text));
+  printf("  %s", text);
+}
+
+static void benchFlowControl() {
+  printf("\n== HID transport: flow control ==\n");
+
+  // The default link: credits never outrun the stack's buffers
+  bootFirmware();
+  macro_begin(simMacros, 1);
+  LoopCost cost = {};
+  macro_start(0);
+  runLoops(2000000, &cost);
+  HidTransportStats tx;
+  hid_transport_get_stats(&tx);
+  printf(" macro over the default link:\n");
+  printTransport();
+  check(sim_ble_tx_refused() == 0 && tx.retried == 0, "no notification refused by the stack");
+  check(tx.maxInFlight <= HID_TX_CREDITS, "in flight stays within the credits");
+
+  // Fewer stack buffers than credits: refused notifications are retried
+  // in place, so the text still arrives whole and in order
+  bootFirmware();
+  sim_ble_set_tx_capacity(3, 2);
+  macro_begin(simMacros, 1);
+  macro_start(0);
+  runLoops(3000000, &cost);
+  hid_transport_get_stats(&tx);
+  printf(" macro over a link with 3 buffers, 2 per event:\n");
+  printTransport();
+  check(tx.retried > 0 && sim_ble_tx_refused() == tx.retried, "refused sends are retried");
+  check(hostText == std::string(macroText) + macroText, "retried text arrives intact and in order");
+  check(hostKeysReleased(), "nothing stuck after retries");
+
+  // A link that stops sending: presses back up until only the release
+  // reserve is left, and the releases still get in behind them
+  bootFirmware();
+  sim_ble_set_tx_capacity(0, 0);
+  encoder_set_mode(ENCODER_MODE_VOLUME);
+  spinEncoder(sim_now_us() + 1000, -200, 1000);
+  sim_schedule_key(sim_now_us() + 5000, 0, 0, true);
+  runLoops(150000, &cost);
+  uint8_t queued = HID_TRANSPORT_QUEUE_LEN - 1 - hid_transport_queue_free();
+  ble_hid_release_all();
+  uint8_t releaseQueued = HID_TRANSPORT_QUEUE_LEN - 1 - hid_transport_queue_free() - queued;
+  hid_transport_get_stats(&tx);
+  printf(" stalled link, volume spin and a key: %u queued, %u refused\n", queued, tx.refused);
+  check(tx.refused > 0 && hid_transport_press_room() == 0, "presses held back at the release reserve");
+  check(releaseQueued == 1, "a release still gets in");
+
+  sim_ble_set_tx_capacity(10, 6);
+  sim_schedule_key(sim_now_us() + 1000, 0, 0, false);
+  runLoops(2000000, &cost);
+  hid_transport_get_stats(&tx);
+  printTransport();
+  check(hostMediaHeld == 0 && hostKeysReleased(), "link back: nothing left held on the host");
+  check(hostMediaPresses <= (uint32_t)ENCODER_MAX_BURST + ENCODER_MAX_BACKLOG + HID_TRANSPORT_QUEUE_LEN,
+        "a backed-up spin is cut short");
+
+  // Completions lost: the credits come back after HID_TX_STALL_MS
+  bootFirmware();
+  sim_ble_lose_confirms(true);
+  for (uint8_t i = 0; i < 2; i++) {
+    for (const auto& key : typingKeys) {
+      sim_schedule_key(sim_now_us() + 1000, key[0], key[1], true);
+      sim_schedule_key(sim_now_us() + 40000, key[0], key[1], false);
+      runLoops(80000, &cost);
+    }
+  }
+  runLoops(HID_TX_STALL_MS * 1000 + 50000, &cost);
+  hid_transport_get_stats(&tx);
+  printf(" confirms lost:\n");
+  printTransport();
+  check(tx.stalls > 0 && hostKeyPresses == 8 && hostKeysReleased(), "lost completions only stall the link");
+
+  // Two taps of one consumer key closer together than its hold: the second
+  // waits for the first release instead of repeating the held report
+  bootFirmware();
+  runLoops(10000, &cost);
+  ble_send_media_key(HID_CONSUMER_VOLUME_UP);
+  runLoops(10000, &cost);
+  ble_send_media_key(HID_CONSUMER_VOLUME_UP);
+  runLoops(20000, &cost);
+  ble_send_media_burst(HID_CONSUMER_VOLUME_UP, 2);  // Held back too, until the release
+  runLoops(100000, &cost);
+  check(hostMediaPresses == 2 && !hostMediaHeld, "quick repeated media taps each arrive");
+
+  // More scheduled releases than the timer wheel holds: the rest wait in
+  // the queue for a free entry, none is dropped
+  HidTransportStats before, after;
+  hid_transport_get_stats(&before);
+  const uint8_t noUsage[2] = {};
+  uint32_t scheduledNow = 0;
+  for (uint8_t i = 0; i < HID_WHEEL_CAPACITY + 8; i++) {
+    if (i == HID_TRANSPORT_QUEUE_LEN - 1) sim_advance(2000);  // Queue onto the wheel, which fills
+    scheduledNow += hid_transport_send(HID_REPORT_ID_MEDIA, noUsage, sizeof(noUsage), 100);
+  }
+  runLoops(400000, &cost);
+  hid_transport_get_stats(&after);
+  check(scheduledNow == HID_WHEEL_CAPACITY + 8 && after.scheduled - before.scheduled == scheduledNow &&
+        after.dropped == before.dropped, "a full timer wheel never drops a release");
+}
+
+// --- Config store ---
+
+// Same wiring as the firmware defaults, so the sim matrix still lines up
+static const ConfigSettings simSettings = {1000, KEYPAD_DEBOUNCE_MS, ROT_A, ROT_B, {5, 1}, {4, 20, 8}};
+
+static Keymap<1, 2, 3> simKeymap(char first) {
+  Keymap<1, 2, 3> map = {{{{action_char(first), ACTION_NO_KEY, ACTION_NO_KEY},
+                            {ACTION_NO_KEY, ACTION_NO_KEY, ACTION_NO_KEY}}},
+                         {{ENCODER_MODE_VOLUME, HID_CONSUMER_VOLUME_UP, HID_CONSUMER_VOLUME_DOWN}}};
+  return map;
+}
+
+static uint32_t buildSimConfig(const Keymap<1, 2, 3>& map, uint8_t* out, uint32_t cap,
+                               uint8_t macroCount = 1, const ConfigSettings* settings = &simSettings) {
+  static const uint8_t* macros[CONFIG_MAX_MACROS];
+  for (uint8_t i = 0; i < macroCount; i++) macros[i] = simTyping.code;
+  ConfigSource src = {settings, &map.keys[0][0][0], map.encoder, 1, 2, 3, macros, macroCount};
+  return config_build(&src, out, cap);
+}
+
+// Tap key (0,0) and return the first usage the host saw
+static uint8_t tapFirstKey() {
+  memset(hostFirstUs, 0, sizeof(hostFirstUs));
+  LoopCost cost = {};
+  sim_schedule_key(sim_now_us() + 10000, 0, 0, true);
+  sim_schedule_key(sim_now_us() + 30000, 0, 0, false);
+  runLoops(60000, &cost);
+  for (uint16_t usage = 4; usage < 256; usage++) {
+    if (hostFirstUs[usage]) return usage;
+  }
+  return 0;
+}
+
+static uint8_t bootAndTapFirstKey() {
+  bootFirmware();
+  return tapFirstKey();
+}
+
+static void benchConfig() {
+  printf("\n== Config: A/B store in flash ==\n");
+  static uint8_t blob[CONFIG_SLOT_SIZE];
+
+  check(config_crc32((const uint8_t*)"123456789", 9) == 0xCBF43926, "CRC-32 matches the IEEE check value");
+
+  uint32_t len = buildSimConfig(simKeymap('z'), blob, sizeof(blob));
+  auto start = std::chrono::steady_clock::now();
+  const ConfigHeader* built = nullptr;
+  for (int i = 0; i < 1000; i++) built = config_validate(blob, len);
+  double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count() / 1000;
+  printf("  %u byte blob validates in %.0f ns\n", len, ns);
+  check(built != nullptr, "built blob validates");
+
+  // Debounce times a counter cannot hold are refused, not silently cut
+  ConfigSettings fast = simSettings;
+  fast.scanHz = KEYPAD_SCAN_HZ_MAX;
+  fast.debounceMs = 15;
+  bool fits = config_validate(blob, buildSimConfig(simKeymap('z'), blob, sizeof(blob), 1, &fast)) != nullptr;
+  fast.debounceMs = 16;
+  bool refused = !config_validate(blob, buildSimConfig(simKeymap('z'), blob, sizeof(blob), 1, &fast));
+  check(fits && refused && debounce_scans_for(KEYPAD_DEBOUNCE_MS, KEYPAD_SCAN_HZ_MAX) == 20,
+        "debounce beyond the counter is refused");
+  len = buildSimConfig(simKeymap('z'), blob, sizeof(blob));
+  built = config_validate(blob, len);
+
+  ConfigView view;
+  config_view(built, &view);
+  Keymap<1, 2, 3> original = simKeymap('z');
+  check(!memcmp(view.keys, original.keys, sizeof(original.keys)) &&
+        !memcmp(view.encoder, original.encoder, sizeof(original.encoder)) &&
+        view.macroCount == 1 && macro_code_len(view.macros[0], len) == sizeof(simTyping.code) &&
+        !memcmp(view.macros[0], simTyping.code, sizeof(simTyping.code)),
+        "view round-trips keys, encoder and macros");
+
+  // Stored config replaces the compiled-in keymap: (0,0) types 'z', not 'a'
+  sim_config_erase_all();
+  config_begin(&view);
+  bool written = config_store_write(blob, len);
+  check(written && bootAndTapFirstKey() == HID_KEY_Z, "stored config is used at boot");
+
+  // Power cut partway through the next write: the old config stays
+  len = buildSimConfig(simKeymap('y'), blob, sizeof(blob));
+  int8_t before = config_store_active_slot();
+  bool cutWrite = true;
+  for (int32_t budget = 0; budget < (int32_t)len + 4 && cutWrite; budget += 7) {
+    sim_config_fail_after(budget);
+    config_store_write(blob, len);
+    sim_config_fail_after(-1);
+    config_begin(&view);
+    cutWrite = config_store_active_slot() == before && view.header->sequence == 1;
+  }
+  check(cutWrite, "interrupted write keeps the previous config");
+  check(bootAndTapFirstKey() == HID_KEY_Z, "keys still come from the previous config");
+
+  written = config_store_write(blob, len);
+  check(written && bootAndTapFirstKey() == HID_KEY_Y, "completed write wins on next boot");
+
+  // A flipped bit in the newer slot falls back to the older one
+  sim_config_slot(config_store_active_slot())[len - 1] ^= 0x01;
+  check(bootAndTapFirstKey() == HID_KEY_Z, "corrupt slot falls back to the other");
+
+  // Later runs use the compiled-in defaults
+  sim_config_erase_all();
+}
+
+// --- Macro recorder ---
+
+static std::vector<std::pair<uint32_t, uint8_t>> playedEdges;  // (ms, pressed << 7 | row << 4 | col)
+static uint32_t recorderMs;
+static bool recorderStoreOk;
+
+static void logKey(uint8_t row, uint8_t col, bool pressed) {
+  playedEdges.push_back({recorderMs, (uint8_t)((pressed ? 0x80 : 0) | row << 4 | col)});
+}
+static void ignoreRotation(int32_t detents) {}
+static const KeyAction* noAction(uint8_t row, uint8_t col) { return &ACTION_NO_KEY; }
+static bool acceptSave(uint8_t slot, const uint8_t* data, uint16_t len) { return recorderStoreOk; }
+
+// Record and play keys on the sim matrix; the encoder changes the volume
+static Keymap<1, 2, 3> recorderKeymap() {
+  Keymap<1, 2, 3> map = {{{{action_char('r'), action_char('e'), action_record(0)},
+                            {action_play(0), action_play(0, true), action_char('x')}}},
+                         {{ENCODER_MODE_VOLUME, HID_CONSUMER_VOLUME_UP, HID_CONSUMER_VOLUME_DOWN}}};
+  return map;
+}
+
+static void tapKeyAt(uint64_t atUs, uint8_t row, uint8_t col, uint32_t holdUs) {
+  sim_schedule_key(atUs, row, col, true);
+  sim_schedule_key(atUs + holdUs, row, col, false);
+}
+
+// Tap a play key and run until the host has seen `chars` characters;
+// returns the playback time in ms, or 0 when it never got there
+static uint32_t playUntil(uint8_t col, size_t chars) {
+  LoopCost cost = {};
+  hostText.clear();
+  uint64_t start = sim_now_us() + 10000;
+  tapKeyAt(start, 1, col, 30000);
+  while (hostText.size() < chars && sim_now_us() < start + 5000000) runLoops(1000, &cost);
+  uint32_t ms = hostText.size() >= chars ? (uint32_t)((sim_now_us() - start) / 1000) : 0;
+  while (recorder_playing() && sim_now_us() < start + 5000000) runLoops(1000, &cost);
+  runLoops(200000, &cost);  // Media taps and releases go out
+  return ms;
+}
+
+static void benchRecorder() {
+  printf("\n== Macro recorder: delta-encoded capture and playback ==\n");
+
+  // Core alone: 300 edges at uneven gaps round-trip with their timing
+  static const RecorderIo logIo = {logKey, ignoreRotation, countFlush, alwaysReady, noAction, acceptSave};
+  recorderStoreOk = true;
+  recorder_init(&logIo, 0);
+  rngState = 0xC0FFEE;
+  std::vector<std::pair<uint32_t, uint8_t>> recorded;
+  uint32_t us = 5000000;
+  recorder_start(0);
+  for (uint32_t i = 0; i < 300; i++) {
+    uint8_t edge = (i & 1 ? 0 : 0x80) | (i / 2 % KEYPAD_MAX_ROWS) << 4 | (i / 2 % KEYPAD_MAX_COLS);
+    us += rngRange(1000, i % 50 ? 200000 : 3000000);
+    recorder_capture_key(edge >> 4 & 0x07, edge & 0x0F, edge & 0x80, us);
+    recorded.push_back({us / 1000, edge});
+  }
+  recorder_stop();
+  uint16_t len = recorder_slot_len(0);
+
+  playedEdges.clear();
+  recorderMs = 1000;
+  recorder_play(0, false, recorderMs);
+  while (recorder_playing() && recorderMs < 100000000) recorder_poll(++recorderMs);
+  bool sameTiming = playedEdges.size() == recorded.size();
+  for (size_t i = 1; sameTiming && i < recorded.size(); i++) {
+    int32_t want = (int32_t)(recorded[i].first - recorded[0].first);
+    int32_t got = (int32_t)(playedEdges[i].first - playedEdges[0].first);
+    sameTiming = playedEdges[i].second == recorded[i].second && abs(got - want) <= 1;
+  }
+  printf("  %zu edges in %u bytes (%.2f bytes/edge)\n", recorded.size(), len, (double)len / recorded.size());
+  check(sameTiming, "playback keeps edges and recorded gaps");
+  check(len <= recorded.size() * 3 && recorder_check(recorder_slot_data(0), len) == len,
+        "recording is compact and decodes");
+
+  // A full buffer ends the recording with whole events only
+  RecorderStats before, after;
+  recorder_get_stats(&before);
+  recorder_start(1);
+  for (uint32_t i = 0; i < RECORDER_MAX_BYTES && recorder_recording(); i++) {
+    recorder_capture_key(0, 0, !(i & 1), i * 1000000);
+  }
+  recorder_get_stats(&after);
+  len = recorder_slot_len(1);
+  check(!recorder_recording() && after.truncated == before.truncated + 1 && len > RECORDER_MAX_BYTES - 4 &&
+        recorder_check(recorder_slot_data(1), len) == len, "full buffer stops on an event boundary");
+
+  // Whole firmware: record four keys and a turn of the encoder through the
+  // record key, then play them back through the HID path
+  static uint8_t blob[CONFIG_SLOT_SIZE];
+  sim_recorder_erase_all();
+  sim_config_erase_all();
+  ConfigView view;
+  config_begin(&view);
+  config_store_write(blob, buildSimConfig(recorderKeymap(), blob, sizeof(blob)));
+  bootFirmware();
+
+  LoopCost cost = {};
+  uint64_t t = sim_now_us() + 10000;
+  tapKeyAt(t, 0, 2, 30000);  // Record
+  static const uint8_t typed[] = {0, 1, 1, 0};  // "reer"
+  for (uint8_t col : typed) {
+    t += 300000;
+    tapKeyAt(t, 0, col, 40000);
+  }
+  spinEncoder(t + 200000, 3, 50);
+  tapKeyAt(t + 500000, 0, 2, 30000);  // Stop and save
+  runLoops(t + 600000 - sim_now_us(), &cost);
+  bool recordedLive = hostText == "reer" && !recorder_recording() && recorder_slot_len(0) > 0;
+  uint32_t liveMedia = hostMediaPresses;
+
+  hostMediaPresses = 0;
+  uint32_t keptMs = playUntil(0, 4);
+  std::string keptText = hostText;
+  bool mediaPlayed = hostMediaPresses == liveMedia;
+  recorder_begin(50);  // As a config with replayGapMs 50 would
+  uint32_t cappedMs = playUntil(0, 4);
+  uint32_t fastMs = playUntil(1, 4);
+  printf("  %u bytes recorded; played in %u ms as recorded, %u ms with gaps capped at 50 ms, %u ms fast\n",
+         recorder_slot_len(0), keptMs, cappedMs, fastMs);
+  check(recordedLive && keptText == "reer" && hostText == "reer", "recorded keys play back through HID");
+  check(mediaPlayed && liveMedia > 0, "encoder turns play back too");
+  check(keptMs >= 850 && cappedMs && cappedMs < keptMs / 2 && fastMs && fastMs < cappedMs,
+        "gap cap and fast playback shorten it");
+  check(!recorder_playing() && hostKeysReleased(), "playback ends with nothing held");
+
+  // A live key during a slow playback goes out at once
+  recorder_begin(0);
+  hostText.clear();
+  memset(hostFirstUs, 0, sizeof(hostFirstUs));
+  uint64_t keyUs = sim_now_us() + 400000;
+  tapKeyAt(sim_now_us() + 10000, 1, 0, 30000);
+  tapKeyAt(keyUs, 1, 2, 30000);
+  runLoops(2000000, &cost);
+  uint64_t keyLatencyUs = hostFirstUs[HID_KEY_X] ? hostFirstUs[HID_KEY_X] - keyUs : 0;
+  check(hostFirstUs[HID_KEY_X] && keyLatencyUs <= (KEYPAD_DEBOUNCE_MS + 5) * 1000,
+        "a key pressed during playback is not delayed");
+
+  // Recordings survive a reboot
+  bootFirmware();
+  check(recorder_slot_len(0) > 0 && playUntil(1, 4) && hostText == "reer", "recording survives a reboot");
+
+  // Later runs use the compiled-in defaults
+  sim_config_erase_all();
+  sim_recorder_erase_all();
+}
+
+// --- Config over BLE ---
+
+static ConfigTransferStatus readTransferStatus() {
+  ConfigTransferStatus status = {};
+  sim_ble_read(CONFIG_CONTROL_CHAR_UUID, (uint8_t*)&status, sizeof(status));
+  return status;
+}
+
+static void sendTransferCommand(uint8_t op, uint32_t operand) {
+  uint8_t command[5] = {op, (uint8_t)operand, (uint8_t)(operand >> 8), (uint8_t)(operand >> 16),
+                        (uint8_t)(operand >> 24)};
+  sim_ble_write(CONFIG_CONTROL_CHAR_UUID, command, sizeof(command));
+}
+
+// BEGIN_WRITE, chunks, COMMIT; corruptAt flips one byte on the way
+static uint32_t sendConfig(const uint8_t* blob, uint32_t len, uint32_t chunk, int32_t corruptAt = -1) {
+  static uint8_t buffer[CONFIG_BLE_MTU];
+  sendTransferCommand(CONFIG_CMD_BEGIN_WRITE, len);
+  uint32_t chunks = 0;
+  for (uint32_t at = 0; at < len; at += chunk, chunks++) {
+    uint32_t n = len - at < chunk ? len - at : chunk;
+    memcpy(buffer, blob + at, n);
+    if (corruptAt >= (int32_t)at && corruptAt < (int32_t)(at + n)) buffer[corruptAt - at] ^= 0x40;
+    sim_ble_write(CONFIG_DATA_CHAR_UUID, buffer, n);
+  }
+  sendTransferCommand(CONFIG_CMD_COMMIT, config_crc32(blob, len));
+  return chunks;
+}
+
+static void benchConfigTransfer() {
+  printf("\n== Config over BLE: chunked transfer and live apply ==\n");
+  static uint8_t blob[CONFIG_SLOT_SIZE];
+  sim_config_erase_all();
+  bootFirmware();
+  sim_ble_set_mtu(247);  // Typical data length extension MTU
+  const uint32_t chunk = 247 - 3;
+  LoopCost cost = {};
+
+  // A full macro table, so the blob is a realistic size
+  uint32_t len = buildSimConfig(simKeymap('z'), blob, sizeof(blob), CONFIG_MAX_MACROS);
+  uint32_t chunks = sendConfig(blob, len, chunk);
+  ConfigTransferStatus status = readTransferStatus();
+  check(status.state == CONFIG_XFER_COMMITTED && status.crc == config_crc32(blob, len),
+        "running CRC matches the blob");
+
+  uint64_t start = sim_now_us();
+  while (readTransferStatus().state == CONFIG_XFER_COMMITTED && sim_now_us() - start < 100000) {
+    runLoops(1000, &cost);
+  }
+  status = readTransferStatus();
+  // On air: write-without-response packs several chunks into each connection
+  // event; 4 per 7.5 ms event is a conservative figure for phones and PCs
+  printf("  %u byte config in %u chunks of %u bytes: ~%u ms on air, stored and applied within %llu us\n",
+         len, chunks, chunk, (chunks + 3) / 4 * 15 / 2, (unsigned long long)(sim_now_us() - start));
+  check(status.error == CONFIG_XFER_OK && status.sequence == 1, "committed config is stored");
+  check(tapFirstKey() == HID_KEY_Z && ble_is_connected(), "new keymap is live without reconnecting");
+
+  // A damaged chunk fails the CRC and nothing is written
+  len = buildSimConfig(simKeymap('y'), blob, sizeof(blob));
+  sendConfig(blob, len, chunk, len / 2);
+  runLoops(5000, &cost);
+  status = readTransferStatus();
+  check(status.error == CONFIG_XFER_CRC && status.sequence == 1 && tapFirstKey() == HID_KEY_Z,
+        "corrupt transfer is rejected, config kept");
+
+  // Read back what is stored, MTU-sized chunk by chunk
+  static uint8_t readBack[CONFIG_SLOT_SIZE];
+  const ConfigHeader* active = config_store_active();
+  sendTransferCommand(CONFIG_CMD_BEGIN_READ, 0);
+  uint32_t got = 0, n;
+  while ((n = sim_ble_read(CONFIG_DATA_CHAR_UUID, readBack + got, chunk)) > 0) got += n;
+  check(got == active->length && !memcmp(readBack, active, got) &&
+        readTransferStatus().crc == config_crc32(readBack, got), "config reads back intact");
+
+  sim_config_erase_all();
+}
+
+// --- Key resolution ---
+
+// Scripts drive the engine core on its own clock, one resolve_poll() per
+// millisecond as the loop would. Script: "<ms>:<P|R><row><col>" edges.
+// Output: "<ms>:<+|-><usage hex>", "M<mods>" for held modifiers and
+// "L<layer>" for layers, at the millisecond each action ran.
+static const KeyAction scriptKeys[3][3] = {
+  {action_layer_tap(1, HID_KEY_F13), action_mod_tap(HID_MOD_LEFT_CTRL, HID_KEY_A), action_key(HID_KEY_B)},
+  {action_tap_dance(0), action_key(HID_KEY_X), action_key(HID_KEY_Y)},
+  {action_key(HID_KEY_1), action_key(HID_KEY_2), action_key(HID_KEY_3)},
+};
+
+static const TapDance scriptDances[] = {
+  {{action_key(HID_KEY_C), action_key(HID_KEY_D), action_key(HID_KEY_E), ACTION_NO_KEY}},
+};
+
+static const Combo scriptCombos[] = {
+  combo2(resolve_key(1, 1), resolve_key(1, 2), action_key(HID_KEY_Z)),
+  combo3(resolve_key(2, 0), resolve_key(2, 1), resolve_key(2, 2), action_key(HID_KEY_ESCAPE)),
+  combo2(resolve_key(2, 0), resolve_key(2, 1), action_key(HID_KEY_TAB)),
+};
+
+static std::string scriptOutput;
+static uint32_t scriptMs;
+
+static void scriptRun(const KeyAction* action, bool pressed) {
+  char token[24];
+  char sign = pressed ? '+' : '-';
+  if (action->type == ACTION_LAYER) {
+    snprintf(token, sizeof(token), " %u:%cL%u", scriptMs, sign, action->code & 0xFF);
+  } else if (action->code) {
+    snprintf(token, sizeof(token), " %u:%c%02X", scriptMs, sign, action->code);
+  } else {
+    snprintf(token, sizeof(token), " %u:%cM%02X", scriptMs, sign, action->mods);
+  }
+  scriptOutput += token;
+}
+
+static void scriptKey(uint8_t row, uint8_t col, bool pressed) {
+  scriptRun(&scriptKeys[row][col], pressed);
+}
+
+static const KeyAction* scriptLookup(uint8_t row, uint8_t col) {
+  return &scriptKeys[row][col];
+}
+
+static void scriptFlush() {}
+
+static const ResolveIo scriptIo = {scriptKey, scriptLookup, scriptRun, scriptFlush};
+
+static std::string runScript(const char* script) {
+  struct ScriptEdge { uint32_t ms; bool pressed; uint8_t row; uint8_t col; };
+  std::vector<ScriptEdge> edges;
+  unsigned ms, row, col;
+  char edge;
+  int used;
+  for (const char* p = script; sscanf(p, " %u:%c%1u%1u%n", &ms, &edge, &row, &col, &used) == 4; p += used) {
+    edges.push_back({ms, edge == 'P', (uint8_t)row, (uint8_t)col});
+  }
+
+  scriptOutput.clear();
+  size_t next = 0;
+  uint32_t end = edges.empty() ? 0 : edges.back().ms + 1000;
+  for (scriptMs = 0; scriptMs <= end; scriptMs++) {
+    for (; next < edges.size() && edges[next].ms == scriptMs; next++) {
+      resolve_key_event(edges[next].row, edges[next].col, edges[next].pressed, scriptMs * 1000);
+    }
+    resolve_poll(scriptMs * 1000);
+  }
+  return scriptOutput.empty() ? scriptOutput : scriptOutput.substr(1);
+}
+
+static void benchResolve() {
+  printf("\n== Key resolution: tap-hold, tap-dance, combos (tap term 200 ms, combo 40 ms) ==\n");
+
+  struct Case { const char* name; const char* script; const char* expected; };
+  static const Case cases[] = {
+    {"plain key is not delayed", "0:P02 30:R02", "0:+05 30:-05"},
+    {"tap-hold: tap", "0:P00 50:R00", "50:+68 50:-68"},
+    {"tap-hold: hold past the term", "0:P00 300:R00", "200:+L1 300:-L1"},
+    {"tap-hold: permissive hold", "0:P00 10:P02 30:R02 60:R00", "30:+L1 30:+05 30:-05 60:-L1"},
+    {"tap-hold: rolled key stays a tap", "0:P00 10:P02 50:R00 80:R02", "50:+68 50:-68 50:+05 80:-05"},
+    {"mod-tap: hold", "0:P01 250:R01", "200:+M01 250:-M01"},
+    {"tap-dance: one tap", "0:P10 50:R10", "250:+06 250:-06"},
+    {"tap-dance: two taps", "0:P10 50:R10 100:P10 150:R10", "350:+07 350:-07"},
+    {"tap-dance: last step at its press", "0:P10 30:R10 60:P10 90:R10 120:P10 150:R10", "120:+08 150:-08"},
+    {"tap-dance: second tap held", "0:P10 50:R10 100:P10 500:R10", "300:+07 500:-07"},
+    {"tap-dance: cut short by a key", "0:P10 50:R10 80:P02 100:R02", "80:+06 80:-06 80:+05 100:-05"},
+    {"combo: fires on its last key", "0:P11 10:P12 60:R11 70:R12", "10:+1D 60:-1D"},
+    {"combo: lone key after the window", "0:P11 100:R11", "40:+1B 100:-1B"},
+    {"combo: second key too late", "0:P11 50:P12 80:R11 90:R12", "40:+1B 80:+1C 80:-1B 90:-1C"},
+    {"combo: waits for a larger one", "0:P20 5:P21 10:P22 50:R20 60:R21 70:R22", "10:+29 50:-29"},
+    {"combo: smaller one at the window", "0:P20 5:P21 60:R20 65:R21", "40:+2B 60:-2B"},
+  };
+
+  ResolveStats stats = {};
+  for (const Case& c : cases) {
+    resolve_init(scriptDances, 1, scriptCombos, 3, 200, 40, &scriptIo);
+    std::string output = runScript(c.script);
+    bool ok = output == c.expected;
+    check(ok, c.name);
+    if (!ok) printf("    got \"%s\", expected \"%s\"\n", output.c_str(), c.expected);
+    ResolveStats one;
+    resolve_get_stats(&one);
+    stats.maxDelayUs = std::max(stats.maxDelayUs, one.maxDelayUs);
+  }
+  printf("  longest decision %u us\n", stats.maxDelayUs);
+  check(stats.maxDelayUs <= 200000, "no decision waits longer than its term");
+
+  // Firmware: a stored config with a mod-tap key and a combo
+  static uint8_t blob[CONFIG_SLOT_SIZE];
+  Keymap<1, 2, 3> map = {{{{action_mod_tap(HID_MOD_LEFT_SHIFT, HID_KEY_F13), action_char('b'), ACTION_NO_KEY},
+                            {action_char('d'), action_char('e'), ACTION_NO_KEY}}},
+                         {{ENCODER_MODE_VOLUME, HID_CONSUMER_VOLUME_UP, HID_CONSUMER_VOLUME_DOWN}}};
+  static const Combo combos[] = {combo2(resolve_key(1, 0), resolve_key(1, 1), action_char('q'))};
+  ConfigSource src = {&simSettings, &map.keys[0][0][0], map.encoder, 1, 2, 3, nullptr, 0,
+                      nullptr, 0, combos, 1};
+  uint32_t len = config_build(&src, blob, sizeof(blob));
+  ConfigView view;
+  sim_config_erase_all();
+  config_begin(&view);
+  check(len && config_store_write(blob, len), "config with a combo is stored");
+  bootFirmware();
+
+  LoopCost cost = {};
+  uint64_t t = sim_now_us();
+  sim_schedule_key(t + 10000, 0, 0, true);     // Tap: F13
+  sim_schedule_key(t + 60000, 0, 0, false);
+  sim_schedule_key(t + 100000, 0, 0, true);    // Hold with 'b' inside: Shift+b
+  sim_schedule_key(t + 130000, 0, 1, true);
+  sim_schedule_key(t + 160000, 0, 1, false);
+  sim_schedule_key(t + 200000, 0, 0, false);
+  sim_schedule_key(t + 300000, 1, 0, true);    // Combo: 'q', no 'd' or 'e'
+  sim_schedule_key(t + 310000, 1, 1, true);
+  sim_schedule_key(t + 360000, 1, 0, false);
+  sim_schedule_key(t + 370000, 1, 1, false);
+  runLoops(600000, &cost);
+  check(hostFirstUs[HID_KEY_F13] != 0, "firmware: quick tap sends the tap key");
+  check(hostText == "?Bq", "firmware: hold shifts, combo replaces keys");
+  check(hostKeysReleased() && !resolve_busy(), "firmware: nothing left held");
+
+  sim_config_erase_all();
+}
+
+// --- Power ---
+
+static void benchPower() {
+  printf("\n== Power: idle sleep and wake ==\n");
+  static uint8_t blob[CONFIG_SLOT_SIZE];
+  ConfigSettings settings = simSettings;
+  settings.idleMinutes = 1;
+  uint32_t len = buildSimConfig(simKeymap('z'), blob, sizeof(blob), 1, &settings);
+  sim_config_erase_all();
+  ConfigView view;
+  config_begin(&view);
+  config_store_write(blob, len);
+  bootFirmware();
+  rngState = 0x5EED;
+  LoopCost cost = {};
+
+  // Input restarts the idle timer
+  spinEncoder(sim_now_us() + 40000000, 2, 20);
+  runLoops(70000000, &cost);
+  check(power_state() == POWER_ACTIVE, "input restarts the idle timer");
+  runLoops(40000000, &cost);
+  check(power_state() == POWER_SLEEP, "sleeps after the idle period");
+
+  KeypadStats scan;
+  keypad_get_stats(&scan);
+  uint32_t scansBefore = scan.scans;
+  runLoops(600000000, &cost);  // Ten minutes asleep
+  keypad_get_stats(&scan);
+  check(scan.scans == scansBefore, "no matrix scans while asleep");
+
+  // The key that wakes the pad is the first one typed
+  uint64_t keyUs = sim_now_us() + 3000;
+  sim_schedule_key(keyUs, 0, 0, true);
+  sim_schedule_key(keyUs + 40000, 0, 0, false);
+  memset(hostFirstUs, 0, sizeof(hostFirstUs));
+  runLoops(100000, &cost);
+  uint64_t wakeKeyUs = hostFirstUs[HID_KEY_Z] ? hostFirstUs[HID_KEY_Z] - keyUs : 0;
+  printf("  waking key reached the host after %llu us\n", (unsigned long long)wakeKeyUs);
+  check(hostFirstUs[HID_KEY_Z] && wakeKeyUs <= (KEYPAD_DEBOUNCE_MS + 3) * 1000,
+        "waking keystroke is not lost");
+
+  // Back to sleep, then the encoder wakes it without losing the first detent
+  runLoops(61000000, &cost);
+  int32_t before = quadrature_position();
+  spinEncoder(sim_now_us() + 5000, 1, 5);
+  runLoops(500000, &cost);
+  check(quadrature_position() - before == QUADRATURE_STEPS_PER_DETENT && power_state() == POWER_ACTIVE,
+        "encoder wakes with no step lost");
+
+  PowerStats stats;
+  power_get_stats(&stats);
+  printf("  active %llu ms, asleep %llu ms; %u sleeps, %u input wakes, %u check wakes\n",
+         (unsigned long long)(stats.stateUs[POWER_ACTIVE] / 1000),
+         (unsigned long long)(stats.stateUs[POWER_SLEEP] / 1000),
+         stats.sleeps, stats.inputWakes, stats.checkWakes);
+  check(stats.sleeps == 2 && stats.inputWakes == 2, "power state counters add up");
+
+  // An upload the peer walks away from is dropped, and the pad still sleeps
+  sim_ble_set_mtu(247);
+  sendTransferCommand(CONFIG_CMD_BEGIN_WRITE, len);
+  sim_ble_write(CONFIG_DATA_CHAR_UUID, blob, 200);
+  runLoops((CONFIG_XFER_IDLE_MS + 1000) * 1000ull, &cost);
+  bool dropped = !config_transfer_active() && readTransferStatus().error == CONFIG_XFER_ABANDONED;
+  runLoops(61000000, &cost);
+  check(dropped && power_state() == POWER_SLEEP, "pad sleeps after an abandoned upload");
+
+  // So is one the link drops under
+  sendTransferCommand(CONFIG_CMD_BEGIN_WRITE, len);
+  sim_ble_disconnect();
+  dropped = !config_transfer_active();
+  sim_ble_connect();
+  check(dropped, "a dropped link aborts the upload");
+
+  sim_config_erase_all();
+}
+
+// --- Connection parameters ---
+
+static ConnParamsStatus readConnStatus() {
+  ConnParamsStatus status = {};
+  sim_ble_read(DIAG_CONN_CHAR_UUID, (uint8_t*)&status, sizeof(status));
+  return status;
+}
+
+static void benchConnParams() {
+  printf("\n== Connection parameters: profiles follow activity ==\n");
+  bootFirmware();
+  LoopCost cost = {};
+
+  runLoops(10000, &cost);
+  uint16_t typing = sim_ble_conn_interval();
+  runLoops(6000000, &cost);
+  uint16_t balanced = sim_ble_conn_interval();
+  runLoops(60000000, &cost);
+  uint16_t idle = sim_ble_conn_interval();
+  ConnParamsStatus status = readConnStatus();
+  printf("  interval typing %u us, balanced %u us, idle %u us (latency %u)\n",
+         typing * 1250, balanced * 1250, idle * 1250, status.latency);
+  check(typing == 6 && balanced == 24 && idle == 80 && status.latency == 4,
+        "interval steps down as the pad goes idle");
+  check(status.interval == idle && status.updates == 3, "diagnostics report the negotiated values");
+
+  sim_schedule_key(sim_now_us() + 1000, 0, 0, true);
+  sim_schedule_key(sim_now_us() + 30000, 0, 0, false);
+  runLoops(50000, &cost);
+  check(sim_ble_conn_interval() == 6, "a key press goes back to low latency");
+
+  // Pinned from the diagnostics characteristic, then back to automatic
+  uint8_t pin = CONN_PROFILE_IDLE;
+  sim_ble_write(DIAG_CONN_CHAR_UUID, &pin, 1);
+  runLoops(1100000, &cost);
+  sim_schedule_key(sim_now_us() + 1000, 0, 0, true);
+  sim_schedule_key(sim_now_us() + 30000, 0, 0, false);
+  runLoops(1100000, &cost);
+  bool pinned = sim_ble_conn_interval() == 80;
+  pin = CONN_PROFILE_AUTO;
+  sim_ble_write(DIAG_CONN_CHAR_UUID, &pin, 1);
+  runLoops(1100000, &cost);
+  check(pinned && sim_ble_conn_interval() == 6, "a pinned profile holds until released");
+
+  // A host with a higher floor settles inside the range; one that refuses
+  // the range is not asked again until the wanted profile changes
+  bootFirmware();
+  sim_ble_set_host_min_interval(9);  // 11.25 ms, as Apple hosts
+  runLoops(10000, &cost);
+  check(sim_ble_conn_interval() == 9, "host floor inside the range is accepted");
+
+  bootFirmware();
+  sim_ble_set_host_min_interval(50);
+  runLoops(4000000, &cost);
+  status = readConnStatus();
+  bool askedOnce = status.requests == 1 && status.failures == 1;
+  runLoops(60000000, &cost);
+  status = readConnStatus();
+  check(askedOnce && status.requests == 3 && sim_ble_conn_interval() == 80,
+        "refused profile is not retried in a loop");
+}
+
+static ReconnectStats readReconnectStats() {
+  ReconnectStats stats = {};
+  sim_ble_read(DIAG_RECONNECT_CHAR_UUID, (uint8_t*)&stats, sizeof(stats));
+  return stats;
+}
+
+static void benchReconnect() {
+  printf("\n== Reconnect: directed, whitelist and open advertising ==\n");
+  sim_ble_erase_bonds();
+  sim_reset();
+  setup();
+  LoopCost cost = {};
+
+  // Nothing bonded: open advertising, and the first host pairs into slot 0
+  bool open = sim_ble_adv_mode() == ADV_OPEN;
+  sim_ble_host_add(0, 5, 150);
+  sim_ble_host_pair(0);
+  runLoops(500000, &cost);
+  check(open && sim_ble_connected_host() == 0, "a new host pairs on open advertising");
+
+  // Host 0 goes out of range and comes back: directed advertising finds it
+  sim_ble_host_leave(0);
+  runLoops(1000, &cost);
+  bool directed = sim_ble_adv_mode() == ADV_DIRECTED;
+  sim_ble_host_add(0, 5, 150);
+  runLoops(100000, &cost);
+  ReconnectStats stats = readReconnectStats();
+  printf("  directed reconnect in %u ms\n", stats.lastMs);
+  check(directed && sim_ble_connected_host() == 0 && stats.byMode[ADV_DIRECTED] == 1 && stats.lastMs < 20,
+        "bonded host reconnects on directed adv");
+
+  // The host table survives a reboot
+  sim_reset();
+  setup();
+  sim_ble_host_add(0, 5, 150);
+  runLoops(100000, &cost);
+  stats = readReconnectStats();
+  check(sim_ble_connected_host() == 0 && stats.byMode[ADV_DIRECTED] == 1, "bonded host reconnects after a reboot");
+
+  // Switching to the empty slot 1 drops host 0 and pairs host 1, which uses
+  // a private address and never answers directed advertising
+  uint8_t slot = 1;
+  sim_ble_write(DIAG_RECONNECT_CHAR_UUID, &slot, 1);
+  sim_ble_host_add(1, 0, 25);
+  sim_ble_host_pair(1);
+  runLoops(200000, &cost);
+  stats = readReconnectStats();
+  check(sim_ble_connected_host() == 1 && stats.selected == 1, "switching to an empty slot pairs a new host");
+
+  sim_ble_host_leave(1);
+  sim_ble_host_add(1, 0, 25);
+  runLoops(2000000, &cost);
+  stats = readReconnectStats();
+  printf("  whitelist reconnect in %u ms\n", stats.lastMs);
+  check(sim_ble_connected_host() == 1 && stats.byMode[ADV_WHITELIST] == 1 &&
+        stats.lastMs >= RECONNECT_DIRECTED_MS && stats.lastMs < RECONNECT_DIRECTED_MS + 50,
+        "private-address host gets in on whitelist");
+
+  // A host key cycles to the next bonded host, timed from the press
+  KeyAction next = action_host(RECONNECT_SELECT_ANY);
+  keymap_dispatch(&next, true);
+  keymap_dispatch(&next, false);
+  runLoops(100000, &cost);
+  stats = readReconnectStats();
+  printf("  host switch in %u ms; %u connects, %u/%u/%u ms min/avg/max\n", stats.lastMs, stats.reconnects,
+         stats.minMs, stats.totalMs / stats.reconnects, stats.maxMs);
+  check(sim_ble_connected_host() == 0 && stats.selected == 0 && stats.lastMs < 20,
+        "host key switches to the next bonded host");
+
+  // A link that comes and goes between two polls while searching still
+  // leaves the pad advertising
+  sim_ble_host_leave(0);
+  runLoops(1000, &cost);
+  sim_ble_connect();
+  sim_ble_disconnect();
+  runLoops(1000, &cost);
+  bool searching = sim_ble_adv_mode() != ADV_OFF;
+  sim_ble_host_add(0, 5, 150);
+  runLoops(100000, &cost);
+  check(searching && sim_ble_connected_host() == 0, "brief link while searching restarts adv");
+
+  // Down and straight back up between two polls: no advertising beside the link
+  stats = readReconnectStats();
+  uint32_t reconnects = stats.reconnects;
+  sim_ble_disconnect();
+  sim_ble_connect();
+  runLoops(1000, &cost);
+  stats = readReconnectStats();
+  check(sim_ble_adv_mode() == ADV_OFF && stats.reconnects == reconnects + 1,
+        "link back up before a poll: no advertising");
+  sim_ble_erase_bonds();
+}
+
+// Boot with no host, tap key (0,0) `taps` times, then let a host connect
+// after waitUs and subscribe subscribeMs later
+static void tapBeforeHost(uint8_t taps, uint64_t waitUs, uint32_t subscribeMs) {
+  sim_reset();
+  setup();
+  sim_ble_set_notify_hook(onNotify);
+  sim_ble_set_subscribe_delay(subscribeMs);
+  hostText.clear();
+  memset(hostKeys, 0, sizeof(hostKeys));
+  for (uint8_t i = 0; i < taps; i++) {
+    sim_schedule_key(sim_now_us() + 5000 + i * 30000, 0, 0, true);
+    sim_schedule_key(sim_now_us() + 20000 + i * 30000, 0, 0, false);
+  }
+  LoopCost cost = {};
+  runLoops(waitUs, &cost);
+  sim_ble_connect();
+  runLoops(subscribeMs * 1000ULL + 100000, &cost);
+}
+
+static void benchBoot() {
+  printf("\n== Boot: phases and keys pressed before the host listens ==\n");
+  sim_config_erase_all();
+
+  tapBeforeHost(1, 300000, 50);
+  char text[160];
+  boot_format(text, sizeof(text));
+  printf("  %s", text);
+  check(boot_phase_us(BOOT_PHASE_READY) < 10000, "setup() does not wait on anything");
+  check(boot_phase_us(BOOT_PHASE_SUBSCRIBED) - boot_phase_us(BOOT_PHASE_CONNECTED) >= 50000,
+        "connected and subscribed are timed apart");
+  check(hostText == "a" && hostKeysReleased(), "a key tapped before the host listens arrives");
+
+  tapBeforeHost(3, BOOT_INPUT_MAX_AGE_MS * 1000ULL + 500000, 0);
+  check(hostText.empty() && hostKeysReleased() && boot_input_dropped() == 6, "keys older than the age limit are dropped");
+
+  // 12 taps: as many whole taps as fit are kept, and nothing is left held
+  tapBeforeHost(12, 500000, 0);
+  printf("  12 taps before connecting: host saw %zu, %u edges dropped\n", hostText.size(), boot_input_dropped());
+  check(hostText == std::string(BOOT_INPUT_LEN / 2, 'a') && hostKeysReleased(), "a full buffer keeps whole taps only");
+
+  // Typing carries on straight after the replay
+  LoopCost cost = {};
+  hostText.clear();
+  sim_schedule_key(sim_now_us() + 5000, 0, 1, true);
+  sim_schedule_key(sim_now_us() + 20000, 0, 1, false);
+  runLoops(50000, &cost);
+  check(hostText == "b", "live keys follow the replay");
+
+  // A key held as the link drops and released while it is down: the
+  // release goes stale, but the keymap must still let go of the key
+  sim_schedule_key(sim_now_us() + 5000, 0, 0, true);
+  runLoops(50000, &cost);
+  sim_ble_disconnect();
+  sim_schedule_key(sim_now_us() + 5000, 0, 0, false);
+  runLoops(4000000, &cost);
+  sim_ble_connect();
+  runLoops(100000, &cost);
+  sim_schedule_key(sim_now_us() + 5000, 0, 1, true);
+  runLoops(50000, &cost);
+  bool heldA = hostHolds(HID_KEY_A);
+  sim_schedule_key(sim_now_us() + 5000, 0, 1, false);
+  runLoops(50000, &cost);
+  check(!heldA && hostKeysReleased(), "release while the link is down still lands");
+}
+
+int main(int argc, char** argv) {
+  const char* tracePath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--trace") && i + 1 < argc) tracePath = argv[++i];
+    else if (!strcmp(argv[i], "--echo")) sim_serial_echo(true);
+  }
+
+  benchTyping();
+  benchLayers();
+  benchMacro();
+  benchEncoder();
+  benchWheel();
+  benchFlowControl();
+  benchInputBus();
+  benchDebounce(tracePath);
+  benchScan();
+  benchConfig();
+  benchRecorder();
+  benchConfigTransfer();
+  benchResolve();
+  benchPower();
+  benchConnParams();
+  benchReconnect();
+  benchBoot();
+
+  printf("\n%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+// Host stand-ins for the *_esp32.cpp platform files. Hardware timers and
+// FreeRTOS tasks become periodic tasks on the simulation clock.
+
+#include <Arduino.h>
+#include "Sim.h"
+#include "Config.h"
+#include "Keypad.h"
+#include "HID_Transport.h"
+#include "Log.h"
+#include "Latency.h"
+#include "Macro_Recorder.h"
+#include "Power.h"
+#include "Rotary_Encoder.h"
+
+#define SIM_CPU_MHZ 160
+
+// --- Keypad: timer scan ---
+
+static void simWriteRow(uint8_t pin, bool active) {
+  digitalWrite(pin, active ? LOW : HIGH);
+}
+
+static uint32_t simReadInputs() {
+  return sim_gpio_in();
+}
+
+static uint32_t simMicros() {
+  return micros();
+}
+
+static void simSettle(uint32_t us) {
+  // Rows settle instantly in the model
+}
+
+static const KeypadIo simIo = {
+  simWriteRow,
+  simReadInputs,
+  simMicros,
+  simSettle,
+};
+
+static bool scanSuspended;
+
+static void simScan() {
+  if (!scanSuspended) keypad_scan();
+}
+
+void keypad_begin(const uint8_t* rowPins, uint8_t rows,
+                  const uint8_t* colPins, uint8_t cols,
+                  uint16_t scanHz, uint8_t debounceMs) {
+  sim_matrix_attach(rowPins, rows, colPins, cols);
+  keypad_init(rowPins, rows, colPins, cols, &simIo, scanHz, debounceMs);
+  if (scanHz < KEYPAD_SCAN_HZ_MIN) scanHz = KEYPAD_SCAN_HZ_MIN;
+  if (scanHz > KEYPAD_SCAN_HZ_MAX) scanHz = KEYPAD_SCAN_HZ_MAX;
+  scanSuspended = false;
+  sim_every(1000000UL / scanHz, simScan);
+}
+
+void keypad_suspend() {
+  scanSuspended = true;
+  keypad_hold_rows(true);
+}
+
+void keypad_resume() {
+  keypad_hold_rows(false);
+  scanSuspended = false;
+}
+
+// --- HID transport task ---
+
+static void transportPoll() {
+  hid_transport_poll(millis());
+}
+
+void hid_transport_begin(HidReportSink sink) {
+  hid_transport_init(sink, millis());
+  sim_every(1000, transportPoll);
+}
+
+void hid_transport_wake() {
+  // The periodic poll picks reports up within a millisecond
+}
+
+// --- Log drain task ---
+
+static void logDrain() {
+  LogRecord record;
+  while (log_read(&record)) {
+    Serial.printf("[%10lu] %s ", (unsigned long)record.timestamp, log_level_name(record.level));
+    Serial.printf(log_event_format(record.event), record.args[0], record.args[1], record.args[2]);
+    Serial.println();
+  }
+}
+
+void log_begin() {
+  log_init(simMicros);
+  sim_every(20000, logDrain);
+}
+
+// --- Cycle counter ---
+
+static uint32_t simCycles() {
+  return (uint32_t)(sim_now_us() * SIM_CPU_MHZ);
+}
+
+void latency_begin() {
+  latency_init(simCycles, SIM_CPU_MHZ);
+}
+
+// --- Config flash partition ---
+
+alignas(4) static uint8_t configFlash[2][CONFIG_SLOT_SIZE];
+static bool configFlashReady;
+static int32_t configWriteBudget = -1;
+
+static const uint8_t* simFlashSlot(uint8_t slot) {
+  return configFlash[slot];
+}
+
+static bool simFlashErase(uint8_t slot, uint32_t len) {
+  if (configWriteBudget == 0 || len > CONFIG_SLOT_SIZE) return false;
+  len = (len + CONFIG_SECTOR_SIZE - 1) & ~(CONFIG_SECTOR_SIZE - 1);
+  memset(configFlash[slot], 0xFF, len);
+  return true;
+}
+
+static bool simFlashWrite(uint8_t slot, uint32_t offset, const void* data, uint32_t len) {
+  if (offset + len > CONFIG_SLOT_SIZE) return false;
+  const uint8_t* bytes = (const uint8_t*)data;
+  for (uint32_t i = 0; i < len; i++) {
+    if (configWriteBudget == 0) return false;
+    if (configWriteBudget > 0) configWriteBudget--;
+    configFlash[slot][offset + i] &= bytes[i];
+  }
+  return true;
+}
+
+static const ConfigFlashIo simFlash = {
+  simFlashSlot,
+  simFlashErase,
+  simFlashWrite,
+};
+
+void sim_config_erase_all() {
+  memset(configFlash, 0xFF, sizeof(configFlash));
+  configFlashReady = true;
+}
+
+uint8_t* sim_config_slot(uint8_t slot) {
+  return configFlash[slot];
+}
+
+void sim_config_fail_after(int32_t bytes) {
+  configWriteBudget = bytes;
+}
+
+bool config_begin(ConfigView* view) {
+  if (!configFlashReady) sim_config_erase_all();
+  config_store_init(&simFlash);
+  const ConfigHeader* active = config_store_active();
+  if (!active) return false;
+  config_view(active, view);
+  return true;
+}
+
+// --- Recorder storage: NVS ---
+
+static uint8_t storedRecordings[RECORDER_SLOTS][RECORDER_MAX_BYTES];
+static uint16_t storedRecordingLen[RECORDER_SLOTS];
+
+void sim_recorder_erase_all() {
+  memset(storedRecordingLen, 0, sizeof(storedRecordingLen));
+}
+
+void recorder_store_load() {
+  for (uint8_t slot = 0; slot < RECORDER_SLOTS; slot++) {
+    if (storedRecordingLen[slot]) recorder_load(slot, storedRecordings[slot], storedRecordingLen[slot]);
+  }
+}
+
+bool recorder_store_save(uint8_t slot, const uint8_t* data, uint16_t len) {
+  if (slot >= RECORDER_SLOTS || len > RECORDER_MAX_BYTES) return false;
+  memcpy(storedRecordings[slot], data, len);
+  storedRecordingLen[slot] = len;
+  return true;
+}
+
+// --- Power: wake pins and light sleep ---
+// Sleeping blocks the loop task while the clock runs on; the wake pins are
+// sampled every SIM_WAKE_POLL_US, standing in for the level interrupt.
+
+#define SIM_WAKE_POLL_US 100
+
+static uint8_t wakePins[POWER_MAX_WAKE_PINS];
+static bool wakeArmedHigh[POWER_MAX_WAKE_PINS];
+static uint8_t wakePinCount;
+
+static bool wakePinFired() {
+  for (uint8_t i = 0; i < wakePinCount; i++) {
+    if ((digitalRead(wakePins[i]) == HIGH) != wakeArmedHigh[i]) return true;
+  }
+  return false;
+}
+
+static void simPowerSuspend() {
+  keypad_suspend();
+  encoder_suspend();
+  for (uint8_t i = 0; i < wakePinCount; i++) wakeArmedHigh[i] = digitalRead(wakePins[i]) == HIGH;
+}
+
+static bool simPowerWait(uint32_t ms) {
+  uint64_t end = sim_now_us() + (uint64_t)ms * 1000;
+  while (sim_now_us() < end) {
+    if (wakePinFired()) return true;
+    sim_advance(SIM_WAKE_POLL_US);
+  }
+  return wakePinFired();
+}
+
+static void simPowerResume() {
+  encoder_resume();
+  keypad_resume();
+}
+
+static const PowerIo simPower = {
+  simMicros,
+  simPowerSuspend,
+  simPowerWait,
+  simPowerResume,
+};
+
+void power_begin(const uint8_t* pins, uint8_t count, uint32_t idleMs) {
+  wakePinCount = count > POWER_MAX_WAKE_PINS ? POWER_MAX_WAKE_PINS : count;
+  memcpy(wakePins, pins, wakePinCount);
+  power_init(&simPower, idleMs);
+}
@@ -1,104 +1,351 @@
 #include <Arduino.h>
 #include "BLE_HID.h"
+#include "BLE_Config.h"
+#include "Boot.h"
+#include "Config.h"
+#include "Config_Transfer.h"
+#include "Conn_Params.h"
+#include "HID_Transport.h"
+#include "Input_Bus.h"
+#include "Key_Resolve.h"
+#include "Keymap.h"
+#include "MacroPad.h"
+#include "Macro_Recorder.h"
 #include "Rotary_Encoder.h"
+#include "Keypad.h"
+#include "Log.h"
+#include "Latency.h"
+#include "Power.h"
+#include "Reconnect.h"
 
 // --- Keypad Configuration ---
 const byte ROWS = 2;
 const byte COLS = 3;
 
-uint8_t keys[ROWS][COLS] = {
-  {'a', 'b', KEY_PLAY_PAUSE},  // Use codes instead of characters for media keys
-  {'d', 'e', 'f'}
+const byte LAYERS = 2;
+
+// --- Macros ---
+// Bytecode is built at compile time and stays in flash; see MacroPad.h
+MACRO_DEFINE(copyAll,
+  m_press(HID_KEY_LEFT_CTRL),
+  m_tap(HID_KEY_A),
+  m_tap(HID_KEY_C),
+  m_release(HID_KEY_LEFT_CTRL),
+);
+
+const uint8_t* const macros[] = {
+  copyAll.code,  // 0
+};
+
+// Any action can go on any position; see Keymap.h for the action builders.
+// Holding the bottom-right key switches to layer 1: track controls on top,
+// 'f' and a select-all-and-copy macro below, and the encoder scrolls instead
+// of changing the volume.
+constexpr Keymap<LAYERS, ROWS, COLS> keymap = {
+  {
+    {
+      {action_char('a'), action_char('b'), action_consumer(HID_CONSUMER_PLAY_PAUSE)},
+      {action_char('d'), action_char('e'), action_layer(LAYER_MOMENTARY, 1)},
+    },
+    {
+      {action_consumer(HID_CONSUMER_PREV_TRACK), action_consumer(HID_CONSUMER_NEXT_TRACK), action_consumer(HID_CONSUMER_MUTE)},
+      {action_char('f'), action_macro(0), ACTION_TRANS},
+    },
+  },
+  {
+    {ENCODER_MODE_VOLUME, 0, 0},
+    {ENCODER_MODE_SCROLL, 0, 0},
+  },
 };
 
-// Update these pins to match your ESP32 board's wiring
-byte rowPins[ROWS] = {5, 1};
-byte colPins[COLS] = {4, 20, 8};
-
-// --- Keypad Debouncing Variables ---
-unsigned long lastDebounceTime[ROWS][COLS] = {0};
-unsigned long debounceDelay = 50;  // 50ms debounce time
-bool lastButtonState[ROWS][COLS] = {{false}};
-bool buttonState[ROWS][COLS] = {{false}};
-
-
-void handleKeypad() {
-  for (int r = 0; r < ROWS; r++) {
-    digitalWrite(rowPins[r], LOW); // Activate the current row
-    delayMicroseconds(10); // Short delay for stability
-    
-    for (int c = 0; c < COLS; c++) {
-      bool currentState = (digitalRead(colPins[c]) == LOW);
-      
-      // Check if the button state has changed
-      if (currentState != lastButtonState[r][c]) {
-        lastDebounceTime[r][c] = millis();
+// Tap-dances (action_tap_dance(id)) and combos (see Key_Resolve.h), e.g.
+//   combo2(resolve_key(0, 0), resolve_key(0, 1), action_key(HID_KEY_ESCAPE))
+// fires Escape when the two top-left keys go down together
+const TapDance* const dances = nullptr;
+const Combo* const combos = nullptr;
+
+static_assert(ROWS <= KEYPAD_MAX_ROWS && COLS <= KEYPAD_MAX_COLS, "Matrix larger than the scanner supports");
+
+// --- Hardware Settings ---
+// Update the pins to match your ESP32 board's wiring
+const ConfigSettings defaultSettings = {
+  1000,                // scanHz: matrix scan rate, 1-4 kHz
+  KEYPAD_DEBOUNCE_MS,  // debounceMs
+  ROT_A,               // encoderPinA
+  ROT_B,               // encoderPinB
+  {5, 1},              // rowPins
+  {4, 20, 8},          // colPins
+  0,                   // idleMinutes: 0 sleeps after POWER_IDLE_MS
+  0,                   // comboTermMs: 0 for RESOLVE_COMBO_TERM_MS
+  0,                   // reserved0
+  0,                   // tapTermMs: 0 for RESOLVE_TAP_TERM_MS
+  0,                   // replayGapMs: 0 plays recordings with their own timing
+};
+
+// --- Configuration ---
+// The layout above is the default. A valid blob in the config partition
+// (see Config.h) replaces it, and is used in place from flash.
+const ConfigSource defaultConfig = {
+  &defaultSettings,
+  &keymap.keys[0][0][0],
+  keymap.encoder,
+  LAYERS, ROWS, COLS,
+  macros, sizeof(macros) / sizeof(macros[0]),
+  dances, 0,
+  combos, 0,
+};
+
+static ConfigView config;
+
+// The scanner keeps pointers to its pins, so they are copied out of flash:
+// a later config write may erase the slot they came from
+static ConfigSettings settings;
+
+
+// Keys pressed before the host was listening (see Boot.h), in order and
+// one report per edge, so a tap is never folded into nothing
+static void replayPendingKeys() {
+  static uint32_t replayed;
+  if (boot_input_empty()) return;
+  if (!ble_hid_ready()) {
+    boot_input_expire(micros());
+    return;
+  }
+
+  PendingKey key;
+  while (hid_transport_press_room() > 0 && boot_input_pop(&key, micros())) {
+    resolve_key_event(key.row, key.col, key.pressed, key.timestamp);
+    ble_hid_flush();
+    replayed++;
+  }
+  if (boot_input_empty()) {
+    LOG(LOG_EVT_INPUT_REPLAYED, replayed, boot_input_dropped());
+    replayed = 0;
+  }
+}
+
+// A key edge: goes through tap-hold, tap-dance and combo resolution to the
+// keymap, which resolves the layer on press and runs the same action on release
+static void handleKey(const InputEvent& event, uint32_t* scanTimestamp) {
+  recorder_capture_key(event.row, event.col, event.value, event.timestamp);
+
+  // Until the host listens, and until older keys are out, keys queue up
+  if (!ble_hid_ready() || !boot_input_empty()) {
+    boot_input_push(&event);
+    return;
+  }
+
+  // Events from one scan pass share a timestamp; send one report per pass
+  if (event.timestamp != *scanTimestamp) ble_hid_flush();
+  *scanTimestamp = event.timestamp;
+  latency_mark_input(event.detectCycles, event.acceptCycles);
+  resolve_key_event(event.row, event.col, event.value, event.timestamp);
+}
+
+// --- Input Processing ---
+// The scanner and the encoder decoder only push events to the input bus
+// (see Input_Bus.h). This is the one stage that consumes them, oldest first
+// across sources, and drives the keymap, layers, macros and encoder output.
+// Returns true when there was any input.
+bool handleInput() {
+  InputEvent event;
+  uint32_t scanTimestamp = 0;
+  bool input = false;
+
+  replayPendingKeys();
+  while (input_read(&event)) {
+    input = true;
+    switch (event.type) {
+      case INPUT_KEY:
+        handleKey(event, &scanTimestamp);
+        break;
+      case INPUT_ROTATION:
+        recorder_capture_rotation(event.value, event.timestamp);
+        // Acceleration goes by when the detents happened, not when a stalled
+        // loop got to them; the time is moved onto the millis() clock
+        // encoder_poll() runs on, as micros() wraps far sooner
+        encoder_add_detents(event.value, millis() - (micros() - event.timestamp) / 1000);
+        break;
+    }
+  }
+  resolve_poll(micros());  // Tap-hold and combo decisions whose term ran out
+
+  ble_hid_flush();
+
+  // Inputs that produced no report (e.g. consumer key releases) end their trace here
+  uint32_t detectCycles, acceptCycles;
+  latency_take_input(&detectCycles, &acceptCycles);
+
+  encoder_poll(millis());  // Accelerated bursts go out as their batch closes
+  return input;
+}
+
+// --- Live Reconfiguration ---
+// A config written over BLE (see BLE_Config.h) replaces the keys, encoder
+// bindings and macros at once, without a reboot or reconnect. Pins, scan
+// rate and debounce belong to the scanner and take effect at the next boot.
+void handleConfigUpdate() {
+  if (!ble_config_poll()) return;
+
+  uint32_t start = micros();
+  config_view(config_store_active(), &config);
+  ble_hid_release_all();  // Nothing held under the old keymap stays down
+  keymap_init(config.keys, config.encoder, config.layers, config.rows, config.cols);
+  resolve_begin(config.dances, config.danceCount, config.combos, config.comboCount,
+                config.settings->tapTermMs, config.settings->comboTermMs);
+  macro_begin(config.macros, config.macroCount);
+  recorder_begin(config.settings->replayGapMs);
+  LOG(LOG_EVT_CONFIG_APPLIED, micros() - start);
+}
+
+// --- Serial Diagnostics ---
+// 'l' prints the latency histograms, 'r' clears them, 'p' prints power state
+// times, 'c' prints the connection parameters and reconnect times, 'b' prints
+// the boot phase times, 'i' prints the input bus and key resolution
+// counters, 's' prints the matrix scan timing, 't' prints the HID transport
+// counters, 'm' prints the macro recorder slots
+void handleSerialCommands() {
+  while (Serial.available()) {
+    switch (Serial.read()) {
+      case 'l': {
+        static char text[640];
+        latency_format(text, sizeof(text));
+        Serial.print(text);
+        break;
+      }
+      case 'r':
+        latency_reset();
+        Serial.println("Latency histograms cleared");
+        break;
+      case 'c': {
+        ConnParamsStatus conn;
+        conn_params_status(&conn);
+        Serial.printf("Connection: %s profile%s, interval %u us, latency %u, timeout %u ms; "
+                      "%u requests, %u updates, %u failures\n",
+                      conn_profile_name((ConnProfile)conn.profile),
+                      conn.forced == CONN_PROFILE_AUTO ? "" : " (pinned)",
+                      conn.interval * 1250, conn.latency, conn.timeout * 10,
+                      (unsigned)conn.requests, (unsigned)conn.updates, (unsigned)conn.failures);
+        ReconnectStats reconnect;
+        reconnect_get_stats(&reconnect);
+        Serial.printf("Host slot %u, advertising %s; %u connects in %u/%u/%u ms (min/avg/max), last %u ms\n",
+                      reconnect.selected, adv_mode_name((AdvMode)reconnect.mode), (unsigned)reconnect.reconnects,
+                      (unsigned)reconnect.minMs,
+                      (unsigned)(reconnect.reconnects ? reconnect.totalMs / reconnect.reconnects : 0),
+                      (unsigned)reconnect.maxMs, (unsigned)reconnect.lastMs);
+        break;
+      }
+      case 'p': {
+        static char text[160];
+        power_format(text, sizeof(text));
+        Serial.print(text);
+        break;
+      }
+      case 'b': {
+        static char text[160];
+        boot_format(text, sizeof(text));
+        Serial.print(text);
+        break;
       }
-      
-      // Apply debouncing
-      if ((millis() - lastDebounceTime[r][c]) > debounceDelay) {
-        // If the button state has changed, update the state
-        if (currentState != buttonState[r][c]) {
-          buttonState[r][c] = currentState;
-          
-          if (buttonState[r][c]) {
-            // Key pressed
-            uint8_t key = keys[r][c];
-            
-            // Check if it's a special media key or a regular key
-            if (key == KEY_PLAY_PAUSE || key == KEY_VOL_UP || key == KEY_VOL_DOWN) {
-              uint16_t mediaCode = specialCodeToMediaCode(key);
-              Serial.print("Media key pressed: ");
-              Serial.println(key);
-              ble_send_media_key(mediaCode);
-            } else {
-              Serial.print("Key pressed: ");
-              Serial.println((char)key);
-              ble_send_key((char)key, true);
-            }
-          } else {
-            // Key released - only send release for regular keys
-            uint8_t key = keys[r][c];
-            if (key != KEY_PLAY_PAUSE && key != KEY_VOL_UP && key != KEY_VOL_DOWN) {
-              Serial.print("Key released: ");
-              Serial.println((char)key);
-              ble_send_key((char)key, false);
-            }
-          }
-        }
+      case 'i': {
+        static char text[160];
+        input_format(text, sizeof(text));
+        Serial.print(text);
+        ResolveStats resolve;
+        resolve_get_stats(&resolve);
+        Serial.printf("Resolve: %u taps, %u holds, %u dances, %u combos, %u deferred, longest %u us\n",
+                      (unsigned)resolve.taps, (unsigned)resolve.holds, (unsigned)resolve.dances,
+                      (unsigned)resolve.combos, (unsigned)resolve.deferred, (unsigned)resolve.maxDelayUs);
+        break;
+      }
+      case 't': {
+        static char text[200];
+        hid_transport_format(text, sizeof(text));
+        Serial.print(text);
+        break;
+      }
+      case 'm': {
+        RecorderStats rec;
+        recorder_get_stats(&rec);
+        Serial.print("Recorder slots:");
+        for (uint8_t slot = 0; slot < RECORDER_SLOTS; slot++) Serial.printf(" %u", recorder_slot_len(slot));
+        Serial.printf(" bytes; %u recorded, %u played, %u truncated, longest gap %u ms%s\n",
+                      (unsigned)rec.recorded, (unsigned)rec.played, (unsigned)rec.truncated, rec.longestGapMs,
+                      recorder_recording() ? ", recording" : "");
+        break;
+      }
+      case 's': {
+        KeypadStats scan;
+        keypad_get_stats(&scan);
+        Serial.printf("Scan: %u scans, interval %u-%u us, longest %u us, %u ghost scans\n",
+                      (unsigned)scan.scans, (unsigned)scan.minIntervalUs, (unsigned)scan.maxIntervalUs,
+                      (unsigned)scan.maxScanUs, (unsigned)scan.ghostScans);
+        break;
       }
-      
-      lastButtonState[r][c] = currentState;
     }
-    
-    digitalWrite(rowPins[r], HIGH); // Deactivate the row
-    delay(1); // Small delay for stability
   }
 }
 
 
 
+// Nothing waits on Serial. The scanner starts before the BLE stack, whose
+// init blocks for most of the boot, so keys pressed meanwhile are queued and
+// reach the host once it subscribes (see replayPendingKeys()).
 void setup() {
   Serial.begin(115200);
-  delay(1000); // Wait for Serial to initialize
-  Serial.println("Starting BLE HID Keypad");
+  boot_init();
+  input_init();
+  log_begin();
+  latency_begin();
 
-  // Initialize keypad pins
-  for (int r = 0; r < ROWS; r++) {
-    pinMode(rowPins[r], OUTPUT);
-    digitalWrite(rowPins[r], HIGH); // Start with rows inactive
-  }
-  
-  for (int c = 0; c < COLS; c++) {
-    pinMode(colPins[c], INPUT_PULLUP); // Use internal pull-up resistors
-  }
+  if (!config_begin(&config)) config_view_source(&defaultConfig, &config);
+  LOG(LOG_EVT_CONFIG_LOADED, config_store_active_slot(), config.header ? config.header->sequence : 0);
+  settings = *config.settings;
+  boot_mark(BOOT_PHASE_CONFIG, micros());
+
+  // Scanning runs from a hardware timer, independent of loop()
+  keypad_begin(settings.rowPins, config.rows, settings.colPins, config.cols,
+               settings.scanHz, settings.debounceMs);
+  encoder_setup(settings.encoderPinA, settings.encoderPinB);
+  boot_mark(BOOT_PHASE_INPUT, micros());
 
-  encoder_setup();
   ble_hid_setup();
+  boot_mark(BOOT_PHASE_BLE, micros());
+
+  // After encoder_setup(), it binds the encoder
+  keymap_init(config.keys, config.encoder, config.layers, config.rows, config.cols);
+  resolve_begin(config.dances, config.danceCount, config.combos, config.comboCount,
+                config.settings->tapTermMs, config.settings->comboTermMs);
+  macro_begin(config.macros, config.macroCount);
+  recorder_begin(config.settings->replayGapMs);  // Loads the stored recordings
+
+  // Any column (all rows are held active while asleep) or encoder edge wakes the pad
+  uint8_t wakePins[POWER_MAX_WAKE_PINS];
+  memcpy(wakePins, settings.colPins, config.cols);
+  wakePins[config.cols] = settings.encoderPinA;
+  wakePins[config.cols + 1] = settings.encoderPinB;
+  power_begin(wakePins, config.cols + 2,
+              settings.idleMinutes ? settings.idleMinutes * 60000UL : POWER_IDLE_MS);
+  boot_mark(BOOT_PHASE_READY, micros());
+  Serial.println("Starting BLE HID Keypad");
 }
 
 void loop() {
-  handleEncoder();
-  handleKeypad();
-  delay(10); // Small delay to prevent overwhelming the system
+  if (handleInput()) {
+    power_activity();
+    conn_params_activity(millis());
+  }
+  conn_params_poll(ble_is_connected(), millis());  // Short interval while typing, long when idle
+  reconnect_poll(millis());  // Advertising phases while no host is connected
+  if (ble_is_connected()) boot_mark(BOOT_PHASE_CONNECTED, micros());
+  if (ble_hid_ready()) boot_mark(BOOT_PHASE_SUBSCRIBED, micros());
+  macro_poll(millis());  // A few macro steps per pass, so keys are never held up
+  recorder_poll(millis());  // Recorded events as they fall due, paced like macros
+  handleConfigUpdate();
+  handleSerialCommands();
+
+  // Sleeps here once idle; blocks until a key or the encoder wakes it
+  power_poll(keypad_any_pressed() || resolve_busy() || macro_busy() || recorder_playing() ||
+             config_transfer_active());
+  delay(1); // Yield; key sampling no longer depends on this loop
 }
\ No newline at end of file
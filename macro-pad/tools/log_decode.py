@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+"""Decode a binary log dump from a LOG_BINARY_OUTPUT build into text.
+
+Usage: log_decode.py [dump.bin]   (reads stdin when no file is given)
+
+Event ids and formats are read from lib/Log/Log_Events.h, so the tool
+always matches the firmware it is run next to.
+"""
+import os
+import re
+import struct
+import sys
+
+RECORD = struct.Struct("<BBHIiii")  # matches LogRecord in lib/Log/Log.h
+MAGIC = 0xA5
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D"}
+
+EVENTS_H = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                        "..", "lib", "Log", "Log_Events.h")
+EVENT_RE = re.compile(r'X\(\s*(\w+)\s*,\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)')
+
+
+def load_events(path):
+    with open(path) as f:
+        return [(name, fmt) for name, _level, fmt in EVENT_RE.findall(f.read())]
+
+
+def format_record(events, level, event, timestamp, args):
+    if event < len(events):
+        fmt = events[event][1]
+    else:
+        fmt = "Unknown event %d: %d %d %d"
+        args = (event,) + args
+    count = len(re.findall(r"%[-0-9.]*[duxXc]", fmt))
+    return "[%10u] %s %s" % (timestamp, LEVELS.get(level, "-"), fmt % args[:count])
+
+
+def decode(events, data):
+    pos = 0
+    while pos + RECORD.size <= len(data):
+        if data[pos] != MAGIC:
+            pos += 1  # Resynchronise on the next record header
+            continue
+        _magic, level, event, timestamp, a0, a1, a2 = RECORD.unpack_from(data, pos)
+        yield format_record(events, level, event, timestamp, (a0, a1, a2))
+        pos += RECORD.size
+
+
+def main():
+    events = load_events(EVENTS_H)
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "rb") as f:
+            data = f.read()
+    else:
+        data = sys.stdin.buffer.read()
+    for line in decode(events, data):
+        print(line)
+
+
+if __name__ == "__main__":
+    main()